@@ -5,7 +5,7 @@ import uuid
 import numpy as np
 
 from asciidtype import ASCIIDType
-from stringdtype import StringDType
+from stringdtype import StringDType, from_sequence
 
 
 def generate_data(n=100000):
@@ -35,10 +35,25 @@ class TimeStringDType:
         self.string_dtype_object = StringDType()
         with open("strings", "r") as f:
             self.strings = f.readlines()
+        self.arr = np.array(self.strings, dtype=self.string_dtype_object)
+        # keys that only differ after many chunks
+        self.shared_prefix_arr = np.array(
+            ["p" * 430 + s for s in self.strings],
+            dtype=self.string_dtype_object,
+        )
 
     def time_allocate(self):
         _ = np.array(self.strings, dtype=self.string_dtype_object)
 
+    def time_from_sequence(self):
+        _ = from_sequence(self.strings, dtype=self.string_dtype_object)
+
+    def time_sort(self):
+        _ = np.sort(self.arr)
+
+    def time_sort_shared_prefix(self):
+        _ = np.sort(self.shared_prefix_arr)
+
 
 class TimeObjectDType:
     def setup(self):
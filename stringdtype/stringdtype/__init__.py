@@ -3,11 +3,34 @@
 """
 
 from .scalar import StringScalar  # isort: skip
-from ._main import StringDType, _memory_usage
+from ._main import (
+    StringDType,
+    _memory_usage,
+    compact,
+    from_arrow_buffers,
+    from_sequence,
+    lower,
+    replace,
+    searchsorted,
+    string_hash,
+    to_arrow_buffers,
+    unique,
+    upper,
+)
 
 __all__ = [
     "NA",
     "StringDType",
     "StringScalar",
     "_memory_usage",
+    "compact",
+    "from_arrow_buffers",
+    "from_sequence",
+    "lower",
+    "replace",
+    "searchsorted",
+    "string_hash",
+    "to_arrow_buffers",
+    "unique",
+    "upper",
 ]
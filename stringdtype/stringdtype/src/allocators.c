@@ -0,0 +1,207 @@
+#include <Python.h>
+
+#include <string.h>
+
+#include "allocators.h"
+
+// The pool backend keeps freed blocks in a process-wide cache, so memory
+// released by one array (for example when it is deleted or compacted) can
+// be reused by any other array using the pool without going back to the
+// system allocator. Requested sizes are rounded up to a power of two and
+// cached by size class. Each block starts with a header holding its size
+// class and the number of usable bytes. The header is not counted in the
+// size class, so power of two requests like arena chunks are not bumped
+// into the next class.
+#define POOL_HEADER_SIZE (2 * sizeof(size_t))
+#define POOL_MIN_CLASS 5
+// requests bigger than 2**POOL_MAX_CLASS bytes are never cached
+#define POOL_MAX_CLASS 26
+// upper bound on the total size of the cached blocks
+#define POOL_MAX_CACHED_BYTES ((size_t)64 << 20)
+
+static char *pool_free_lists[POOL_MAX_CLASS + 1] = {NULL};
+static size_t pool_cached_bytes = 0;
+static PyThread_type_lock pool_lock = NULL;
+
+static void *
+pool_malloc(size_t size)
+{
+    if (size > SIZE_MAX - POOL_HEADER_SIZE) {
+        return NULL;
+    }
+    size_t capacity = size;
+    size_t cls = POOL_MIN_CLASS;
+    while (cls <= POOL_MAX_CLASS && ((size_t)1 << cls) < size) {
+        cls++;
+    }
+
+    char *block = NULL;
+    if (cls <= POOL_MAX_CLASS) {
+        capacity = (size_t)1 << cls;
+        PyThread_acquire_lock(pool_lock, WAIT_LOCK);
+        block = pool_free_lists[cls];
+        if (block != NULL) {
+            // the link to the next cached block is stored after the header
+            memcpy(&pool_free_lists[cls], block + POOL_HEADER_SIZE,
+                   sizeof(char *));
+            pool_cached_bytes -= capacity;
+        }
+        PyThread_release_lock(pool_lock);
+    }
+    if (block == NULL) {
+        block = PyMem_RawMalloc(capacity + POOL_HEADER_SIZE);
+        if (block == NULL) {
+            return NULL;
+        }
+    }
+
+    memcpy(block, &cls, sizeof(size_t));
+    memcpy(block + sizeof(size_t), &capacity, sizeof(size_t));
+    return block + POOL_HEADER_SIZE;
+}
+
+static void
+pool_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    char *block = (char *)ptr - POOL_HEADER_SIZE;
+    size_t cls;
+    memcpy(&cls, block, sizeof(size_t));
+    if (cls <= POOL_MAX_CLASS) {
+        size_t capacity = (size_t)1 << cls;
+        PyThread_acquire_lock(pool_lock, WAIT_LOCK);
+        if (pool_cached_bytes + capacity <= POOL_MAX_CACHED_BYTES) {
+            memcpy(block + POOL_HEADER_SIZE, &pool_free_lists[cls],
+                   sizeof(char *));
+            pool_free_lists[cls] = block;
+            pool_cached_bytes += capacity;
+            block = NULL;
+        }
+        PyThread_release_lock(pool_lock);
+    }
+    if (block != NULL) {
+        PyMem_RawFree(block);
+    }
+}
+
+static void *
+pool_realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return pool_malloc(size);
+    }
+    size_t capacity;
+    memcpy(&capacity, (char *)ptr - sizeof(size_t), sizeof(size_t));
+    if (size <= capacity) {
+        return ptr;
+    }
+    void *ret = pool_malloc(size);
+    if (ret == NULL) {
+        return NULL;
+    }
+    memcpy(ret, ptr, capacity);
+    pool_free(ptr);
+    return ret;
+}
+
+#ifdef STRINGDTYPE_DEBUG_ALLOCATOR
+// The debug backend fails any allocation bigger than a limit set with
+// set_debug_allocation_limit, so tests can check that running out of memory
+// part of the way through an operation is handled. It is only built with
+// the debug_allocator meson option, since the limit is shared by the whole
+// process.
+static size_t debug_allocation_limit = 0;
+
+static void *
+debug_malloc(size_t size)
+{
+    if (debug_allocation_limit > 0 && size > debug_allocation_limit) {
+        return NULL;
+    }
+    return PyMem_RawMalloc(size);
+}
+
+static void *
+debug_realloc(void *ptr, size_t size)
+{
+    if (debug_allocation_limit > 0 && size > debug_allocation_limit) {
+        return NULL;
+    }
+    return PyMem_RawRealloc(ptr, size);
+}
+
+void
+set_debug_allocation_limit(size_t limit)
+{
+    debug_allocation_limit = limit;
+}
+#endif
+
+// The first entry is the default backend.
+static const allocator_backend backends[] = {
+        // arena chunks and heap strings come from the Python raw memory
+        // allocator and freed strings are reused
+        {"default", PyMem_RawMalloc, PyMem_RawFree, PyMem_RawRealloc, 0, 0},
+        // uses the C library allocator, or a replacement like mimalloc or
+        // jemalloc if one is linked in or preloaded
+        {"malloc", malloc, free, realloc, 0, 0},
+        // for strings that are written once, skips all bookkeeping for
+        // freed strings
+        {"bump", PyMem_RawMalloc, PyMem_RawFree, PyMem_RawRealloc, 1, 0},
+        // shares freed memory between all arrays using the pool
+        {"pool", pool_malloc, pool_free, pool_realloc, 0, 0},
+        // for low cardinality data, equal strings share one allocation
+        {"intern", PyMem_RawMalloc, PyMem_RawFree, PyMem_RawRealloc, 0, 1},
+#ifdef STRINGDTYPE_DEBUG_ALLOCATOR
+        // like the default backend, but big allocations can be made to fail
+        {"debug", debug_malloc, PyMem_RawFree, debug_realloc, 0, 0},
+#endif
+};
+
+#define NUM_BACKENDS (sizeof(backends) / sizeof(backends[0]))
+
+const allocator_backend *
+get_allocator_backend(const char *name)
+{
+    if (name == NULL) {
+        return &backends[0];
+    }
+    for (size_t i = 0; i < NUM_BACKENDS; i++) {
+        if (strcmp(name, backends[i].name) == 0) {
+            return &backends[i];
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "Unknown StringDType allocator '%s'",
+                 name);
+    return NULL;
+}
+
+npy_string_allocator *
+new_backend_allocator(const allocator_backend *backend)
+{
+    npy_string_allocator *allocator = NpyString_new_allocator(
+            backend->malloc, backend->free, backend->realloc);
+    if (allocator == NULL) {
+        return NULL;
+    }
+    if (backend->bump) {
+        NpyString_set_bump_allocation(allocator);
+    }
+    if (backend->intern) {
+        NpyString_set_interning(allocator);
+    }
+    return allocator;
+}
+
+int
+init_allocator_backends(void)
+{
+    pool_lock = PyThread_allocate_lock();
+    if (pool_lock == NULL) {
+        PyErr_SetString(PyExc_MemoryError, "Unable to allocate thread lock");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef _NPY_ALLOCATORS_H
+#define _NPY_ALLOCATORS_H
+
+#include <Python.h>
+
+#include "static_string.h"
+
+// An allocator backend supplies the memory management functions used by the
+// string allocator of a StringDType instance, both for arena chunks and for
+// strings allocated on the heap.
+typedef struct {
+    const char *name;
+    npy_string_malloc_func malloc;
+    npy_string_free_func free;
+    npy_string_realloc_func realloc;
+    // if nonzero, allocators using this backend are bump allocators, see
+    // NpyString_set_bump_allocation
+    int bump;
+    // if nonzero, allocators using this backend share the storage of equal
+    // strings, see NpyString_set_interning
+    int intern;
+} allocator_backend;
+
+// Returns the backend registered under *name*, or the default backend if
+// *name* is NULL. Sets a ValueError and returns NULL if there is no backend
+// with that name.
+const allocator_backend *
+get_allocator_backend(const char *name);
+
+// Creates a new string allocator that uses *backend*. Returns NULL if
+// memory allocation fails.
+npy_string_allocator *
+new_backend_allocator(const allocator_backend *backend);
+
+#ifdef STRINGDTYPE_DEBUG_ALLOCATOR
+// Makes allocations of more than *limit* bytes by the debug backend fail.
+// A limit of zero removes the limit. Only meant to be used by tests.
+void
+set_debug_allocation_limit(size_t limit);
+#endif
+
+// Sets up the state shared by the backends. Must be called when the module
+// is initialized.
+int
+init_allocator_backends(void);
+
+#endif /*_NPY_ALLOCATORS_H */
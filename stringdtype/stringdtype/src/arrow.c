@@ -0,0 +1,470 @@
+#include <Python.h>
+
+#include "arrow.h"
+#include "dtype.h"
+#include "static_string.h"
+#include "utf8_utils.h"
+
+// Arrow validity bitmaps store one bit per element, least significant bit
+// first. A set bit marks a valid (non-null) element.
+#define BITMAP_GET(bitmap, i) (((bitmap)[(i) >> 3] >> ((i)&7)) & 1)
+#define BITMAP_SET(bitmap, i) ((bitmap)[(i) >> 3] |= (1 << ((i)&7)))
+
+PyObject *
+from_arrow_buffers(PyObject *NPY_UNUSED(self), PyObject *args, PyObject *kwds)
+{
+    static char *kwargs_strs[] = {"data", "offsets", "validity", "dtype",
+                                  NULL};
+    PyObject *data_obj = NULL;
+    PyObject *offsets_obj = NULL;
+    PyObject *validity_obj = Py_None;
+    PyObject *dtype_obj = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|OO:from_arrow_buffers",
+                                     kwargs_strs, &data_obj, &offsets_obj,
+                                     &validity_obj, &dtype_obj)) {
+        return NULL;
+    }
+
+    Py_buffer data = {0};
+    Py_buffer validity = {0};
+    PyArrayObject *offsets_arr = NULL;
+    StringDTypeObject *descr = NULL;
+    PyArrayObject *ret = NULL;
+
+    if (PyObject_GetBuffer(data_obj, &data, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+
+    offsets_arr = (PyArrayObject *)PyArray_FROMANY(offsets_obj, NPY_INT64, 1,
+                                                   1, NPY_ARRAY_CARRAY_RO);
+    if (offsets_arr == NULL) {
+        goto fail;
+    }
+
+    npy_intp num = PyArray_SIZE(offsets_arr) - 1;
+    if (num < 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "offsets must have at least one element");
+        goto fail;
+    }
+    const npy_int64 *offsets = (npy_int64 *)PyArray_DATA(offsets_arr);
+
+    const unsigned char *bitmap = NULL;
+    if (validity_obj != Py_None) {
+        if (PyObject_GetBuffer(validity_obj, &validity, PyBUF_SIMPLE) < 0) {
+            goto fail;
+        }
+        if (validity.len < (num + 7) / 8) {
+            PyErr_SetString(PyExc_ValueError,
+                            "validity bitmap is too short for the number of "
+                            "offsets");
+            goto fail;
+        }
+        bitmap = (const unsigned char *)validity.buf;
+    }
+
+    if (dtype_obj == Py_None) {
+        descr = (StringDTypeObject *)new_stringdtype_instance(NULL, 1, NULL);
+        if (descr == NULL) {
+            goto fail;
+        }
+    }
+    else if (Py_TYPE(dtype_obj) == (PyTypeObject *)&StringDType) {
+        Py_INCREF(dtype_obj);
+        descr = (StringDTypeObject *)dtype_obj;
+    }
+    else {
+        PyErr_SetString(PyExc_TypeError, "dtype must be a StringDType");
+        goto fail;
+    }
+
+    // check the offsets and figure out how much arena memory is needed
+    // before allocating anything
+    size_t arena_size = 0;
+    npy_intp num_null = 0;
+    for (npy_intp i = 0; i < num; i++) {
+        if (bitmap != NULL && !BITMAP_GET(bitmap, i)) {
+            num_null++;
+            continue;
+        }
+        npy_int64 start = offsets[i];
+        npy_int64 end = offsets[i + 1];
+        if (start < 0 || end < start || end > data.len) {
+            PyErr_Format(PyExc_ValueError,
+                         "invalid offsets [%lld, %lld) for element %zd of a "
+                         "data buffer of size %zd",
+                         (long long)start, (long long)end, (Py_ssize_t)i,
+                         data.len);
+            goto fail;
+        }
+        arena_size += NpyString_arena_storage_size((size_t)(end - start));
+    }
+
+    if (num_null > 0 && descr->na_object == NULL) {
+        PyErr_SetString(PyExc_ValueError,
+                        "validity bitmap contains null elements but the "
+                        "dtype does not have an na_object");
+        goto fail;
+    }
+
+    // steals the reference to descr
+    ret = (PyArrayObject *)PyArray_NewFromDescr(
+            &PyArray_Type, (PyArray_Descr *)descr, 1, &num, NULL, NULL, 0,
+            NULL);
+    descr = NULL;
+    if (ret == NULL) {
+        goto fail;
+    }
+
+    // the array may have been given a new descriptor instance
+    StringDTypeObject *sdescr = (StringDTypeObject *)PyArray_DESCR(ret);
+    char *out = PyArray_BYTES(ret);
+    npy_intp out_stride = PyArray_STRIDES(ret)[0];
+    const char *buf = (const char *)data.buf;
+    npy_intp err_index = -1;
+    int err_is_memory = 0;
+
+    NPY_BEGIN_THREADS_DEF;
+    NPY_BEGIN_THREADS;
+
+    npy_string_allocator *allocator = NpyString_acquire_allocator(sdescr);
+
+    if (NpyString_arena_reserve(allocator, arena_size) < 0) {
+        err_is_memory = 1;
+    }
+
+    for (npy_intp i = 0; i < num && !err_is_memory; i++) {
+        npy_packed_static_string *ps = (npy_packed_static_string *)out;
+        if (bitmap != NULL && !BITMAP_GET(bitmap, i)) {
+            if (NpyString_pack_null(allocator, ps) < 0) {
+                err_is_memory = 1;
+                break;
+            }
+        }
+        else {
+            size_t size = (size_t)(offsets[i + 1] - offsets[i]);
+            const char *str = buf + offsets[i];
+            if (!utf8_is_valid(str, size)) {
+                err_index = i;
+                break;
+            }
+            // the array buffer is zero-filled, so every element already
+            // holds an initialized empty string
+            if (NpyString_newsize(str, size, ps, allocator) < 0) {
+                err_is_memory = 1;
+                break;
+            }
+        }
+        out += out_stride;
+    }
+
+    NpyString_release_allocator(sdescr);
+
+    NPY_END_THREADS;
+
+    if (err_is_memory) {
+        PyErr_SetString(PyExc_MemoryError,
+                        "Failed to allocate string in from_arrow_buffers");
+        goto fail;
+    }
+    if (err_index >= 0) {
+        PyErr_Format(PyExc_ValueError, "element %zd is not valid UTF-8",
+                     (Py_ssize_t)err_index);
+        goto fail;
+    }
+
+    PyBuffer_Release(&data);
+    PyBuffer_Release(&validity);
+    Py_DECREF(offsets_arr);
+
+    return (PyObject *)ret;
+
+fail:
+    PyBuffer_Release(&data);
+    PyBuffer_Release(&validity);
+    Py_XDECREF(offsets_arr);
+    Py_XDECREF(descr);
+    Py_XDECREF(ret);
+    return NULL;
+}
+
+// Number of times to_arrow_buffers copies the strings while letting other
+// threads modify the array in between the two passes before it holds the
+// lock for both passes
+#define TO_ARROW_MAX_RETRIES 3
+
+// First pass of to_arrow_buffers: fills in the offsets and the validity
+// bitmap, which must be zeroed, and returns the number of null elements.
+// Only looks at the packed strings, but the allocator lock must be held so
+// that they aren't modified at the same time.
+static npy_intp
+arrow_offsets(NpyIter *iter, NpyIter_IterNextFunc *iternext,
+              npy_int64 *offsets, unsigned char *bitmap)
+{
+    char **dataptr = NpyIter_GetDataPtrArray(iter);
+    npy_intp *strideptr = NpyIter_GetInnerStrideArray(iter);
+    npy_intp *innersizeptr = NpyIter_GetInnerLoopSizePtr(iter);
+    npy_intp num_null = 0;
+    npy_intp i = 0;
+    do {
+        char *in = dataptr[0];
+        npy_intp stride = *strideptr;
+        npy_intp count = *innersizeptr;
+
+        while (count--) {
+            const npy_packed_static_string *ps =
+                    (npy_packed_static_string *)in;
+            if (NpyString_isnull(ps)) {
+                num_null++;
+                offsets[i + 1] = offsets[i];
+            }
+            else {
+                BITMAP_SET(bitmap, i);
+                offsets[i + 1] = offsets[i] + (npy_int64)NpyString_size(ps);
+            }
+            i++;
+            in += stride;
+        }
+    } while (iternext(iter));
+    return num_null;
+}
+
+// Second pass of to_arrow_buffers: copies the string data to *out*. Returns
+// 1 if the strings no longer match the offsets and validity from the first
+// pass, -1 if loading a string fails, and 0 on success.
+static int
+arrow_copy(NpyIter *iter, NpyIter_IterNextFunc *iternext,
+           npy_string_allocator *allocator, const npy_int64 *offsets,
+           const unsigned char *bitmap, char *out)
+{
+    char **dataptr = NpyIter_GetDataPtrArray(iter);
+    npy_intp *strideptr = NpyIter_GetInnerStrideArray(iter);
+    npy_intp *innersizeptr = NpyIter_GetInnerLoopSizePtr(iter);
+    npy_intp i = 0;
+    do {
+        char *in = dataptr[0];
+        npy_intp stride = *strideptr;
+        npy_intp count = *innersizeptr;
+
+        while (count--) {
+            npy_static_string s = {0, NULL};
+            int is_null = NpyString_load(
+                    allocator, (npy_packed_static_string *)in, &s);
+            if (is_null == -1) {
+                return -1;
+            }
+            if (is_null != !BITMAP_GET(bitmap, i) ||
+                (npy_int64)s.size != offsets[i + 1] - offsets[i]) {
+                return 1;
+            }
+            if (s.size > 0) {
+                memcpy(out, s.buf, s.size);
+                out += s.size;
+            }
+            i++;
+            in += stride;
+        }
+    } while (iternext(iter));
+    return 0;
+}
+
+PyObject *
+to_arrow_buffers(PyObject *NPY_UNUSED(self), PyObject *obj)
+{
+    if (!PyArray_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "can only be called with ndarray object");
+        return NULL;
+    }
+
+    PyArrayObject *arr = (PyArrayObject *)obj;
+
+    if (NPY_DTYPE(PyArray_DESCR(arr)) != (PyArray_DTypeMeta *)&StringDType) {
+        PyErr_SetString(PyExc_TypeError,
+                        "can only be called with a StringDType array");
+        return NULL;
+    }
+
+    StringDTypeObject *descr = (StringDTypeObject *)PyArray_DESCR(arr);
+    npy_intp num = PyArray_SIZE(arr);
+    npy_intp num_offsets = num + 1;
+    npy_intp bitmap_size = (num + 7) / 8;
+
+    NpyIter *iter = NULL;
+    PyArrayObject *offsets_arr = NULL;
+    PyArrayObject *data_arr = NULL;
+    PyArrayObject *validity_arr = NULL;
+
+    offsets_arr =
+            (PyArrayObject *)PyArray_EMPTY(1, &num_offsets, NPY_INT64, 0);
+    if (offsets_arr == NULL) {
+        goto fail;
+    }
+    validity_arr =
+            (PyArrayObject *)PyArray_ZEROS(1, &bitmap_size, NPY_UINT8, 0);
+    if (validity_arr == NULL) {
+        goto fail;
+    }
+
+    npy_int64 *offsets = (npy_int64 *)PyArray_DATA(offsets_arr);
+    unsigned char *bitmap = (unsigned char *)PyArray_DATA(validity_arr);
+    offsets[0] = 0;
+
+    if (num == 0) {
+        npy_intp zero = 0;
+        data_arr = (PyArrayObject *)PyArray_EMPTY(1, &zero, NPY_UINT8, 0);
+        if (data_arr == NULL) {
+            goto fail;
+        }
+        Py_DECREF(validity_arr);
+        return Py_BuildValue("(NNO)", offsets_arr, data_arr, Py_None);
+    }
+
+    iter = NpyIter_New(arr,
+                       NPY_ITER_READONLY | NPY_ITER_EXTERNAL_LOOP |
+                               NPY_ITER_REFS_OK,
+                       NPY_CORDER, NPY_NO_CASTING, NULL);
+
+    if (iter == NULL) {
+        goto fail;
+    }
+
+    NpyIter_IterNextFunc *iternext = NpyIter_GetIterNext(iter, NULL);
+
+    if (iternext == NULL) {
+        goto fail;
+    }
+
+    // Each pass holds a read lock on the allocator, but the lock is released
+    // in between so the data array isn't created while it is held. The
+    // array may change while the lock is released, so the second pass checks
+    // the strings against the offsets and validity from the first pass and
+    // both passes are repeated if they don't match. So that a thread that
+    // keeps modifying the array can't make this go on forever, the last try
+    // holds the lock for both passes and copies the data to a temporary
+    // buffer, which doesn't need the GIL.
+    npy_intp num_null = 0;
+    int load_failed = 0;
+    int changed = 0;
+    for (int attempt = 0; attempt < TO_ARROW_MAX_RETRIES; attempt++) {
+        if (attempt > 0) {
+            memset(bitmap, 0, bitmap_size);
+            if (NpyIter_Reset(iter, NULL) != NPY_SUCCEED) {
+                goto fail;
+            }
+        }
+
+        npy_string_allocator *allocator =
+                NpyString_acquire_allocator_readonly(descr);
+        num_null = arrow_offsets(iter, iternext, offsets, bitmap);
+        NpyString_release_allocator_readonly(descr);
+
+        npy_intp data_size = (npy_intp)offsets[num];
+        if (data_arr == NULL || PyArray_DIM(data_arr, 0) != data_size) {
+            Py_XDECREF(data_arr);
+            data_arr = (PyArrayObject *)PyArray_EMPTY(1, &data_size,
+                                                      NPY_UINT8, 0);
+            if (data_arr == NULL) {
+                goto fail;
+            }
+        }
+
+        if (NpyIter_Reset(iter, NULL) != NPY_SUCCEED) {
+            goto fail;
+        }
+
+        NPY_BEGIN_THREADS_DEF;
+        NPY_BEGIN_THREADS;
+
+        allocator = NpyString_acquire_allocator_readonly(descr);
+        int res = arrow_copy(iter, iternext, allocator, offsets, bitmap,
+                             PyArray_BYTES(data_arr));
+        NpyString_release_allocator_readonly(descr);
+
+        NPY_END_THREADS;
+
+        load_failed = (res == -1);
+        changed = (res == 1);
+        if (!changed) {
+            break;
+        }
+    }
+
+    if (changed) {
+        memset(bitmap, 0, bitmap_size);
+        if (NpyIter_Reset(iter, NULL) != NPY_SUCCEED) {
+            goto fail;
+        }
+
+        char *buf = NULL;
+        char *errmsg = NULL;
+        int reset_failed = 0;
+
+        NPY_BEGIN_THREADS_DEF;
+        NPY_BEGIN_THREADS;
+
+        npy_string_allocator *allocator =
+                NpyString_acquire_allocator_readonly(descr);
+        num_null = arrow_offsets(iter, iternext, offsets, bitmap);
+        // one extra byte so an empty buffer is not a failed allocation
+        buf = PyMem_RawMalloc((size_t)offsets[num] + 1);
+        if (buf == NULL) {
+            load_failed = 1;
+        }
+        else if (NpyIter_Reset(iter, &errmsg) != NPY_SUCCEED) {
+            reset_failed = 1;
+        }
+        // nothing can change the strings while the lock is held
+        else if (arrow_copy(iter, iternext, allocator, offsets, bitmap,
+                            buf) != 0) {
+            load_failed = 1;
+        }
+        NpyString_release_allocator_readonly(descr);
+
+        NPY_END_THREADS;
+
+        if (reset_failed) {
+            PyMem_RawFree(buf);
+            PyErr_SetString(PyExc_RuntimeError, errmsg);
+            goto fail;
+        }
+
+        if (!load_failed) {
+            npy_intp data_size = (npy_intp)offsets[num];
+            Py_XDECREF(data_arr);
+            data_arr = (PyArrayObject *)PyArray_EMPTY(1, &data_size,
+                                                      NPY_UINT8, 0);
+            if (data_arr == NULL) {
+                PyMem_RawFree(buf);
+                goto fail;
+            }
+            memcpy(PyArray_BYTES(data_arr), buf, data_size);
+        }
+        PyMem_RawFree(buf);
+    }
+
+    if (load_failed) {
+        PyErr_SetString(PyExc_MemoryError,
+                        "Failed to load string in to_arrow_buffers");
+        goto fail;
+    }
+
+    NpyIter_Deallocate(iter);
+
+    if (num_null == 0) {
+        Py_DECREF(validity_arr);
+        return Py_BuildValue("(NNO)", offsets_arr, data_arr, Py_None);
+    }
+
+    return Py_BuildValue("(NNN)", offsets_arr, data_arr, validity_arr);
+
+fail:
+    if (iter != NULL) {
+        NpyIter_Deallocate(iter);
+    }
+    Py_XDECREF(offsets_arr);
+    Py_XDECREF(data_arr);
+    Py_XDECREF(validity_arr);
+    return NULL;
+}
@@ -0,0 +1,14 @@
+#ifndef _NPY_ARROW_H
+#define _NPY_ARROW_H
+
+#include <Python.h>
+
+// Build a StringDType array from Arrow-style string buffers
+PyObject *
+from_arrow_buffers(PyObject *self, PyObject *args, PyObject *kwds);
+
+// Copy the contents of a StringDType array into Arrow-style string buffers
+PyObject *
+to_arrow_buffers(PyObject *self, PyObject *obj);
+
+#endif /*_NPY_ARROW_H */
@@ -1,7 +1,10 @@
 #include "casts.h"
 
 #include "dtype.h"
+#include "hash_utils.h"
+#include "number_utils.h"
 #include "static_string.h"
+#include "utf8_utils.h"
 
 #define ANY_TO_STRING_RESOLVE_DESCRIPTORS(safety)                          \
     static NPY_CASTING any_to_string_##safety##_resolve_descriptors(       \
@@ -11,8 +14,8 @@
             npy_intp *NPY_UNUSED(view_offset))                             \
     {                                                                      \
         if (given_descrs[1] == NULL) {                                     \
-            PyArray_Descr *new =                                           \
-                    (PyArray_Descr *)new_stringdtype_instance(NULL, 1);    \
+            PyArray_Descr *new = (PyArray_Descr *)                         \
+                    new_stringdtype_instance(NULL, 1, NULL);               \
             if (new == NULL) {                                             \
                 return (NPY_CASTING)-1;                                    \
             }                                                              \
@@ -61,6 +64,11 @@ string_to_string_resolve_descriptors(PyObject *NPY_UNUSED(self),
         return NPY_UNSAFE_CASTING;
     }
 
+    if (descr0->backend != descr1->backend) {
+        // the strings have to be copied into the other allocator
+        return NPY_EQUIV_CASTING;
+    }
+
     *view_offset = 0;
 
     return NPY_NO_CASTING;
@@ -131,89 +139,25 @@ static char *s2s_name = "cast_StringDType_to_StringDType";
 
 // unicode to string
 
-// Find the number of bytes, *utf8_bytes*, needed to store the string
-// represented by *codepoints* in UTF-8. The array of *codepoints* is
-// *max_length* long, but may be padded with null codepoints. *num_codepoints*
-// is the number of codepoints that are not trailing null codepoints. Returns
-// 0 on success and -1 when an invalid code point is found.
+// Allocates a string of *size* bytes for the packed string at *out* and
+// sets *buf* to its buffer, which the caller must fill in. Returns -1 if the
+// allocation fails and 0 on success.
 static int
-utf8_size(const Py_UCS4 *codepoints, long max_length, size_t *num_codepoints,
-          size_t *utf8_bytes)
+new_string_buffer(char *out, size_t size, npy_string_allocator *allocator,
+                  char **buf)
 {
-    size_t ucs4len = max_length;
-
-    while (ucs4len > 0 && codepoints[ucs4len - 1] == 0) {
-        ucs4len--;
-    }
-    // ucs4len is now the number of codepoints that aren't trailing nulls.
-
-    size_t num_bytes = 0;
-
-    for (size_t i = 0; i < ucs4len; i++) {
-        Py_UCS4 code = codepoints[i];
-
-        if (code <= 0x7F) {
-            num_bytes += 1;
-        }
-        else if (code <= 0x07FF) {
-            num_bytes += 2;
-        }
-        else if (code <= 0xFFFF) {
-            if ((code >= 0xD800) && (code <= 0xDFFF)) {
-                // surrogates are invalid UCS4 code points
-                return -1;
-            }
-            num_bytes += 3;
-        }
-        else if (code <= 0x10FFFF) {
-            num_bytes += 4;
-        }
-        else {
-            // codepoint is outside the valid unicode range
-            return -1;
-        }
+    npy_packed_static_string *out_pss = (npy_packed_static_string *)out;
+    npy_static_string out_ss = {0, NULL};
+    if (NpyString_free(out_pss, allocator) < 0 ||
+        NpyString_newemptysize(size, out_pss, allocator) < 0 ||
+        NpyString_load(allocator, out_pss, &out_ss) < 0) {
+        return -1;
     }
-
-    *num_codepoints = ucs4len;
-    *utf8_bytes = num_bytes;
-
+    // explicitly discard const; initializing new buffer
+    *buf = (char *)out_ss.buf;
     return 0;
 }
 
-// Converts UCS4 code point *code* to 4-byte character array *c*. Assumes *c*
-// is a zero-filled 4 byte array and *code* is a valid codepoint and does not
-// do any error checking! Returns the number of bytes in the UTF-8 character.
-static size_t
-ucs4_code_to_utf8_char(const Py_UCS4 code, char *c)
-{
-    if (code <= 0x7F) {
-        // 0zzzzzzz -> 0zzzzzzz
-        c[0] = (char)code;
-        return 1;
-    }
-    else if (code <= 0x07FF) {
-        // 00000yyy yyzzzzzz -> 110yyyyy 10zzzzzz
-        c[0] = (0xC0 | (code >> 6));
-        c[1] = (0x80 | (code & 0x3F));
-        return 2;
-    }
-    else if (code <= 0xFFFF) {
-        // xxxxyyyy yyzzzzzz -> 110yyyyy 10zzzzzz
-        c[0] = (0xe0 | (code >> 12));
-        c[1] = (0x80 | ((code >> 6) & 0x3f));
-        c[2] = (0x80 | (code & 0x3f));
-        return 3;
-    }
-    else {
-        // 00wwwxx xxxxyyyy yyzzzzzz -> 11110www 10xxxxxx 10yyyyyy 10zzzzzz
-        c[0] = (0xf0 | (code >> 18));
-        c[1] = (0x80 | ((code >> 12) & 0x3f));
-        c[2] = (0x80 | ((code >> 6) & 0x3f));
-        c[3] = (0x80 | (code & 0x3f));
-        return 4;
-    }
-}
-
 static int
 unicode_to_string(PyArrayMethod_Context *context, char *const data[],
                   npy_intp const dimensions[], npy_intp const strides[],
@@ -234,54 +178,37 @@ unicode_to_string(PyArrayMethod_Context *context, char *const data[],
     npy_intp in_stride = strides[0] / 4;
     npy_intp out_stride = strides[1];
 
-    while (N--) {
+    // check all of the code points and reserve the arena memory for the
+    // whole loop before allocating anything
+    size_t arena_size = 0;
+    for (npy_intp i = 0; i < N; i++) {
         size_t out_num_bytes = 0;
         size_t num_codepoints = 0;
-        if (utf8_size(in, max_in_size, &num_codepoints, &out_num_bytes) ==
-            -1) {
+        if (ucs4_utf8_size(in + i * in_stride, max_in_size, &num_codepoints,
+                           &out_num_bytes) == -1) {
             gil_error(PyExc_TypeError, "Invalid unicode code point found");
             goto fail;
         }
-        npy_packed_static_string *out_pss = (npy_packed_static_string *)out;
-        if (NpyString_free(out_pss, allocator) < 0) {
-            gil_error(PyExc_MemoryError,
-                      "Failed to deallocate string in unicode to string cast");
-            goto fail;
-        }
-        if (NpyString_newemptysize(out_num_bytes, out_pss, allocator) < 0) {
+        arena_size += NpyString_arena_storage_size(out_num_bytes);
+    }
+    if (NpyString_arena_reserve(allocator, arena_size) < 0) {
+        gil_error(PyExc_MemoryError,
+                  "Failed to allocate string in unicode to string cast");
+        goto fail;
+    }
+
+    while (N--) {
+        size_t out_num_bytes = 0;
+        size_t num_codepoints = 0;
+        // already checked above
+        ucs4_utf8_size(in, max_in_size, &num_codepoints, &out_num_bytes);
+        char *out_buf = NULL;
+        if (new_string_buffer(out, out_num_bytes, allocator, &out_buf) < 0) {
             gil_error(PyExc_MemoryError,
                       "Failed to allocate string in unicode to string cast");
             goto fail;
         }
-        npy_static_string out_ss = {0, NULL};
-        int is_null = NpyString_load(allocator, out_pss, &out_ss);
-        if (is_null == -1) {
-            gil_error(PyExc_MemoryError,
-                      "Failed to load string in unicode to string cast");
-            goto fail;
-        }
-        // ignores const to fill in the buffer
-        char *out_buf = (char *)out_ss.buf;
-        for (size_t i = 0; i < num_codepoints; i++) {
-            // get code point
-            Py_UCS4 code = in[i];
-
-            // will be filled with UTF-8 bytes
-            char utf8_c[4] = {0};
-
-            // we already checked for invalid code points above,
-            // so no need to do error checking here
-            size_t num_bytes = ucs4_code_to_utf8_char(code, utf8_c);
-
-            // copy utf8_c into out_buf
-            strncpy(out_buf, utf8_c, num_bytes);
-
-            // increment out_buf by the size of the character
-            out_buf += num_bytes;
-        }
-
-        // reset out_buf to the beginning of the string
-        out_buf -= out_num_bytes;
+        ucs4_to_utf8(in, num_codepoints, out_buf);
 
         in += in_stride;
         out += out_stride;
@@ -335,48 +262,14 @@ string_to_unicode_resolve_descriptors(PyObject *NPY_UNUSED(self),
     return NPY_UNSAFE_CASTING;
 }
 
-// Given UTF-8 bytes in *c*, sets *code* to the corresponding unicode
-// codepoint for the next character, returning the size of the character in
-// bytes. Does not do any validation or error checking: assumes *c* is valid
-// utf-8
-size_t
-utf8_char_to_ucs4_code(unsigned char *c, size_t len, Py_UCS4 *code)
-{
-    if (len == 0) {
-        *code = (Py_UCS4)0;
-        return 0;
-    }
-    if (c[0] <= 0x7F) {
-        // 0zzzzzzz -> 0zzzzzzz
-        *code = (Py_UCS4)(c[0]);
-        return 1;
-    }
-    else if (c[0] <= 0xDF) {
-        // 110yyyyy 10zzzzzz -> 00000yyy yyzzzzzz
-        *code = (Py_UCS4)(((c[0] << 6) + c[1]) - ((0xC0 << 6) + 0x80));
-        return 2;
-    }
-    else if (c[0] <= 0xEF) {
-        // 1110xxxx 10yyyyyy 10zzzzzz -> xxxxyyyy yyzzzzzz
-        *code = (Py_UCS4)(((c[0] << 12) + (c[1] << 6) + c[2]) -
-                          ((0xE0 << 12) + (0x80 << 6) + 0x80));
-        return 3;
-    }
-    else {
-        // 11110www 10xxxxxx 10yyyyyy 10zzzzzz -> 000wwwxx xxxxyyyy yyzzzzzz
-        *code = (Py_UCS4)(((c[0] << 18) + (c[1] << 12) + (c[2] << 6) + c[3]) -
-                          ((0xF0 << 18) + (0x80 << 12) + (0x80 << 6) + 0x80));
-        return 4;
-    }
-}
-
 static int
 string_to_unicode(PyArrayMethod_Context *context, char *const data[],
                   npy_intp const dimensions[], npy_intp const strides[],
                   NpyAuxData *NPY_UNUSED(auxdata))
 {
     StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
-    npy_string_allocator *allocator = NpyString_acquire_allocator(descr);
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
     int has_null = descr->na_object != NULL;
     int has_string_na = descr->has_string_na;
     const npy_static_string *default_string = &descr->default_string;
@@ -394,8 +287,6 @@ string_to_unicode(PyArrayMethod_Context *context, char *const data[],
         const npy_packed_static_string *ps = (npy_packed_static_string *)in;
         npy_static_string s = {0, NULL};
         npy_static_string name = {0, NULL};
-        unsigned char *this_string = NULL;
-        size_t n_bytes;
         int is_null = NpyString_load(allocator, ps, &s);
         if (is_null == -1) {
             gil_error(PyExc_MemoryError,
@@ -415,40 +306,22 @@ string_to_unicode(PyArrayMethod_Context *context, char *const data[],
             name = s;
         }
 
-        this_string = (unsigned char *)(name.buf);
-        n_bytes = name.size;
-        size_t tot_n_bytes = 0;
-
-        for (int i = 0; i < max_out_size; i++) {
-            Py_UCS4 code;
-
-            // code point for character this_string is currently pointing at
-            size_t num_bytes =
-                    utf8_char_to_ucs4_code(this_string, n_bytes, &code);
-
-            // move to next character
-            this_string += num_bytes;
-            tot_n_bytes += num_bytes;
-
-            // set output codepoint
-            out[i] = code;
-
-            // stop if we've exhausted the input string
-            if (tot_n_bytes >= n_bytes) {
-                break;
-            }
-        }
+        size_t num_codepoints =
+                utf8_to_ucs4(name.buf, name.size, out, max_out_size);
+        // zero out the rest of the output
+        memset(out + num_codepoints, 0,
+               (max_out_size - num_codepoints) * sizeof(Py_UCS4));
 
         in += in_stride;
         out += out_stride;
     }
 
-    NpyString_release_allocator(descr);
+    NpyString_release_allocator_readonly(descr);
 
     return 0;
 
 fail:
-    NpyString_release_allocator(descr);
+    NpyString_release_allocator_readonly(descr);
 
     return -1;
 }
@@ -489,7 +362,8 @@ string_to_bool(PyArrayMethod_Context *context, char *const data[],
                NpyAuxData *NPY_UNUSED(auxdata))
 {
     StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
-    npy_string_allocator *allocator = NpyString_acquire_allocator(descr);
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
     int has_null = descr->na_object != NULL;
     int has_string_na = descr->has_string_na;
     const npy_static_string *default_string = &descr->default_string;
@@ -530,13 +404,13 @@ string_to_bool(PyArrayMethod_Context *context, char *const data[],
         out += out_stride;
     }
 
-    NpyString_release_allocator(descr);
+    NpyString_release_allocator_readonly(descr);
 
     return 0;
 
 fail:
 
-    NpyString_release_allocator(descr);
+    NpyString_release_allocator_readonly(descr);
 
     return -1;
 }
@@ -611,120 +485,204 @@ static char *b2s_name = "cast_Bool_to_StringDType";
 
 // casts between string and (u)int dtypes
 
-static PyObject *
-string_to_pylong(char *in, int hasnull,
-                 const npy_static_string *default_string,
-                 npy_string_allocator *allocator)
+// Loads the string to convert to an integer, substituting the default
+// string for missing data if the dtype has no na_object.
+static int
+load_integer_string(char *in, int hasnull,
+                    const npy_static_string *default_string,
+                    npy_string_allocator *allocator, npy_static_string *s)
 {
     const npy_packed_static_string *ps = (npy_packed_static_string *)in;
-    npy_static_string s = {0, NULL};
-    int isnull = NpyString_load(allocator, ps, &s);
+    int isnull = NpyString_load(allocator, ps, s);
     if (isnull == -1) {
-        PyErr_SetString(PyExc_MemoryError,
-                        "Failed to load string converting string to int");
-        return NULL;
+        gil_error(PyExc_MemoryError,
+                  "Failed to load string converting string to int");
+        return -1;
     }
     else if (isnull) {
         if (hasnull) {
-            PyErr_SetString(PyExc_ValueError,
-                            "Arrays with missing data cannot be converted to "
-                            "integers");
-            return NULL;
+            gil_error(PyExc_ValueError,
+                      "Arrays with missing data cannot be converted to "
+                      "integers");
+            return -1;
         }
-        s = *default_string;
-    }
-    PyObject *val_obj = PyUnicode_FromStringAndSize(s.buf, s.size);
-    if (val_obj == NULL) {
-        return NULL;
+        *s = *default_string;
     }
-    // interpret as an integer in base 10
-    PyObject *pylong_value = PyLong_FromUnicodeObject(val_obj, 10);
-    Py_DECREF(val_obj);
-    return pylong_value;
+    return 0;
 }
 
-static npy_longlong
-string_to_uint(char *in, npy_ulonglong *value, int hasnull,
-               const npy_static_string *default_string,
-               npy_string_allocator *allocator)
+// Converts a python str to a number, storing it in *value*. Called with
+// the GIL held.
+typedef int (*py_number_converter)(PyObject *str, void *value);
+
+static int
+pystr_to_ulonglong(PyObject *str, void *value)
 {
-    PyObject *pylong_value =
-            string_to_pylong(in, hasnull, default_string, allocator);
+    // interpret as an integer in base 10
+    PyObject *pylong_value = PyLong_FromUnicodeObject(str, 10);
     if (pylong_value == NULL) {
         return -1;
     }
-    *value = PyLong_AsUnsignedLongLong(pylong_value);
-    if (*value == (unsigned long long)-1 && PyErr_Occurred()) {
-        Py_DECREF(pylong_value);
+    npy_ulonglong ret = PyLong_AsUnsignedLongLong(pylong_value);
+    Py_DECREF(pylong_value);
+    if (ret == (unsigned long long)-1 && PyErr_Occurred()) {
         return -1;
     }
-    Py_DECREF(pylong_value);
+    *(npy_ulonglong *)value = ret;
     return 0;
 }
 
-static npy_longlong
-string_to_int(char *in, npy_longlong *value, int hasnull,
-              const npy_static_string *default_string,
-              npy_string_allocator *allocator)
+static int
+pystr_to_longlong(PyObject *str, void *value)
 {
-    PyObject *pylong_value =
-            string_to_pylong(in, hasnull, default_string, allocator);
+    PyObject *pylong_value = PyLong_FromUnicodeObject(str, 10);
     if (pylong_value == NULL) {
         return -1;
     }
-    *value = PyLong_AsLongLong(pylong_value);
-    if (*value == -1 && PyErr_Occurred()) {
-        Py_DECREF(pylong_value);
+    npy_longlong ret = PyLong_AsLongLong(pylong_value);
+    Py_DECREF(pylong_value);
+    if (ret == -1 && PyErr_Occurred()) {
         return -1;
     }
-    Py_DECREF(pylong_value);
+    *(npy_longlong *)value = ret;
     return 0;
 }
 
 static int
-pyobj_to_string(PyObject *obj, char *out, npy_string_allocator *allocator)
+pystr_to_double(PyObject *str, void *value)
 {
-    if (obj == NULL) {
+    PyObject *pyfloat_value = PyFloat_FromString(str);
+    if (pyfloat_value == NULL) {
         return -1;
     }
-    PyObject *pystr_val = PyObject_Str(obj);
-    Py_DECREF(obj);
+    *(double *)value = PyFloat_AS_DOUBLE(pyfloat_value);
+    Py_DECREF(pyfloat_value);
+    return 0;
+}
 
-    if (pystr_val == NULL) {
-        return -1;
+// Converts *s* with *convert*, for strings the native parsers don't
+// handle. A thread holding the GIL may be blocked waiting for the
+// allocator of *descr*, so the string is copied and the read lock the
+// caller holds is released before taking the GIL, then re-acquired.
+static int
+convert_with_python(StringDTypeObject *descr, const npy_static_string *s,
+                    py_number_converter convert, void *value)
+{
+    size_t size = s->size;
+    char *copy = PyMem_RawMalloc(size + 1);
+    if (copy != NULL) {
+        memcpy(copy, s->buf, size);
     }
-    Py_ssize_t length;
-    const char *cstr_val = PyUnicode_AsUTF8AndSize(pystr_val, &length);
-    if (cstr_val == NULL) {
-        Py_DECREF(pystr_val);
+    NpyString_release_allocator_readonly(descr);
+
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    int ret = -1;
+    if (copy == NULL) {
+        PyErr_NoMemory();
+    }
+    else {
+        PyObject *val_obj = PyUnicode_FromStringAndSize(copy, size);
+        if (val_obj != NULL) {
+            ret = convert(val_obj, value);
+            Py_DECREF(val_obj);
+        }
+    }
+    PyGILState_Release(gstate);
+
+    PyMem_RawFree(copy);
+    NpyString_acquire_allocator_readonly(descr);
+    return ret;
+}
+
+static npy_longlong
+string_to_uint(char *in, npy_ulonglong *value, int hasnull,
+               const npy_static_string *default_string,
+               StringDTypeObject *descr, npy_string_allocator *allocator)
+{
+    npy_static_string s = {0, NULL};
+    if (load_integer_string(in, hasnull, default_string, allocator, &s) < 0) {
         return -1;
     }
-    npy_packed_static_string *out_ss = (npy_packed_static_string *)out;
-    if (NpyString_pack(allocator, out_ss, cstr_val, length) < 0) {
-        gil_error(PyExc_MemoryError,
-                  "Failed to pack string while converting from python "
-                  "string");
-        Py_DECREF(pystr_val);
+    uint64_t magnitude;
+    int negative;
+    // strings the native parser can't handle and negative values go through
+    // python so the error messages match int()
+    if (parse_base10_integer(s.buf, s.size, &magnitude, &negative) == 0 &&
+        (!negative || magnitude == 0)) {
+        *value = (npy_ulonglong)magnitude;
+        return 0;
+    }
+    return convert_with_python(descr, &s, pystr_to_ulonglong, value);
+}
+
+static npy_longlong
+string_to_int(char *in, npy_longlong *value, int hasnull,
+              const npy_static_string *default_string,
+              StringDTypeObject *descr, npy_string_allocator *allocator)
+{
+    npy_static_string s = {0, NULL};
+    if (load_integer_string(in, hasnull, default_string, allocator, &s) < 0) {
         return -1;
     }
-    // implicitly deallocates cstr_val as well
-    Py_DECREF(pystr_val);
-    return 0;
+    uint64_t magnitude;
+    int negative;
+    if (parse_base10_integer(s.buf, s.size, &magnitude, &negative) == 0) {
+        if (!negative && magnitude <= (uint64_t)NPY_MAX_LONGLONG) {
+            *value = (npy_longlong)magnitude;
+            return 0;
+        }
+        else if (negative && magnitude == 0) {
+            *value = 0;
+            return 0;
+        }
+        else if (negative && magnitude <= (uint64_t)NPY_MAX_LONGLONG + 1) {
+            // magnitude - 1 fits in an npy_longlong even for -2**63
+            *value = -(npy_longlong)(magnitude - 1) - 1;
+            return 0;
+        }
+    }
+    return convert_with_python(descr, &s, pystr_to_longlong, value);
+}
+
+static size_t
+int_arena_size(long long in)
+{
+    return NpyString_arena_storage_size(int64_repr_size(in));
+}
+
+static size_t
+uint_arena_size(unsigned long long in)
+{
+    return NpyString_arena_storage_size(uint64_repr_size(in));
 }
 
 static int
 int_to_string(long long in, char *out, npy_string_allocator *allocator)
 {
-    PyObject *pylong_val = PyLong_FromLongLong(in);
-    return pyobj_to_string(pylong_val, out, allocator);
+    size_t size = int64_repr_size(in);
+    char *buf = NULL;
+    if (new_string_buffer(out, size, allocator, &buf) < 0) {
+        gil_error(PyExc_MemoryError,
+                  "Failed to allocate string in integer to string cast");
+        return -1;
+    }
+    write_int64(in, size, buf);
+    return 0;
 }
 
 static int
 uint_to_string(unsigned long long in, char *out,
                npy_string_allocator *allocator)
 {
-    PyObject *pylong_val = PyLong_FromUnsignedLongLong(in);
-    return pyobj_to_string(pylong_val, out, allocator);
+    size_t size = uint64_repr_size(in);
+    char *buf = NULL;
+    if (new_string_buffer(out, size, allocator, &buf) < 0) {
+        gil_error(PyExc_MemoryError,
+                  "Failed to allocate string in integer to string cast");
+        return -1;
+    }
+    write_uint64(in, size, buf);
+    return 0;
 }
 
 #define STRING_INT_CASTS(typename, typekind, shortname, numpy_tag,            \
@@ -756,7 +714,8 @@ uint_to_string(unsigned long long in, char *out,
     {                                                                         \
         StringDTypeObject *descr =                                            \
                 ((StringDTypeObject *)context->descriptors[0]);               \
-        npy_string_allocator *allocator = NpyString_acquire_allocator(descr); \
+        npy_string_allocator *allocator =                                     \
+                NpyString_acquire_allocator_readonly(descr);                  \
         int hasnull = descr->na_object != NULL;                               \
         const npy_static_string *default_string = &descr->default_string;     \
                                                                               \
@@ -770,7 +729,7 @@ uint_to_string(unsigned long long in, char *out,
         while (N--) {                                                         \
             npy_longtype value;                                               \
             if (string_to_##typekind(in, &value, hasnull, default_string,     \
-                                     allocator) != 0) {                       \
+                                     descr, allocator) != 0) {                \
                 goto fail;                                                    \
             }                                                                 \
             *out = (npy_##typename)value;                                     \
@@ -789,11 +748,11 @@ uint_to_string(unsigned long long in, char *out,
             out += out_stride;                                                \
         }                                                                     \
                                                                               \
-        NpyString_release_allocator(descr);                                   \
+        NpyString_release_allocator_readonly(descr);                          \
         return 0;                                                             \
                                                                               \
     fail:                                                                     \
-        NpyString_release_allocator(descr);                                   \
+        NpyString_release_allocator_readonly(descr);                          \
         return -1;                                                            \
     }                                                                         \
                                                                               \
@@ -821,6 +780,18 @@ uint_to_string(unsigned long long in, char *out,
                 (StringDTypeObject *)context->descriptors[1];                 \
         npy_string_allocator *allocator = NpyString_acquire_allocator(descr); \
                                                                               \
+        /* the output lengths are cheap to compute, so find out how much */   \
+        /* arena memory the loop needs and reserve it all at once */          \
+        size_t arena_size = 0;                                                \
+        for (npy_intp i = 0; i < N; i++) {                                    \
+            arena_size += typekind##_arena_size((longtype)in[i * in_stride]); \
+        }                                                                     \
+        if (NpyString_arena_reserve(allocator, arena_size) < 0) {             \
+            gil_error(PyExc_MemoryError,                                      \
+                      "Failed to allocate string in integer to string cast"); \
+            goto fail;                                                        \
+        }                                                                     \
+                                                                              \
         while (N--) {                                                         \
             if (typekind##_to_string((longtype)*in, out, allocator) != 0) {   \
                 goto fail;                                                    \
@@ -846,21 +817,21 @@ uint_to_string(unsigned long long in, char *out,
                                                                               \
     static char *shortname##2s_name = "cast_" #typename "_to_StringDType";
 
-#define DTYPES_AND_CAST_SPEC(shortname, typename)                            \
+#define DTYPES_AND_CAST_SPEC(shortname, typename, s2x_flags, x2s_flags)     \
     PyArray_DTypeMeta **s2##shortname##_dtypes = get_dtypes(                 \
             (PyArray_DTypeMeta *)&StringDType, &PyArray_##typename##DType);  \
                                                                              \
     PyArrayMethod_Spec *StringTo##typename##CastSpec =                       \
             get_cast_spec(s2##shortname##_name, NPY_UNSAFE_CASTING,          \
-                          NPY_METH_REQUIRES_PYAPI, s2##shortname##_dtypes,   \
+                          s2x_flags, s2##shortname##_dtypes,                 \
                           s2##shortname##_slots);                            \
                                                                              \
     PyArray_DTypeMeta **shortname##2s_dtypes = get_dtypes(                   \
             &PyArray_##typename##DType, (PyArray_DTypeMeta *)&StringDType);  \
                                                                              \
-    PyArrayMethod_Spec *typename##ToStringCastSpec = get_cast_spec(          \
-            shortname##2s_name, NPY_UNSAFE_CASTING, NPY_METH_REQUIRES_PYAPI, \
-            shortname##2s_dtypes, shortname##2s_slots);
+    PyArrayMethod_Spec *typename##ToStringCastSpec =                         \
+            get_cast_spec(shortname##2s_name, NPY_UNSAFE_CASTING, x2s_flags, \
+                          shortname##2s_dtypes, shortname##2s_slots);
 
 STRING_INT_CASTS(int8, int, i8, NPY_INT8, lli, npy_longlong, long long)
 STRING_INT_CASTS(int16, int, i16, NPY_INT16, lli, npy_longlong, long long)
@@ -901,36 +872,34 @@ STRING_INT_CASTS(ulonglong, uint, ulonglong, NPY_ULONGLONG, llu, npy_ulonglong,
                  unsigned long long)
 #endif
 
-static PyObject *
-string_to_pyfloat(char *in, int hasnull,
-                  const npy_static_string *default_string,
-                  npy_string_allocator *allocator)
+// Converts a string to a double without the GIL, falling back to float()
+// for strings the native parser doesn't handle.
+static int
+string_to_double(char *in, double *value, int hasnull,
+                 const npy_static_string *default_string,
+                 StringDTypeObject *descr, npy_string_allocator *allocator)
 {
     const npy_packed_static_string *ps = (npy_packed_static_string *)in;
     npy_static_string s = {0, NULL};
     int isnull = NpyString_load(allocator, ps, &s);
     if (isnull == -1) {
-        PyErr_SetString(
-                PyExc_MemoryError,
-                "Failed to load string while converting string to float");
-        return NULL;
+        gil_error(PyExc_MemoryError,
+                  "Failed to load string while converting string to float");
+        return -1;
     }
     if (isnull) {
         if (hasnull) {
-            PyErr_SetString(PyExc_ValueError,
-                            "Arrays with missing data cannot be converted to "
-                            "integers");
-            return NULL;
+            gil_error(PyExc_ValueError,
+                      "Arrays with missing data cannot be converted to "
+                      "integers");
+            return -1;
         }
         s = *default_string;
     }
-    PyObject *val_obj = PyUnicode_FromStringAndSize(s.buf, s.size);
-    if (val_obj == NULL) {
-        return NULL;
+    if (parse_double(s.buf, s.size, value) == 0) {
+        return 0;
     }
-    PyObject *pyfloat_value = PyFloat_FromString(val_obj);
-    Py_DECREF(val_obj);
-    return pyfloat_value;
+    return convert_with_python(descr, &s, pystr_to_double, value);
 }
 
 #define STRING_TO_FLOAT_CAST(typename, shortname, isinf_name,                 \
@@ -942,7 +911,8 @@ string_to_pyfloat(char *in, int hasnull,
     {                                                                         \
         StringDTypeObject *descr =                                            \
                 (StringDTypeObject *)context->descriptors[0];                 \
-        npy_string_allocator *allocator = NpyString_acquire_allocator(descr); \
+        npy_string_allocator *allocator =                                     \
+                NpyString_acquire_allocator_readonly(descr);                  \
         int hasnull = (descr->na_object != NULL);                             \
         const npy_static_string *default_string = &descr->default_string;     \
                                                                               \
@@ -954,19 +924,16 @@ string_to_pyfloat(char *in, int hasnull,
         npy_intp out_stride = strides[1] / sizeof(npy_##typename);            \
                                                                               \
         while (N--) {                                                         \
-            PyObject *pyfloat_value = string_to_pyfloat(                      \
-                    in, hasnull, default_string, allocator);                  \
-            if (pyfloat_value == NULL) {                                      \
+            double dval;                                                      \
+            if (string_to_double(in, &dval, hasnull, default_string,          \
+                                 descr, allocator) < 0) {                     \
                 goto fail;                                                    \
             }                                                                 \
-            double dval = PyFloat_AS_DOUBLE(pyfloat_value);                   \
             npy_##typename fval = (double_to_float)(dval);                    \
                                                                               \
+            /* numpy checks the flag and warns after the loop */              \
             if (NPY_UNLIKELY(isinf_name(fval) && !(npy_isinf(dval)))) {       \
-                if (PyUFunc_GiveFloatingpointErrors("cast",                   \
-                                                    NPY_FPE_OVERFLOW) < 0) {  \
-                    goto fail;                                                \
-                }                                                             \
+                npy_set_floatstatus_overflow();                               \
             }                                                                 \
                                                                               \
             *out = fval;                                                      \
@@ -975,10 +942,10 @@ string_to_pyfloat(char *in, int hasnull,
             out += out_stride;                                                \
         }                                                                     \
                                                                               \
-        NpyString_release_allocator(descr);                                   \
+        NpyString_release_allocator_readonly(descr);                          \
         return 0;                                                             \
     fail:                                                                     \
-        NpyString_release_allocator(descr);                                   \
+        NpyString_release_allocator_readonly(descr);                          \
         return -1;                                                            \
     }                                                                         \
                                                                               \
@@ -1011,7 +978,7 @@ string_to_pyfloat(char *in, int hasnull,
         return NPY_UNSAFE_CASTING;                                         \
     }
 
-#define FLOAT_TO_STRING_CAST(typename, shortname, float_to_double)            \
+#define FLOAT_TO_STRING_CAST(typename, shortname, format_func)                \
     static int typename##_to_string(                                          \
             PyArrayMethod_Context *context, char *const data[],               \
             npy_intp const dimensions[], npy_intp const strides[],            \
@@ -1020,7 +987,6 @@ string_to_pyfloat(char *in, int hasnull,
         npy_intp N = dimensions[0];                                           \
         npy_##typename *in = (npy_##typename *)data[0];                       \
         char *out = data[1];                                                  \
-        PyArray_Descr *float_descr = context->descriptors[0];                 \
                                                                               \
         npy_intp in_stride = strides[0] / sizeof(npy_##typename);             \
         npy_intp out_stride = strides[1];                                     \
@@ -1030,8 +996,14 @@ string_to_pyfloat(char *in, int hasnull,
         npy_string_allocator *allocator = NpyString_acquire_allocator(descr); \
                                                                               \
         while (N--) {                                                         \
-            PyObject *scalar_val = PyArray_Scalar(in, float_descr, NULL);     \
-            if (pyobj_to_string(scalar_val, out, allocator) == -1) {          \
+            char buf[FLOAT_REPR_BUFSIZE];                                     \
+            int len = format_func(*in, buf);                                  \
+            npy_packed_static_string *out_ss =                                \
+                    (npy_packed_static_string *)out;                          \
+            if (NpyString_pack(allocator, out_ss, buf, len) < 0) {            \
+                gil_error(PyExc_MemoryError,                                  \
+                          "Failed to pack string while converting from "      \
+                          "float");                                           \
                 goto fail;                                                    \
             }                                                                 \
                                                                               \
@@ -1055,60 +1027,16 @@ string_to_pyfloat(char *in, int hasnull,
     static char *shortname##2s_name = "cast_" #typename "_to_StringDType";
 
 STRING_TO_FLOAT_RESOLVE_DESCRIPTORS(float64, DOUBLE)
-
-static int
-string_to_float64(PyArrayMethod_Context *context, char *const data[],
-                  npy_intp const dimensions[], npy_intp const strides[],
-                  NpyAuxData *NPY_UNUSED(auxdata))
-{
-    StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
-    npy_string_allocator *allocator = NpyString_acquire_allocator(descr);
-    int hasnull = descr->na_object != NULL;
-    const npy_static_string *default_string = &descr->default_string;
-    npy_intp N = dimensions[0];
-    char *in = data[0];
-    npy_float64 *out = (npy_float64 *)data[1];
-
-    npy_intp in_stride = strides[0];
-    npy_intp out_stride = strides[1] / sizeof(npy_float64);
-
-    while (N--) {
-        PyObject *pyfloat_value =
-                string_to_pyfloat(in, hasnull, default_string, allocator);
-        if (pyfloat_value == NULL) {
-            goto fail;
-        }
-        *out = (npy_float64)PyFloat_AS_DOUBLE(pyfloat_value);
-        Py_DECREF(pyfloat_value);
-
-        in += in_stride;
-        out += out_stride;
-    }
-
-    NpyString_release_allocator(descr);
-    return 0;
-
-fail:
-    NpyString_release_allocator(descr);
-    return -1;
-}
-
-static PyType_Slot s2f64_slots[] = {
-        {NPY_METH_resolve_descriptors, &string_to_float64_resolve_descriptors},
-        {NPY_METH_strided_loop, &string_to_float64},
-        {0, NULL}};
-
-static char *s2f64_name = "cast_StringDType_to_float64";
-
-FLOAT_TO_STRING_CAST(float64, f64, double)
+STRING_TO_FLOAT_CAST(float64, f64, npy_isinf, npy_float64)
+FLOAT_TO_STRING_CAST(float64, f64, format_float64)
 
 STRING_TO_FLOAT_RESOLVE_DESCRIPTORS(float32, FLOAT)
 STRING_TO_FLOAT_CAST(float32, f32, npy_isinf, npy_float32)
-FLOAT_TO_STRING_CAST(float32, f32, double)
+FLOAT_TO_STRING_CAST(float32, f32, format_float32)
 
 STRING_TO_FLOAT_RESOLVE_DESCRIPTORS(float16, HALF)
 STRING_TO_FLOAT_CAST(float16, f16, npy_half_isinf, npy_double_to_half)
-FLOAT_TO_STRING_CAST(float16, f16, npy_half_to_double)
+FLOAT_TO_STRING_CAST(float16, f16, format_float16)
 
 // string to datetime
 
@@ -1135,13 +1063,202 @@ string_to_datetime_resolve_descriptors(
     return NPY_UNSAFE_CASTING;
 }
 
+// Returns 1 if *c* is not an ASCII digit and 0 otherwise, without branching
+// so that the checks for all of the digits in a timestamp can be combined.
+static inline unsigned int
+not_digit(unsigned char c)
+{
+    return (unsigned int)(c - '0') > 9;
+}
+
+static inline int
+two_digits(const unsigned char *s)
+{
+    return (s[0] - '0') * 10 + (s[1] - '0');
+}
+
+static int
+days_in_month(npy_int64 year, int month)
+{
+    static const int days[12] = {31, 28, 31, 30, 31, 30,
+                                 31, 31, 30, 31, 30, 31};
+    if (month == 2 &&
+        (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))) {
+        return 29;
+    }
+    return days[month - 1];
+}
+
+// Returns the number of days between 1970-01-01 and the given date in the
+// proleptic Gregorian calendar
+static npy_int64
+days_from_civil(npy_int64 year, int month, int day)
+{
+    year -= month <= 2;
+    npy_int64 era = (year >= 0 ? year : year - 399) / 400;
+    npy_int64 year_of_era = year - era * 400;
+    npy_int64 month_index = month > 2 ? month - 3 : month + 9;
+    npy_int64 day_of_year = (153 * month_index + 2) / 5 + day - 1;
+    npy_int64 day_of_era = year_of_era * 365 + year_of_era / 4 -
+                           year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// The inverse of days_from_civil
+static void
+civil_from_days(npy_int64 days, npy_datetimestruct *dts)
+{
+    days += 719468;
+    npy_int64 era = (days >= 0 ? days : days - 146096) / 146097;
+    npy_int64 day_of_era = days - era * 146097;
+    npy_int64 year_of_era =
+            (day_of_era - day_of_era / 1460 + day_of_era / 36524 -
+             day_of_era / 146096) /
+            365;
+    npy_int64 day_of_year =
+            day_of_era - (365 * year_of_era + year_of_era / 4 -
+                          year_of_era / 100);
+    npy_int64 mp = (5 * day_of_year + 2) / 153;
+    dts->day = (npy_int32)(day_of_year - (153 * mp + 2) / 5 + 1);
+    dts->month = (npy_int32)(mp < 10 ? mp + 3 : mp - 9);
+    dts->year = year_of_era + era * 400 + (dts->month <= 2);
+}
+
+// Nanoseconds per unit for the units between days and nanoseconds, and 0
+// for all other units
+static npy_int64
+nanoseconds_per_unit(NPY_DATETIMEUNIT base)
+{
+    switch (base) {
+        case NPY_FR_D:
+            return 86400000000000LL;
+        case NPY_FR_h:
+            return 3600000000000LL;
+        case NPY_FR_m:
+            return 60000000000LL;
+        case NPY_FR_s:
+            return 1000000000LL;
+        case NPY_FR_ms:
+            return 1000000LL;
+        case NPY_FR_us:
+            return 1000LL;
+        case NPY_FR_ns:
+            return 1LL;
+        default:
+            return 0;
+    }
+}
+
+// Like NpyDatetime_ConvertDatetimeStructToDatetime64, but only for the
+// units between days and nanoseconds. Overflows wrap around the same way.
+// Returns -1 for other units.
+static int
+struct_to_datetime64_fast(const npy_datetimestruct *dts,
+                          NPY_DATETIMEUNIT base, npy_datetime *out)
+{
+    npy_int64 per_unit = nanoseconds_per_unit(base);
+    if (per_unit == 0) {
+        return -1;
+    }
+    // unsigned arithmetic, so that overflows are well defined
+    npy_uint64 value =
+            (npy_uint64)days_from_civil(dts->year, dts->month, dts->day);
+    if (base != NPY_FR_D) {
+        value = value * 24 + dts->hour;
+    }
+    if (base != NPY_FR_D && base != NPY_FR_h) {
+        value = value * 60 + dts->min;
+    }
+    if (per_unit <= 1000000000LL) {
+        value = value * 60 + dts->sec;
+    }
+    if (base == NPY_FR_ms) {
+        value = value * 1000 + dts->us / 1000;
+    }
+    else if (base == NPY_FR_us) {
+        value = value * 1000000 + dts->us;
+    }
+    else if (base == NPY_FR_ns) {
+        value = (value * 1000000 + dts->us) * 1000 + dts->ps / 1000;
+    }
+    *out = (npy_datetime)value;
+    return 0;
+}
+
+// Parses the timestamp layouts found in most data files, YYYY-MM-DD and
+// YYYY-MM-DDTHH:MM:SS with up to nine digits of fractional seconds, into
+// *dts*. The date and the time may also be separated by a space. The layout
+// is determined by the length of the string. Returns 0 on success and -1 if
+// the string has a different layout or holds an invalid date or time, in
+// which case numpy's parser should handle it.
+static int
+parse_iso8601_fast(const char *buf, size_t len, npy_datetimestruct *dts)
+{
+    static const int date_digits[8] = {0, 1, 2, 3, 5, 6, 8, 9};
+    static const int time_digits[6] = {11, 12, 14, 15, 17, 18};
+    const unsigned char *s = (const unsigned char *)buf;
+
+    if (len != 10 && len != 19 && (len < 21 || len > 29)) {
+        return -1;
+    }
+    unsigned int invalid = (s[4] != '-') | (s[7] != '-');
+    for (int i = 0; i < 8; i++) {
+        invalid |= not_digit(s[date_digits[i]]);
+    }
+    if (len > 10) {
+        invalid |= (s[10] != 'T' && s[10] != ' ') | (s[13] != ':') |
+                   (s[16] != ':');
+        for (int i = 0; i < 6; i++) {
+            invalid |= not_digit(s[time_digits[i]]);
+        }
+    }
+    if (len > 19) {
+        invalid |= (s[19] != '.');
+        for (size_t i = 20; i < len; i++) {
+            invalid |= not_digit(s[i]);
+        }
+    }
+    if (invalid) {
+        return -1;
+    }
+
+    memset(dts, 0, sizeof(npy_datetimestruct));
+    dts->year = two_digits(s) * 100 + two_digits(s + 2);
+    dts->month = two_digits(s + 5);
+    dts->day = two_digits(s + 8);
+    if (dts->month < 1 || dts->month > 12 || dts->day < 1 ||
+        dts->day > days_in_month(dts->year, dts->month)) {
+        return -1;
+    }
+    if (len > 10) {
+        dts->hour = two_digits(s + 11);
+        dts->min = two_digits(s + 14);
+        dts->sec = two_digits(s + 17);
+        if (dts->hour > 23 || dts->min > 59 || dts->sec > 59) {
+            return -1;
+        }
+    }
+    if (len > 19) {
+        // pad the fraction to nine digits, the first six are microseconds
+        // and the rest are the leading digits of the picoseconds
+        npy_int32 fraction = 0;
+        for (size_t i = 20; i < 29; i++) {
+            fraction = fraction * 10 + (i < len ? s[i] - '0' : 0);
+        }
+        dts->us = fraction / 1000;
+        dts->ps = (fraction % 1000) * 1000;
+    }
+    return 0;
+}
+
 static int
 string_to_datetime(PyArrayMethod_Context *context, char *const data[],
                    npy_intp const dimensions[], npy_intp const strides[],
                    NpyAuxData *NPY_UNUSED(auxdata))
 {
     StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
-    npy_string_allocator *allocator = NpyString_acquire_allocator(descr);
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
     int has_null = descr->na_object != NULL;
     int has_string_na = descr->has_string_na;
     const npy_static_string *default_string = &descr->default_string;
@@ -1167,8 +1284,8 @@ string_to_datetime(PyArrayMethod_Context *context, char *const data[],
         npy_static_string s = {0, NULL};
         int is_null = NpyString_load(allocator, ps, &s);
         if (is_null == -1) {
-            // do we hold the gil in this cast? error handling below seems to
-            // think we do
+            // this cast holds the GIL, the numpy datetime functions set
+            // python exceptions
             PyErr_SetString(
                     PyExc_MemoryError,
                     "Failed to load string in string to datetime cast");
@@ -1181,13 +1298,29 @@ string_to_datetime(PyArrayMethod_Context *context, char *const data[],
             }
             s = *default_string;
         }
-        if (NpyDatetime_ParseISO8601Datetime(
-                    (const char *)s.buf, s.size, in_unit, NPY_UNSAFE_CASTING,
-                    &dts, &in_meta.base, &out_special) < 0) {
-            goto fail;
+        int fast = parse_iso8601_fast(s.buf, s.size, &dts) == 0;
+        if (!fast) {
+            // numpy's error messages read the string up to a NUL byte,
+            // so pass it a NUL terminated copy
+            char *buf = PyMem_Malloc(s.size + 1);
+            if (buf == NULL) {
+                PyErr_NoMemory();
+                goto fail;
+            }
+            memcpy(buf, s.buf, s.size);
+            buf[s.size] = '\0';
+            int ret = NpyDatetime_ParseISO8601Datetime(
+                    buf, s.size, in_unit, NPY_UNSAFE_CASTING, &dts,
+                    &in_meta.base, &out_special);
+            PyMem_Free(buf);
+            if (ret < 0) {
+                goto fail;
+            }
         }
-        if (NpyDatetime_ConvertDatetimeStructToDatetime64(dt_meta, &dts, out) <
-            0) {
+        if (!(fast && dt_meta->num == 1 &&
+              struct_to_datetime64_fast(&dts, dt_meta->base, out) == 0) &&
+            NpyDatetime_ConvertDatetimeStructToDatetime64(dt_meta, &dts, out) <
+                    0) {
             goto fail;
         }
 
@@ -1196,11 +1329,11 @@ string_to_datetime(PyArrayMethod_Context *context, char *const data[],
         out += out_stride;
     }
 
-    NpyString_release_allocator(descr);
+    NpyString_release_allocator_readonly(descr);
     return 0;
 
 fail:
-    NpyString_release_allocator(descr);
+    NpyString_release_allocator_readonly(descr);
     return -1;
 }
 
@@ -1214,6 +1347,118 @@ static char *s2dt_name = "cast_StringDType_to_Datetime";
 
 // datetime to string
 
+// Writes the last *ndigits* decimal digits of *value* to *buf*, padding
+// with zeros
+static inline void
+write_padded_digits(char *buf, npy_int64 value, int ndigits)
+{
+    for (int i = ndigits - 1; i >= 0; i--) {
+        buf[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+}
+
+// Returns the length of the string NpyDatetime_MakeISO8601Datetime writes
+// for timestamps with the *base* unit, if it is one of the units handled by
+// write_iso8601_fast, and -1 otherwise.
+static int
+iso8601_fast_length(NPY_DATETIMEUNIT base)
+{
+    switch (base) {
+        case NPY_FR_D:
+            return 10;
+        case NPY_FR_h:
+            return 13;
+        case NPY_FR_m:
+            return 16;
+        case NPY_FR_s:
+            return 19;
+        case NPY_FR_ms:
+            return 23;
+        case NPY_FR_us:
+            return 26;
+        case NPY_FR_ns:
+            return 29;
+        default:
+            return -1;
+    }
+}
+
+// Like NpyDatetime_ConvertDatetime64ToDatetimeStruct, but only for the
+// units between days and nanoseconds and for the years 0 to 9999. Returns
+// -1 for other datetimes.
+static int
+datetime64_to_struct_fast(npy_datetime value, NPY_DATETIMEUNIT base,
+                          npy_datetimestruct *dts)
+{
+    npy_int64 per_unit = nanoseconds_per_unit(base);
+    if (per_unit == 0) {
+        return -1;
+    }
+    npy_int64 per_day = 86400000000000LL / per_unit;
+    npy_int64 days = value / per_day;
+    npy_int64 rem = value % per_day;
+    if (rem < 0) {
+        days -= 1;
+        rem += per_day;
+    }
+    // 0000-01-01 and 9999-12-31
+    if (days < -719528 || days > 2932896) {
+        return -1;
+    }
+    memset(dts, 0, sizeof(npy_datetimestruct));
+    civil_from_days(days, dts);
+    // less than 2**47 nanoseconds in a day
+    npy_int64 ns = rem * per_unit;
+    dts->hour = (npy_int32)(ns / 3600000000000LL);
+    dts->min = (npy_int32)(ns / 60000000000LL % 60);
+    dts->sec = (npy_int32)(ns / 1000000000LL % 60);
+    dts->us = (npy_int32)(ns / 1000 % 1000000);
+    dts->ps = (npy_int32)(ns % 1000 * 1000);
+    return 0;
+}
+
+// Writes *dts*, which must be in the years 0 to 9999, the same way as
+// NpyDatetime_MakeISO8601Datetime. *len* is the length returned by
+// iso8601_fast_length, which determines the unit.
+static void
+write_iso8601_fast(const npy_datetimestruct *dts, int len, char *buf)
+{
+    write_padded_digits(buf, dts->year, 4);
+    buf[4] = '-';
+    write_padded_digits(buf + 5, dts->month, 2);
+    buf[7] = '-';
+    write_padded_digits(buf + 8, dts->day, 2);
+    if (len == 10) {
+        return;
+    }
+    buf[10] = 'T';
+    write_padded_digits(buf + 11, dts->hour, 2);
+    if (len == 13) {
+        return;
+    }
+    buf[13] = ':';
+    write_padded_digits(buf + 14, dts->min, 2);
+    if (len == 16) {
+        return;
+    }
+    buf[16] = ':';
+    write_padded_digits(buf + 17, dts->sec, 2);
+    if (len == 19) {
+        return;
+    }
+    buf[19] = '.';
+    // nanoseconds since the start of the second
+    npy_int64 fraction = (npy_int64)dts->us * 1000 + dts->ps / 1000;
+    write_padded_digits(buf + 20, fraction / 1000000, 3);
+    if (len > 23) {
+        write_padded_digits(buf + 23, fraction / 1000, 3);
+    }
+    if (len > 26) {
+        write_padded_digits(buf + 26, fraction, 3);
+    }
+}
+
 static int
 datetime_to_string(PyArrayMethod_Context *context, char *const data[],
                    npy_intp const dimensions[], npy_intp const strides[],
@@ -1232,40 +1477,63 @@ datetime_to_string(PyArrayMethod_Context *context, char *const data[],
             &(((PyArray_DatetimeDTypeMetaData *)dt_descr->c_metadata)->meta);
     // buffer passed to numpy to build datetime string
     char datetime_buf[NPY_DATETIME_MAX_ISO8601_STRLEN];
+    // timestamps in the common units are written directly
+    int fast_length = iso8601_fast_length(dt_meta->base);
 
     StringDTypeObject *sdescr = (StringDTypeObject *)context->descriptors[1];
     npy_string_allocator *allocator = NpyString_acquire_allocator(sdescr);
 
     while (N--) {
         npy_packed_static_string *out_pss = (npy_packed_static_string *)out;
-        if (*in == NPY_DATETIME_NAT &&
-            NpyString_pack_null(allocator, out_pss) < 0) {
-            gil_error(
-                    PyExc_MemoryError,
-                    "Failed to deallocate string in datetime to string cast");
-            goto fail;
+        if (*in == NPY_DATETIME_NAT) {
+            if (NpyString_pack_null(allocator, out_pss) < 0) {
+                gil_error(PyExc_MemoryError,
+                          "Failed to deallocate string in datetime to "
+                          "string cast");
+                goto fail;
+            }
         }
         else {
-            if (NpyDatetime_ConvertDatetime64ToDatetimeStruct(dt_meta, *in,
-                                                              &dts) < 0) {
-                goto fail;
+            int fast = fast_length > 0 && dt_meta->num == 1 &&
+                       datetime64_to_struct_fast(*in, dt_meta->base, &dts) ==
+                               0;
+            if (!fast) {
+                if (NpyDatetime_ConvertDatetime64ToDatetimeStruct(
+                            dt_meta, *in, &dts) < 0) {
+                    goto fail;
+                }
+                fast = fast_length > 0 && dts.year >= 0 && dts.year <= 9999;
             }
 
-            // zero out buffer
-            memset(datetime_buf, 0, NPY_DATETIME_MAX_ISO8601_STRLEN);
-
-            if (NpyDatetime_MakeISO8601Datetime(
-                        &dts, datetime_buf, NPY_DATETIME_MAX_ISO8601_STRLEN, 0,
-                        0, dt_meta->base, -1, NPY_UNSAFE_CASTING) < 0) {
-                goto fail;
+            if (fast) {
+                char *buf = NULL;
+                if (new_string_buffer(out, fast_length, allocator, &buf) <
+                    0) {
+                    PyErr_SetString(PyExc_MemoryError,
+                                    "Failed to allocate string when "
+                                    "converting from a datetime.");
+                    goto fail;
+                }
+                write_iso8601_fast(&dts, fast_length, buf);
             }
+            else {
+                // zero out buffer
+                memset(datetime_buf, 0, NPY_DATETIME_MAX_ISO8601_STRLEN);
 
-            if (NpyString_pack(allocator, out_pss, datetime_buf,
-                               strlen(datetime_buf)) < 0) {
-                PyErr_SetString(PyExc_MemoryError,
-                                "Failed to allocate string when converting "
-                                "from a datetime.");
-                goto fail;
+                if (NpyDatetime_MakeISO8601Datetime(
+                            &dts, datetime_buf,
+                            NPY_DATETIME_MAX_ISO8601_STRLEN, 0, 0,
+                            dt_meta->base, -1, NPY_UNSAFE_CASTING) < 0) {
+                    goto fail;
+                }
+
+                if (NpyString_pack(allocator, out_pss, datetime_buf,
+                                   strlen(datetime_buf)) < 0) {
+                    PyErr_SetString(PyExc_MemoryError,
+                                    "Failed to allocate string when "
+                                    "converting from a datetime.");
+                    goto fail;
+                }
             }
         }
 
@@ -1289,6 +1557,225 @@ static PyType_Slot dt2s_slots[] = {
 
 static char *dt2s_name = "cast_Datetime_to_StringDType";
 
+// string to object
+
+static NPY_CASTING
+string_to_object_resolve_descriptors(PyObject *NPY_UNUSED(self),
+                                     PyArray_DTypeMeta *NPY_UNUSED(dtypes[2]),
+                                     PyArray_Descr *given_descrs[2],
+                                     PyArray_Descr *loop_descrs[2],
+                                     npy_intp *NPY_UNUSED(view_offset))
+{
+    if (given_descrs[1] == NULL) {
+        loop_descrs[1] = PyArray_DescrFromType(NPY_OBJECT);
+    }
+    else {
+        Py_INCREF(given_descrs[1]);
+        loop_descrs[1] = given_descrs[1];
+    }
+
+    Py_INCREF(given_descrs[0]);
+    loop_descrs[0] = given_descrs[0];
+
+    return NPY_SAFE_CASTING;
+}
+
+// The str objects made by a string to object cast are kept in a small
+// direct-mapped table keyed on the string contents, so repeated strings
+// share a single object. Only strings up to STR_CACHE_MAX_STRING bytes are
+// kept in the table. Arrays that turn out to have few repeats stop using
+// the table after the first STR_CACHE_TRIAL strings.
+#define STR_CACHE_SIZE 1024
+#define STR_CACHE_TRIAL 4096
+#define STR_CACHE_MAX_STRING 48
+
+typedef struct {
+    size_t size;
+    PyObject *obj;
+    char buf[STR_CACHE_MAX_STRING];
+} str_cache_entry;
+
+static void
+str_cache_free(str_cache_entry *cache)
+{
+    for (int i = 0; i < STR_CACHE_SIZE; i++) {
+        Py_XDECREF(cache[i].obj);
+    }
+    PyMem_Free(cache);
+}
+
+// Making str objects and dropping the references the output held before
+// can run arbitrary python code, for example finalizers that write to the
+// array being cast, so it must not happen while the allocator lock is
+// held. The strings are copied out in blocks of at most S2O_BLOCK_SIZE
+// elements, or S2O_BLOCK_BYTES bytes if that is reached first, and the
+// objects are made after releasing the lock.
+#define S2O_BLOCK_SIZE 256
+#define S2O_BLOCK_BYTES ((size_t)1 << 16)
+
+// Copies up to S2O_BLOCK_SIZE strings starting at *in* into *buf*, growing
+// it as needed. Sets the size of each copied string in *sizes*, or -1 for
+// nulls. Returns the number of strings copied, or -1 on failure with the
+// message for the error in *err*.
+static npy_intp
+copy_string_block(npy_string_allocator *allocator, char *in,
+                  npy_intp in_stride, npy_intp N, char **buf,
+                  size_t *buf_size, npy_intp *sizes, const char **err)
+{
+    size_t total = 0;
+    npy_intp n = 0;
+    for (; n < N && n < S2O_BLOCK_SIZE; n++) {
+        if (n > 0 && total >= S2O_BLOCK_BYTES) {
+            break;
+        }
+        const npy_packed_static_string *ps = (npy_packed_static_string *)in;
+        npy_static_string s = {0, NULL};
+        int is_null = NpyString_load(allocator, ps, &s);
+        if (is_null == -1) {
+            *err = "Failed to load string in string to object cast";
+            return -1;
+        }
+        if (is_null) {
+            sizes[n] = -1;
+        }
+        else {
+            if (total + s.size > *buf_size) {
+                size_t new_size = 2 * (total + s.size);
+                char *new_buf = PyMem_RawRealloc(*buf, new_size);
+                if (new_buf == NULL) {
+                    *err = "Failed to allocate memory in string to object "
+                           "cast";
+                    return -1;
+                }
+                *buf = new_buf;
+                *buf_size = new_size;
+            }
+            memcpy(*buf + total, s.buf, s.size);
+            total += s.size;
+            sizes[n] = (npy_intp)s.size;
+        }
+        in += in_stride;
+    }
+    return n;
+}
+
+static int
+string_to_object(PyArrayMethod_Context *context, char *const data[],
+                 npy_intp const dimensions[], npy_intp const strides[],
+                 NpyAuxData *NPY_UNUSED(auxdata))
+{
+    StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
+    PyObject *na_object = descr->na_object;
+    npy_intp N = dimensions[0];
+    char *in = data[0];
+    char *out = data[1];
+    npy_intp in_stride = strides[0];
+    npy_intp out_stride = strides[1];
+    npy_intp lookups = 0;
+    npy_intp hits = 0;
+    npy_intp sizes[S2O_BLOCK_SIZE];
+    char *buf = NULL;
+    size_t buf_size = 0;
+
+    // too few strings to pay for setting up the table
+    str_cache_entry *cache = NULL;
+    if (N > 64) {
+        cache = PyMem_Calloc(STR_CACHE_SIZE, sizeof(str_cache_entry));
+        if (cache == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
+
+    while (N > 0) {
+        const char *err = NULL;
+        npy_string_allocator *allocator =
+                NpyString_acquire_allocator_readonly(descr);
+        npy_intp n = copy_string_block(allocator, in, in_stride, N, &buf,
+                                       &buf_size, sizes, &err);
+        NpyString_release_allocator_readonly(descr);
+        if (n < 0) {
+            PyErr_SetString(PyExc_MemoryError, err);
+            goto fail;
+        }
+
+        const char *sbuf = buf;
+        for (npy_intp i = 0; i < n; i++) {
+            PyObject *val_obj = NULL;
+            // nulls are empty strings if there is no na_object
+            size_t size = sizes[i] < 0 ? 0 : (size_t)sizes[i];
+            if (sizes[i] < 0 && na_object != NULL) {
+                Py_INCREF(na_object);
+                val_obj = na_object;
+            }
+            else if (cache != NULL && size <= STR_CACHE_MAX_STRING) {
+                str_cache_entry *entry =
+                        &cache[xxh64(sbuf, size, 0) % STR_CACHE_SIZE];
+                if (entry->obj != NULL && entry->size == size &&
+                    memcmp(entry->buf, sbuf, size) == 0) {
+                    hits++;
+                }
+                else {
+                    PyObject *new = PyUnicode_FromStringAndSize(sbuf, size);
+                    if (new == NULL) {
+                        goto fail;
+                    }
+                    Py_XSETREF(entry->obj, new);
+                    memcpy(entry->buf, sbuf, size);
+                    entry->size = size;
+                }
+                Py_INCREF(entry->obj);
+                val_obj = entry->obj;
+                if (++lookups == STR_CACHE_TRIAL &&
+                    hits < STR_CACHE_TRIAL / 8) {
+                    str_cache_free(cache);
+                    cache = NULL;
+                }
+            }
+            else {
+                val_obj = PyUnicode_FromStringAndSize(sbuf, size);
+                if (val_obj == NULL) {
+                    goto fail;
+                }
+            }
+            sbuf += size;
+
+            // the output may hold references from a previous use of the
+            // buffer
+            PyObject *old = NULL;
+            memcpy(&old, out, sizeof(PyObject *));
+            memcpy(out, &val_obj, sizeof(PyObject *));
+            Py_XDECREF(old);
+
+            in += in_stride;
+            out += out_stride;
+        }
+        N -= n;
+    }
+
+    PyMem_RawFree(buf);
+    if (cache != NULL) {
+        str_cache_free(cache);
+    }
+
+    return 0;
+
+fail:
+    PyMem_RawFree(buf);
+    if (cache != NULL) {
+        str_cache_free(cache);
+    }
+
+    return -1;
+}
+
+static PyType_Slot s2o_slots[] = {
+        {NPY_METH_resolve_descriptors, &string_to_object_resolve_descriptors},
+        {NPY_METH_strided_loop, &string_to_object},
+        {0, NULL}};
+
+static char *s2o_name = "cast_StringDType_to_Object";
+
 // TODO: longdouble
 //        punting on this one because numpy's C routines for handling
 //        longdouble are not public (specifically NumPyOS_ascii_strtold)
@@ -1335,11 +1822,12 @@ get_casts()
             get_dtypes((PyArray_DTypeMeta *)&StringDType,
                        (PyArray_DTypeMeta *)&StringDType);
 
-    PyArrayMethod_Spec *ThisToThisCastSpec =
-            get_cast_spec(t2t_name, NPY_NO_CASTING,
-                          NPY_METH_SUPPORTS_UNALIGNED, t2t_dtypes, s2s_slots);
+    PyArrayMethod_Spec *ThisToThisCastSpec = get_cast_spec(
+            t2t_name, NPY_NO_CASTING,
+            NPY_METH_SUPPORTS_UNALIGNED | NPY_METH_NO_FLOATINGPOINT_ERRORS,
+            t2t_dtypes, s2s_slots);
 
-    int num_casts = 29;
+    int num_casts = 30;
 
 #if NPY_SIZEOF_BYTE == NPY_SIZEOF_SHORT
     num_casts += 4;
@@ -1382,35 +1870,46 @@ get_casts()
             b2s_name, NPY_SAFE_CASTING, NPY_METH_NO_FLOATINGPOINT_ERRORS,
             b2s_dtypes, b2s_slots);
 
-    DTYPES_AND_CAST_SPEC(i8, Int8)
-    DTYPES_AND_CAST_SPEC(i16, Int16)
-    DTYPES_AND_CAST_SPEC(i32, Int32)
-    DTYPES_AND_CAST_SPEC(i64, Int64)
-    DTYPES_AND_CAST_SPEC(u8, UInt8)
-    DTYPES_AND_CAST_SPEC(u16, UInt16)
-    DTYPES_AND_CAST_SPEC(u32, UInt32)
-    DTYPES_AND_CAST_SPEC(u64, UInt64)
+    // Only the casts that need the GIL for every element require the python
+    // API. The others take the GIL themselves in the rare cases they need it,
+    // so numpy can release it while they run.
+    NPY_ARRAYMETHOD_FLAGS s2i_flags = NPY_METH_NO_FLOATINGPOINT_ERRORS;
+    NPY_ARRAYMETHOD_FLAGS i2s_flags = NPY_METH_NO_FLOATINGPOINT_ERRORS;
+    // overflow converting to float32 and float16 is reported through the
+    // floating point status flags
+    NPY_ARRAYMETHOD_FLAGS s2f_flags = 0;
+    NPY_ARRAYMETHOD_FLAGS f2s_flags = NPY_METH_NO_FLOATINGPOINT_ERRORS;
+
+    DTYPES_AND_CAST_SPEC(i8, Int8, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(i16, Int16, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(i32, Int32, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(i64, Int64, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(u8, UInt8, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(u16, UInt16, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(u32, UInt32, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(u64, UInt64, s2i_flags, i2s_flags)
 #if NPY_SIZEOF_BYTE == NPY_SIZEOF_SHORT
-    DTYPES_AND_CAST_SPEC(byte, Byte)
-    DTYPES_AND_CAST_SPEC(ubyte, UByte)
+    DTYPES_AND_CAST_SPEC(byte, Byte, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(ubyte, UByte, s2i_flags, i2s_flags)
 #endif
 #if NPY_SIZEOF_SHORT == NPY_SIZEOF_INT
-    DTYPES_AND_CAST_SPEC(short, Short)
-    DTYPES_AND_CAST_SPEC(ushort, UShort)
+    DTYPES_AND_CAST_SPEC(short, Short, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(ushort, UShort, s2i_flags, i2s_flags)
 #endif
 #if NPY_SIZEOF_INT == NPY_SIZEOF_LONG
-    DTYPES_AND_CAST_SPEC(int, Int)
-    DTYPES_AND_CAST_SPEC(uint, UInt)
+    DTYPES_AND_CAST_SPEC(int, Int, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(uint, UInt, s2i_flags, i2s_flags)
 #endif
 #if NPY_SIZEOF_LONGLONG == NPY_SIZEOF_LONG
-    DTYPES_AND_CAST_SPEC(longlong, LongLong)
-    DTYPES_AND_CAST_SPEC(ulonglong, ULongLong)
+    DTYPES_AND_CAST_SPEC(longlong, LongLong, s2i_flags, i2s_flags)
+    DTYPES_AND_CAST_SPEC(ulonglong, ULongLong, s2i_flags, i2s_flags)
 #endif
 
-    DTYPES_AND_CAST_SPEC(f64, Double)
-    DTYPES_AND_CAST_SPEC(f32, Float)
-    DTYPES_AND_CAST_SPEC(f16, Half)
+    DTYPES_AND_CAST_SPEC(f64, Double, s2f_flags, f2s_flags)
+    DTYPES_AND_CAST_SPEC(f32, Float, s2f_flags, f2s_flags)
+    DTYPES_AND_CAST_SPEC(f16, Half, s2f_flags, f2s_flags)
 
+    // the numpy datetime functions set python exceptions
     PyArray_DTypeMeta **s2dt_dtypes = get_dtypes(
             (PyArray_DTypeMeta *)&StringDType, &PyArray_DatetimeDType);
 
@@ -1427,6 +1926,15 @@ get_casts()
             NPY_METH_NO_FLOATINGPOINT_ERRORS | NPY_METH_REQUIRES_PYAPI,
             dt2s_dtypes, dt2s_slots);
 
+    // object to string is left to numpy, which calls setitem
+    PyArray_DTypeMeta **s2o_dtypes = get_dtypes(
+            (PyArray_DTypeMeta *)&StringDType, &PyArray_ObjectDType);
+
+    PyArrayMethod_Spec *StringToObjectCastSpec = get_cast_spec(
+            s2o_name, NPY_SAFE_CASTING,
+            NPY_METH_NO_FLOATINGPOINT_ERRORS | NPY_METH_REQUIRES_PYAPI,
+            s2o_dtypes, s2o_slots);
+
     PyArrayMethod_Spec **casts =
             PyMem_Malloc((num_casts + 1) * sizeof(PyArrayMethod_Spec *));
 
@@ -1485,6 +1993,7 @@ get_casts()
     casts[cast_i++] = HalfToStringCastSpec;
     casts[cast_i++] = StringToDatetimeCastSpec;
     casts[cast_i++] = DatetimeToStringCastSpec;
+    casts[cast_i++] = StringToObjectCastSpec;
     casts[cast_i++] = NULL;
 
     assert(casts[num_casts] == NULL);
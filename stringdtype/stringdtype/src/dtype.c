@@ -1,6 +1,7 @@
 #include "dtype.h"
 
 #include "casts.h"
+#include "sort.h"
 #include "static_string.h"
 
 PyTypeObject *StringScalar_Type = NULL;
@@ -9,7 +10,8 @@ PyTypeObject *StringScalar_Type = NULL;
  * Internal helper to create new instances
  */
 PyObject *
-new_stringdtype_instance(PyObject *na_object, int coerce)
+new_stringdtype_instance(PyObject *na_object, int coerce,
+                         const allocator_backend *backend)
 {
     PyObject *new =
             PyArrayDescr_Type.tp_new((PyTypeObject *)&StringDType, NULL, NULL);
@@ -20,12 +22,17 @@ new_stringdtype_instance(PyObject *na_object, int coerce)
 
     npy_string_allocator *allocator = NULL;
     PyThread_type_lock *allocator_lock = NULL;
+    PyThread_type_lock *readers_lock = NULL;
+    PyThread_type_lock *writers_lock = NULL;
 
     char *default_string_buf = NULL;
     char *na_name_buf = NULL;
 
-    allocator = NpyString_new_allocator(PyMem_RawMalloc, PyMem_RawFree,
-                                        PyMem_RawRealloc);
+    if (backend == NULL) {
+        backend = get_allocator_backend(NULL);
+    }
+
+    allocator = new_backend_allocator(backend);
     if (allocator == NULL) {
         PyErr_SetString(PyExc_MemoryError,
                         "Failed to create string allocator");
@@ -38,6 +45,18 @@ new_stringdtype_instance(PyObject *na_object, int coerce)
         goto fail;
     }
 
+    readers_lock = PyThread_allocate_lock();
+    if (readers_lock == NULL) {
+        PyErr_SetString(PyExc_MemoryError, "Unable to allocate thread lock");
+        goto fail;
+    }
+
+    writers_lock = PyThread_allocate_lock();
+    if (writers_lock == NULL) {
+        PyErr_SetString(PyExc_MemoryError, "Unable to allocate thread lock");
+        goto fail;
+    }
+
     npy_static_string default_string = {0, NULL};
     npy_static_string na_name = {0, NULL};
 
@@ -97,7 +116,11 @@ new_stringdtype_instance(PyObject *na_object, int coerce)
     snew->has_string_na = has_string_na;
     snew->coerce = coerce;
     snew->allocator_lock = allocator_lock;
+    snew->readers_lock = readers_lock;
+    snew->num_readers = 0;
+    snew->writers_lock = writers_lock;
     snew->allocator = allocator;
+    snew->backend = backend;
     snew->array_owned = 0;
     snew->na_name = na_name;
     snew->default_string = default_string;
@@ -132,6 +155,12 @@ fail:
     if (allocator_lock != NULL) {
         PyThread_free_lock(allocator_lock);
     }
+    if (readers_lock != NULL) {
+        PyThread_free_lock(readers_lock);
+    }
+    if (writers_lock != NULL) {
+        PyThread_free_lock(writers_lock);
+    }
     return NULL;
 }
 
@@ -184,8 +213,8 @@ common_instance(StringDTypeObject *dtype1, StringDTypeObject *dtype2)
         return NULL;
     }
 
-    return (StringDTypeObject *)new_stringdtype_instance(dtype1->na_object,
-                                                         dtype1->coerce);
+    return (StringDTypeObject *)new_stringdtype_instance(
+            dtype1->na_object, dtype1->coerce, dtype1->backend);
 }
 
 /*
@@ -250,7 +279,8 @@ string_discover_descriptor_from_pyobject(PyTypeObject *NPY_UNUSED(cls),
 
     Py_DECREF(val);
 
-    PyArray_Descr *ret = (PyArray_Descr *)new_stringdtype_instance(NULL, 1);
+    PyArray_Descr *ret =
+            (PyArray_Descr *)new_stringdtype_instance(NULL, 1, NULL);
 
     return ret;
 }
@@ -311,6 +341,145 @@ fail:
     return -1;
 }
 
+// Bulk version of stringdtype_setitem for exact lists and tuples of exact
+// str, the most common way arrays are created. The UTF-8 data cached by the
+// str objects is measured first so the arena is grown once, and then
+// everything is packed under a single acquisition of the allocator lock.
+// Anything else is handed to PyArray_FromAny.
+PyObject *
+from_sequence(PyObject *NPY_UNUSED(self), PyObject *args, PyObject *kwds)
+{
+    static char *kwargs_strs[] = {"seq", "dtype", NULL};
+    PyObject *seq = NULL;
+    PyObject *dtype_obj = Py_None;
+    StringDTypeObject *descr = NULL;
+    PyArrayObject *ret = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O:from_sequence",
+                                     kwargs_strs, &seq, &dtype_obj)) {
+        return NULL;
+    }
+
+    if (dtype_obj == Py_None) {
+        descr = (StringDTypeObject *)new_stringdtype_instance(NULL, 1, NULL);
+        if (descr == NULL) {
+            return NULL;
+        }
+    }
+    else if (Py_TYPE(dtype_obj) == (PyTypeObject *)&StringDType) {
+        Py_INCREF(dtype_obj);
+        descr = (StringDTypeObject *)dtype_obj;
+    }
+    else {
+        PyErr_SetString(PyExc_TypeError, "dtype must be a StringDType");
+        return NULL;
+    }
+
+    if (!PyList_CheckExact(seq) && !PyTuple_CheckExact(seq)) {
+        goto fallback;
+    }
+
+    // the sequence can only change while the GIL is released to wait for the
+    // allocator lock, which is checked for below
+    npy_intp num = PySequence_Fast_GET_SIZE(seq);
+    PyObject **items = PySequence_Fast_ITEMS(seq);
+    PyObject *na_object = descr->na_object;
+    size_t arena_size = 0;
+
+    for (npy_intp i = 0; i < num; i++) {
+        PyObject *item = items[i];
+        if (na_object != NULL && item == na_object) {
+            continue;
+        }
+        if (!PyUnicode_CheckExact(item)) {
+            goto fallback;
+        }
+        Py_ssize_t size = 0;
+        if (PyUnicode_AsUTF8AndSize(item, &size) == NULL) {
+            goto fail;
+        }
+        arena_size += NpyString_arena_storage_size((size_t)size);
+    }
+
+    // steals the reference to descr
+    ret = (PyArrayObject *)PyArray_NewFromDescr(
+            &PyArray_Type, (PyArray_Descr *)descr, 1, &num, NULL, NULL, 0,
+            NULL);
+    descr = NULL;
+    if (ret == NULL) {
+        goto fail;
+    }
+
+    // the array may have been given a new descriptor instance
+    StringDTypeObject *sdescr = (StringDTypeObject *)PyArray_DESCR(ret);
+    char *out = PyArray_BYTES(ret);
+    npy_intp out_stride = PyArray_STRIDES(ret)[0];
+    int failed = 0;
+
+    npy_string_allocator *allocator = NpyString_acquire_allocator(sdescr);
+
+    if (PySequence_Fast_GET_SIZE(seq) != num) {
+        NpyString_release_allocator(sdescr);
+        PyErr_SetString(PyExc_RuntimeError,
+                        "sequence changed size during from_sequence");
+        goto fail;
+    }
+    items = PySequence_Fast_ITEMS(seq);
+
+    if (NpyString_arena_reserve(allocator, arena_size) < 0) {
+        failed = 1;
+    }
+
+    for (npy_intp i = 0; i < num && !failed; i++) {
+        npy_packed_static_string *ps =
+                (npy_packed_static_string *)(out + i * out_stride);
+        if (na_object != NULL && items[i] == na_object) {
+            failed = NpyString_pack_null(allocator, ps) < 0;
+        }
+        else if (!PyUnicode_CheckExact(items[i])) {
+            NpyString_release_allocator(sdescr);
+            PyErr_SetString(PyExc_RuntimeError,
+                            "sequence changed during from_sequence");
+            goto fail;
+        }
+        else {
+            // the UTF-8 data was cached by the first pass, unless the item
+            // was replaced, in which case this can fail
+            Py_ssize_t size = 0;
+            const char *buf = PyUnicode_AsUTF8AndSize(items[i], &size);
+            if (buf == NULL) {
+                NpyString_release_allocator(sdescr);
+                goto fail;
+            }
+            // the array buffer is zero-filled, so every element already
+            // holds an initialized empty string
+            failed = NpyString_newsize(buf, (size_t)size, ps, allocator) < 0;
+        }
+    }
+
+    NpyString_release_allocator(sdescr);
+
+    if (failed) {
+        PyErr_SetString(PyExc_MemoryError,
+                        "Failed to allocate string in from_sequence");
+        goto fail;
+    }
+
+    return (PyObject *)ret;
+
+fallback:
+    // steals the reference to descr
+    return PyArray_FromAny(seq, (PyArray_Descr *)descr, 0, 0, 0, NULL);
+
+fail:
+    Py_XDECREF(descr);
+    Py_XDECREF(ret);
+    return NULL;
+}
+
+// Strings up to this size are copied out of the array by getitem
+#define GETITEM_BUFFER_SIZE 256
+
 static PyObject *
 stringdtype_getitem(StringDTypeObject *descr, char **dataptr)
 {
@@ -318,7 +487,36 @@ stringdtype_getitem(StringDTypeObject *descr, char **dataptr)
     npy_packed_static_string *psdata = (npy_packed_static_string *)dataptr;
     npy_static_string sdata = {0, NULL};
     int hasnull = descr->na_object != NULL;
-    npy_string_allocator *allocator = NpyString_acquire_allocator(descr);
+
+    // getitem is called once per element by tolist, so short strings are
+    // copied out while holding the allocator lock outright, which costs far
+    // less than registering as a reader. Python code that could call getitem
+    // again must not run while the lock is held, so the str is created after
+    // releasing it. Like a writer, this goes through the writers lock first,
+    // so it doesn't get ahead of a writer that is already waiting. This
+    // fails while there are readers or waiting writers, and nulls and longer
+    // strings are handled below.
+    int locked = 0;
+    if (NpyString_size(psdata) <= GETITEM_BUFFER_SIZE &&
+        PyThread_acquire_lock(descr->writers_lock, NOWAIT_LOCK)) {
+        locked = PyThread_acquire_lock(descr->allocator_lock, NOWAIT_LOCK);
+        PyThread_release_lock(descr->writers_lock);
+    }
+    if (locked) {
+        char buf[GETITEM_BUFFER_SIZE];
+        int is_null = NpyString_load(descr->allocator, psdata, &sdata);
+        int copied = is_null == 0 && sdata.size <= GETITEM_BUFFER_SIZE;
+        if (copied) {
+            memcpy(buf, sdata.buf, sdata.size);
+        }
+        NpyString_release_allocator(descr);
+        if (copied) {
+            return PyUnicode_FromStringAndSize(buf, sdata.size);
+        }
+    }
+
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
     int is_null = NpyString_load(allocator, psdata, &sdata);
 
     if (is_null < 0) {
@@ -344,7 +542,7 @@ stringdtype_getitem(StringDTypeObject *descr, char **dataptr)
         }
     }
 
-    NpyString_release_allocator(descr);
+    NpyString_release_allocator_readonly(descr);
 
     /*
      * In principle we should return a StringScalar instance here, but
@@ -361,7 +559,7 @@ stringdtype_getitem(StringDTypeObject *descr, char **dataptr)
 
 fail:
 
-    NpyString_release_allocator(descr);
+    NpyString_release_allocator_readonly(descr);
 
     return NULL;
 }
@@ -382,9 +580,9 @@ compare(void *a, void *b, void *arr)
     StringDTypeObject *descr = (StringDTypeObject *)PyArray_DESCR(arr);
     // ignore the allocator returned by this function
     // since _compare needs the descr anyway
-    NpyString_acquire_allocator(descr);
+    NpyString_acquire_allocator_readonly(descr);
     int ret = _compare(a, b, descr, descr);
-    NpyString_release_allocator(descr);
+    NpyString_release_allocator_readonly(descr);
     return ret;
 }
 
@@ -409,18 +607,9 @@ _compare(void *a, void *b, StringDTypeObject *descr_a,
     int b_is_null = NpyString_load(allocator_b, ps_b, &s_b);
     if (NPY_UNLIKELY(a_is_null == -1 || b_is_null == -1)) {
         char *msg = "Failed to load string in string comparison";
-        if (hasnull && !(has_string_na && has_nan_na)) {
-            // we hold the gil in this branch
-            if (PyErr_Occurred()) {
-                return 0;
-            }
-            PyErr_SetString(PyExc_MemoryError, msg);
-        }
-        else {
-            // has a check for PyErr_Occurred so error
-            // only gets set once
-            gil_error(PyExc_MemoryError, msg);
-        }
+        // the loops calling this may not hold the GIL, gil_error only sets
+        // the error once
+        gil_error(PyExc_MemoryError, msg);
         return 0;
     }
     else if (NPY_UNLIKELY(a_is_null || b_is_null)) {
@@ -434,10 +623,8 @@ _compare(void *a, void *b, StringDTypeObject *descr_a,
                 }
             }
             else {
-                // we must hold the GIL in this branch
-                PyErr_SetString(
-                        PyExc_ValueError,
-                        "Cannot compare null this is not a nan-like value");
+                gil_error(PyExc_ValueError,
+                          "Cannot compare null this is not a nan-like value");
                 return 0;
             }
         }
@@ -458,14 +645,17 @@ _compare(void *a, void *b, StringDTypeObject *descr_a,
 int
 argmax(char *data, npy_intp n, npy_intp *max_ind, void *arr)
 {
-    PyArray_Descr *descr = PyArray_DESCR(arr);
-    npy_intp elsize = descr->elsize;
+    StringDTypeObject *descr = (StringDTypeObject *)PyArray_DESCR(arr);
+    npy_intp elsize = descr->base.elsize;
     *max_ind = 0;
-    for (int i = 1; i < n; i++) {
-        if (compare(data + i * elsize, data + (*max_ind) * elsize, arr) > 0) {
+    NpyString_acquire_allocator_readonly(descr);
+    for (npy_intp i = 1; i < n; i++) {
+        if (_compare(data + i * elsize, data + (*max_ind) * elsize, descr,
+                     descr) > 0) {
             *max_ind = i;
         }
     }
+    NpyString_release_allocator_readonly(descr);
     return 0;
 }
 
@@ -474,14 +664,17 @@ argmax(char *data, npy_intp n, npy_intp *max_ind, void *arr)
 int
 argmin(char *data, npy_intp n, npy_intp *min_ind, void *arr)
 {
-    PyArray_Descr *descr = PyArray_DESCR(arr);
-    npy_intp elsize = descr->elsize;
+    StringDTypeObject *descr = (StringDTypeObject *)PyArray_DESCR(arr);
+    npy_intp elsize = descr->base.elsize;
     *min_ind = 0;
-    for (int i = 1; i < n; i++) {
-        if (compare(data + i * elsize, data + (*min_ind) * elsize, arr) < 0) {
+    NpyString_acquire_allocator_readonly(descr);
+    for (npy_intp i = 1; i < n; i++) {
+        if (_compare(data + i * elsize, data + (*min_ind) * elsize, descr,
+                     descr) < 0) {
             *min_ind = i;
         }
     }
+    NpyString_release_allocator_readonly(descr);
     return 0;
 }
 
@@ -628,7 +821,7 @@ stringdtype_finalize_descr(PyArray_Descr *dtype)
         return dtype;
     }
     StringDTypeObject *ret = (StringDTypeObject *)new_stringdtype_instance(
-            sdtype->na_object, sdtype->coerce);
+            sdtype->na_object, sdtype->coerce, sdtype->backend);
     ret->array_owned = 1;
     return (PyArray_Descr *)ret;
 }
@@ -645,6 +838,8 @@ static PyType_Slot StringDType_Slots[] = {
         {NPY_DT_PyArray_ArrFuncs_compare, &compare},
         {NPY_DT_PyArray_ArrFuncs_argmax, &argmax},
         {NPY_DT_PyArray_ArrFuncs_argmin, &argmin},
+        {NPY_DT_PyArray_ArrFuncs_sort, &sort},
+        {NPY_DT_PyArray_ArrFuncs_argsort, &argsort},
         {NPY_DT_get_clear_loop, &stringdtype_get_clear_loop},
         {NPY_DT_finalize_descr, &stringdtype_finalize_descr},
         {_NPY_DT_is_known_scalar_type, &stringdtype_is_known_scalar_type},
@@ -653,19 +848,26 @@ static PyType_Slot StringDType_Slots[] = {
 static PyObject *
 stringdtype_new(PyTypeObject *NPY_UNUSED(cls), PyObject *args, PyObject *kwds)
 {
-    static char *kwargs_strs[] = {"size", "coerce", "na_object", NULL};
+    static char *kwargs_strs[] = {"size", "coerce", "na_object", "allocator",
+                                  NULL};
 
     long size = 0;
     PyObject *na_object = NULL;
     int coerce = 1;
+    const char *allocator_name = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|lpOz:StringDType",
+                                     kwargs_strs, &size, &coerce, &na_object,
+                                     &allocator_name)) {
+        return NULL;
+    }
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|lpO:StringDType",
-                                     kwargs_strs, &size, &coerce,
-                                     &na_object)) {
+    const allocator_backend *backend = get_allocator_backend(allocator_name);
+    if (backend == NULL) {
         return NULL;
     }
 
-    return new_stringdtype_instance(na_object, coerce);
+    return new_stringdtype_instance(na_object, coerce, backend);
 }
 
 static void
@@ -678,6 +880,8 @@ stringdtype_dealloc(StringDTypeObject *self)
         // inside of one C thread?
         NpyString_free_allocator(self->allocator);
         PyThread_free_lock(self->allocator_lock);
+        PyThread_free_lock(self->readers_lock);
+        PyThread_free_lock(self->writers_lock);
     }
     PyMem_RawFree((char *)self->na_name.buf);
     PyMem_RawFree((char *)self->default_string.buf);
@@ -688,24 +892,55 @@ static PyObject *
 stringdtype_repr(StringDTypeObject *self)
 {
     PyObject *ret = NULL;
+    PyObject *sep = NULL;
+    PyObject *args = NULL;
+    PyObject *parts = PyList_New(0);
+    if (parts == NULL) {
+        return NULL;
+    }
+
     // borrow reference
     PyObject *na_object = self->na_object;
     int coerce = self->coerce;
 
-    if (na_object != NULL && coerce == 0) {
-        ret = PyUnicode_FromFormat("StringDType(na_object=%R, coerce=False)",
-                                   na_object);
+    PyObject *part = NULL;
+    if (na_object != NULL) {
+        part = PyUnicode_FromFormat("na_object=%R", na_object);
+        if (part == NULL || PyList_Append(parts, part) < 0) {
+            goto finish;
+        }
+        Py_CLEAR(part);
     }
-    else if (na_object != NULL) {
-        ret = PyUnicode_FromFormat("StringDType(na_object=%R)", na_object);
+    if (coerce == 0) {
+        part = PyUnicode_FromString("coerce=False");
+        if (part == NULL || PyList_Append(parts, part) < 0) {
+            goto finish;
+        }
+        Py_CLEAR(part);
     }
-    else if (coerce == 0) {
-        ret = PyUnicode_FromFormat("StringDType(coerce=False)", coerce);
+    if (self->backend != get_allocator_backend(NULL)) {
+        part = PyUnicode_FromFormat("allocator='%s'", self->backend->name);
+        if (part == NULL || PyList_Append(parts, part) < 0) {
+            goto finish;
+        }
+        Py_CLEAR(part);
     }
-    else {
-        ret = PyUnicode_FromString("StringDType()");
+
+    sep = PyUnicode_FromString(", ");
+    if (sep == NULL) {
+        goto finish;
     }
+    args = PyUnicode_Join(sep, parts);
+    if (args == NULL) {
+        goto finish;
+    }
+    ret = PyUnicode_FromFormat("StringDType(%U)", args);
 
+finish:
+    Py_XDECREF(part);
+    Py_XDECREF(sep);
+    Py_XDECREF(args);
+    Py_DECREF(parts);
     return ret;
 }
 
@@ -747,22 +982,32 @@ stringdtype__reduce__(StringDTypeObject *self)
                 Py_BuildValue("(Ni)", PyLong_FromLong(0), self->coerce));
     }
 
-    PyTuple_SET_ITEM(ret, 2, Py_BuildValue("(l)", PICKLE_VERSION));
+    // the allocator is restored by __setstate__ since it can't be passed
+    // positionally without also passing na_object
+    if (self->backend != get_allocator_backend(NULL)) {
+        PyTuple_SET_ITEM(ret, 2,
+                         Py_BuildValue("(ls)", PICKLE_VERSION,
+                                       self->backend->name));
+    }
+    else {
+        PyTuple_SET_ITEM(ret, 2, Py_BuildValue("(l)", PICKLE_VERSION));
+    }
 
     return ret;
 }
 
 static PyObject *
-stringdtype__setstate__(StringDTypeObject *NPY_UNUSED(self), PyObject *args)
+stringdtype__setstate__(StringDTypeObject *self, PyObject *args)
 {
-    if (PyTuple_GET_SIZE(args) != 1 ||
-        !(PyLong_Check(PyTuple_GET_ITEM(args, 0)))) {
+    long version = -1;
+    const char *allocator_name = NULL;
+
+    if (!PyTuple_Check(args) ||
+        !PyArg_ParseTuple(args, "l|s", &version, &allocator_name)) {
         PyErr_BadInternalCall();
         return NULL;
     }
 
-    long version = PyLong_AsLong(PyTuple_GET_ITEM(args, 0));
-
     if (version != PICKLE_VERSION) {
         PyErr_Format(PyExc_ValueError,
                      "Pickle version mismatch. Got version %d but expected "
@@ -771,6 +1016,40 @@ stringdtype__setstate__(StringDTypeObject *NPY_UNUSED(self), PyObject *args)
         return NULL;
     }
 
+    if (allocator_name == NULL) {
+        Py_RETURN_NONE;
+    }
+
+    const allocator_backend *backend = get_allocator_backend(allocator_name);
+    if (backend == NULL) {
+        return NULL;
+    }
+
+    npy_string_allocator *allocator = new_backend_allocator(backend);
+    if (allocator == NULL) {
+        PyErr_SetString(PyExc_MemoryError,
+                        "Failed to create string allocator");
+        return NULL;
+    }
+
+    // swapping the allocator is only safe if nothing has been allocated with
+    // it, which is always true for a freshly unpickled instance
+    npy_string_memory_usage usage;
+    npy_string_allocator *old_allocator = NpyString_acquire_allocator(self);
+    NpyString_memory_usage(old_allocator, &usage);
+    if (self->array_owned || usage.arena_capacity > 0 || usage.heap > 0) {
+        NpyString_release_allocator(self);
+        NpyString_free_allocator(allocator);
+        PyErr_SetString(PyExc_ValueError,
+                        "Cannot change the allocator of a StringDType "
+                        "instance that is in use");
+        return NULL;
+    }
+    self->allocator = allocator;
+    self->backend = backend;
+    NpyString_release_allocator(self);
+    NpyString_free_allocator(old_allocator);
+
     Py_RETURN_NONE;
 }
 
@@ -819,6 +1098,12 @@ StringDType_richcompare(PyObject *self, PyObject *other, int op)
         return NULL;
     }
 
+    // instances with different allocator backends store their strings
+    // differently, so arrays can't be shared between them
+    if (sself->backend != sother->backend) {
+        eq = 0;
+    }
+
     PyObject *ret = Py_NotImplemented;
     if ((op == Py_EQ && eq) || (op == Py_NE && !eq)) {
         ret = Py_True;
@@ -914,6 +1199,38 @@ init_string_dtype(void)
     return 0;
 }
 
+#ifndef NDEBUG
+// a loop holds at most a few read locks at once, so further ones are
+// simply not tracked
+#define MAX_TRACKED_READ_LOCKS 8
+
+static _Thread_local StringDTypeObject
+        *held_read_locks[MAX_TRACKED_READ_LOCKS];
+static _Thread_local int num_held_read_locks = 0;
+
+void
+_track_read_lock(StringDTypeObject *descr)
+{
+    for (int i = 0; i < num_held_read_locks; i++) {
+        assert(held_read_locks[i] != descr);
+    }
+    if (num_held_read_locks < MAX_TRACKED_READ_LOCKS) {
+        held_read_locks[num_held_read_locks++] = descr;
+    }
+}
+
+void
+_untrack_read_lock(StringDTypeObject *descr)
+{
+    for (int i = num_held_read_locks - 1; i >= 0; i--) {
+        if (held_read_locks[i] == descr) {
+            held_read_locks[i] = held_read_locks[--num_held_read_locks];
+            return;
+        }
+    }
+}
+#endif
+
 void
 gil_error(PyObject *type, const char *msg)
 {
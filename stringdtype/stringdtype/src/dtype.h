@@ -6,6 +6,7 @@
 #include "structmember.h"
 // clang-format on
 
+#include "allocators.h"
 #include "static_string.h"
 
 #define PY_ARRAY_UNIQUE_SYMBOL stringdtype_ARRAY_API
@@ -42,6 +43,17 @@ typedef struct {
     // be released immediately after the allocator is
     // no longer needed
     npy_string_allocator *allocator;
+    const allocator_backend *backend;
+    // guards num_readers. Read-only loops share the allocator_lock: the
+    // first reader to arrive acquires it and the last one to leave
+    // releases it, so readers only contend on this lock briefly and
+    // writers still get exclusive access.
+    PyThread_type_lock *readers_lock;
+    int num_readers;
+    // held by a writer while it waits for the allocator_lock. Readers pass
+    // through it before joining the others, so readers that arrive after a
+    // waiting writer queue behind it instead of starving it.
+    PyThread_type_lock *writers_lock;
 } StringDTypeObject;
 
 typedef struct {
@@ -51,12 +63,31 @@ typedef struct {
 extern StringDType_type StringDType;
 extern PyTypeObject *StringScalar_Type;
 
+// Threads holding an allocator may need the GIL before they can release
+// it, for example to raise an error, so a thread that holds the GIL
+// releases it while it waits for a lock.
+static inline void
+_acquire_lock(PyThread_type_lock *lock)
+{
+    if (PyThread_acquire_lock(lock, NOWAIT_LOCK)) {
+        return;
+    }
+    if (PyGILState_Check()) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(lock, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+    }
+    else {
+        PyThread_acquire_lock(lock, WAIT_LOCK);
+    }
+}
+
 static inline npy_string_allocator *
 NpyString_acquire_allocator(StringDTypeObject *descr)
 {
-    if (!PyThread_acquire_lock(descr->allocator_lock, NOWAIT_LOCK)) {
-        PyThread_acquire_lock(descr->allocator_lock, WAIT_LOCK);
-    }
+    _acquire_lock(descr->writers_lock);
+    _acquire_lock(descr->allocator_lock);
+    PyThread_release_lock(descr->writers_lock);
     return descr->allocator;
 }
 
@@ -119,8 +150,117 @@ NpyString_release_allocator3(StringDTypeObject *descr1,
     }
 }
 
+#ifndef NDEBUG
+// Record that the calling thread holds, or no longer holds, the read lock
+// on a descriptor, asserting that it never acquires the same one twice
+void
+_track_read_lock(StringDTypeObject *descr);
+
+void
+_untrack_read_lock(StringDTypeObject *descr);
+#endif
+
+// Acquire the allocator for a loop that only reads strings. Any number of
+// readers may hold the allocator at the same time, so the allocator must
+// not be modified until it is released with
+// NpyString_release_allocator_readonly.
+//
+// The read lock is not re-entrant: a thread that already holds it must not
+// acquire it again on the same descriptor. If a writer is waiting, the
+// second acquisition blocks on the writers_lock while the writer blocks on
+// the allocator_lock the first one holds. The readonly2/3 helpers acquire
+// each distinct descriptor once, and code that calls back into Python,
+// which may read the same array, must release the lock first.
+static inline npy_string_allocator *
+NpyString_acquire_allocator_readonly(StringDTypeObject *descr)
+{
+#ifndef NDEBUG
+    _track_read_lock(descr);
+#endif
+    // waits for writers that are already waiting
+    _acquire_lock(descr->writers_lock);
+    PyThread_release_lock(descr->writers_lock);
+    _acquire_lock(descr->readers_lock);
+    if (++descr->num_readers == 1) {
+        _acquire_lock(descr->allocator_lock);
+    }
+    PyThread_release_lock(descr->readers_lock);
+    return descr->allocator;
+}
+
+static inline void
+NpyString_acquire_allocator_readonly2(StringDTypeObject *descr1,
+                                      StringDTypeObject *descr2,
+                                      npy_string_allocator **allocator1,
+                                      npy_string_allocator **allocator2)
+{
+    *allocator1 = NpyString_acquire_allocator_readonly(descr1);
+    if (descr1 != descr2) {
+        *allocator2 = NpyString_acquire_allocator_readonly(descr2);
+    }
+    else {
+        *allocator2 = *allocator1;
+    }
+}
+
+static inline void
+NpyString_acquire_allocator_readonly3(StringDTypeObject *descr1,
+                                      StringDTypeObject *descr2,
+                                      StringDTypeObject *descr3,
+                                      npy_string_allocator **allocator1,
+                                      npy_string_allocator **allocator2,
+                                      npy_string_allocator **allocator3)
+{
+    NpyString_acquire_allocator_readonly2(descr1, descr2, allocator1,
+                                          allocator2);
+    if (descr1 != descr3 && descr2 != descr3) {
+        *allocator3 = NpyString_acquire_allocator_readonly(descr3);
+    }
+    else {
+        *allocator3 = descr3->allocator;
+    }
+}
+
+static inline void
+NpyString_release_allocator_readonly(StringDTypeObject *descr)
+{
+#ifndef NDEBUG
+    _untrack_read_lock(descr);
+#endif
+    _acquire_lock(descr->readers_lock);
+    if (--descr->num_readers == 0) {
+        // PyThread locks are not owned by a thread, so the last reader
+        // may release the lock even if another reader acquired it
+        PyThread_release_lock(descr->allocator_lock);
+    }
+    PyThread_release_lock(descr->readers_lock);
+}
+
+static inline void
+NpyString_release_allocator_readonly2(StringDTypeObject *descr1,
+                                      StringDTypeObject *descr2)
+{
+    NpyString_release_allocator_readonly(descr1);
+    if (descr1 != descr2) {
+        NpyString_release_allocator_readonly(descr2);
+    }
+}
+
+static inline void
+NpyString_release_allocator_readonly3(StringDTypeObject *descr1,
+                                      StringDTypeObject *descr2,
+                                      StringDTypeObject *descr3)
+{
+    NpyString_release_allocator_readonly2(descr1, descr2);
+    if (descr1 != descr3 && descr2 != descr3) {
+        NpyString_release_allocator_readonly(descr3);
+    }
+}
+
+// A NULL *backend* means the default allocator backend
 PyObject *
-new_stringdtype_instance(PyObject *na_object, int coerce);
+new_stringdtype_instance(PyObject *na_object, int coerce,
+                         const allocator_backend *backend);
 
 int
 init_string_dtype(void);
@@ -137,6 +277,10 @@ init_string_na_object(PyObject *mod);
 int
 stringdtype_setitem(StringDTypeObject *descr, PyObject *obj, char **dataptr);
 
+// Create a StringDType array from a sequence of python strings
+PyObject *
+from_sequence(PyObject *self, PyObject *args, PyObject *kwds);
+
 // set the python error indicator when the gil is released
 void
 gil_error(PyObject *type, const char *msg);
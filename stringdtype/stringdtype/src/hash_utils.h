@@ -0,0 +1,12 @@
+#ifndef _NPY_HASH_UTILS_H
+#define _NPY_HASH_UTILS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns the 64-bit xxHash (XXH64) of the first *len* bytes of *buf*. The
+// result does not depend on the byte order of the platform.
+uint64_t
+xxh64(const char *buf, size_t len, uint64_t seed);
+
+#endif /*_NPY_HASH_UTILS_H */
@@ -5,14 +5,99 @@
 #define NPY_TARGET_VERSION NPY_2_0_API_VERSION
 #include "numpy/arrayobject.h"
 #include "numpy/experimental_dtype_api.h"
+#include "numpy/ufuncobject.h"
 
+#include "allocators.h"
+#include "arrow.h"
 #include "dtype.h"
+#include "sort.h"
 #include "static_string.h"
 #include "umath.h"
+#include "unique.h"
 
 static PyObject *
-_memory_usage(PyObject *NPY_UNUSED(self), PyObject *obj)
+_memory_usage(PyObject *NPY_UNUSED(self), PyObject *args, PyObject *kwds)
 {
+    static char *kwargs_strs[] = {"arr", "detailed", NULL};
+    PyObject *obj = NULL;
+    int detailed = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|p:_memory_usage",
+                                     kwargs_strs, &obj, &detailed)) {
+        return NULL;
+    }
+
+    if (!PyArray_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "can only be called with ndarray object");
+        return NULL;
+    }
+
+    PyArrayObject *arr = (PyArrayObject *)obj;
+
+    PyArray_Descr *descr = PyArray_DESCR(arr);
+    PyArray_DTypeMeta *dtype = NPY_DTYPE(descr);
+
+    if (dtype != (PyArray_DTypeMeta *)&StringDType) {
+        PyErr_SetString(PyExc_TypeError,
+                        "can only be called with a StringDType array");
+        return NULL;
+    }
+
+    StringDTypeObject *sdescr = (StringDTypeObject *)descr;
+    npy_string_memory_usage usage;
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(sdescr);
+    NpyString_memory_usage(allocator, &usage);
+    NpyString_release_allocator_readonly(sdescr);
+
+    size_t packed = PyArray_NBYTES(arr);
+
+    if (!detailed) {
+        return PyLong_FromSize_t(packed + usage.arena_capacity + usage.heap +
+                                 usage.intern_table);
+    }
+
+    return Py_BuildValue(
+            "{s:n,s:n,s:n,s:n,s:n,s:n,s:n,s:n}", "packed", (Py_ssize_t)packed,
+            "arena_capacity", (Py_ssize_t)usage.arena_capacity, "arena_live",
+            (Py_ssize_t)usage.arena_live, "arena_dead",
+            (Py_ssize_t)usage.arena_dead, "arena_prefix",
+            (Py_ssize_t)usage.arena_prefix, "arena_unused",
+            (Py_ssize_t)usage.arena_unused, "heap", (Py_ssize_t)usage.heap,
+            "intern_table", (Py_ssize_t)usage.intern_table);
+}
+
+#ifdef STRINGDTYPE_DEBUG_ALLOCATOR
+static PyObject *
+_set_debug_allocation_limit(PyObject *NPY_UNUSED(self), PyObject *arg)
+{
+    size_t limit = PyLong_AsSize_t(arg);
+    if (limit == (size_t)-1 && PyErr_Occurred()) {
+        return NULL;
+    }
+    set_debug_allocation_limit(limit);
+    Py_RETURN_NONE;
+}
+#endif
+
+// Compaction is only ever requested explicitly. It has to rewrite every
+// packed string that points into the arena, and neither the allocator nor
+// the setitem and ufunc loop hooks numpy calls know which array owns the
+// descriptor, so there is no point during a free or pack where an
+// automatic trigger could find all of the entries.
+static PyObject *
+compact(PyObject *NPY_UNUSED(self), PyObject *args, PyObject *kwds)
+{
+    static char *kwargs_strs[] = {"arr", "threshold", NULL};
+    PyObject *obj = NULL;
+    double threshold = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|d:compact", kwargs_strs,
+                                     &obj, &threshold)) {
+        return NULL;
+    }
+
     if (!PyArray_Check(obj)) {
         PyErr_SetString(PyExc_TypeError,
                         "can only be called with ndarray object");
@@ -30,9 +115,21 @@ _memory_usage(PyObject *NPY_UNUSED(self), PyObject *obj)
         return NULL;
     }
 
-    NpyIter *iter = NpyIter_New(
-            arr, NPY_ITER_READONLY | NPY_ITER_EXTERNAL_LOOP | NPY_ITER_REFS_OK,
-            NPY_KEEPORDER, NPY_NO_CASTING, NULL);
+    // a view might not see all of the strings in the arena
+    if (!PyArray_CHKFLAGS(arr, NPY_ARRAY_OWNDATA)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "can only compact an array that owns its data");
+        return NULL;
+    }
+
+    // Compaction only changes where the string data are stored, not the
+    // contents of the strings, so it is fine to modify the packed strings
+    // through a readonly iterator.
+    NpyIter *iter =
+            NpyIter_New(arr,
+                        NPY_ITER_READONLY | NPY_ITER_EXTERNAL_LOOP |
+                                NPY_ITER_REFS_OK | NPY_ITER_ZEROSIZE_OK,
+                        NPY_KEEPORDER, NPY_NO_CASTING, NULL);
 
     if (iter == NULL) {
         return NULL;
@@ -49,35 +146,154 @@ _memory_usage(PyObject *NPY_UNUSED(self), PyObject *obj)
     npy_intp *strideptr = NpyIter_GetInnerStrideArray(iter);
     npy_intp *innersizeptr = NpyIter_GetInnerLoopSizePtr(iter);
 
-    // initialize with the size of the internal buffer
-    size_t memory_usage = PyArray_NBYTES(arr);
+    StringDTypeObject *sdescr = (StringDTypeObject *)descr;
+    npy_string_allocator *allocator = NpyString_acquire_allocator(sdescr);
+
+    // another thread is writing strings into space reserved in the arena
+    if (NpyString_num_tlabs(allocator) > 0) {
+        NpyString_release_allocator(sdescr);
+        NpyIter_Deallocate(iter);
+        PyErr_SetString(PyExc_RuntimeError,
+                        "cannot compact an array while another thread is "
+                        "writing to it");
+        return NULL;
+    }
+
+    double dead_fraction = NpyString_arena_dead_fraction(allocator);
+
+    if (dead_fraction == 0 || dead_fraction < threshold) {
+        NpyString_release_allocator(sdescr);
+        NpyIter_Deallocate(iter);
+        Py_RETURN_FALSE;
+    }
+
+    // Strings are moved into a copy of the packed strings, which only
+    // replaces the array contents once every string has been moved. If
+    // moving a string fails the array still refers to the old arena, which
+    // is kept.
+    npy_intp size = NpyIter_GetIterSize(iter);
+    npy_intp elsize = descr->elsize;
+    char *staged = PyMem_RawMalloc(size > 0 ? size * elsize : 1);
+
+    if (staged == NULL || NpyString_compact_begin(allocator) < 0) {
+        NpyString_release_allocator(sdescr);
+        NpyIter_Deallocate(iter);
+        PyMem_RawFree(staged);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    int res = 0;
+    char *out = staged;
+
+    if (size > 0) {
+        do {
+            char *in = dataptr[0];
+            npy_intp stride = *strideptr;
+            npy_intp count = *innersizeptr;
+
+            while (count--) {
+                memcpy(out, in, elsize);
+                if (NpyString_compact_entry(
+                            allocator, (npy_packed_static_string *)out) < 0) {
+                    res = -1;
+                    break;
+                }
+                in += stride;
+                out += elsize;
+            }
+
+        } while (res == 0 && iternext(iter));
+    }
 
-    do {
-        char *in = dataptr[0];
-        npy_intp stride = *strideptr;
-        npy_intp count = *innersizeptr;
+    if (res == 0 && size > 0 && NpyIter_Reset(iter, NULL) != NPY_SUCCEED) {
+        res = -1;
+    }
 
-        while (count--) {
-            size_t size = NpyString_size(((npy_packed_static_string *)in));
-            // FIXME: add a way for a string to report its heap size usage
-            if (size > (sizeof(npy_static_string) - 1)) {
-                memory_usage += size;
+    if (res < 0) {
+        NpyString_compact_abort(allocator);
+    }
+    else {
+        out = staged;
+        while (size > 0) {
+            char *in = dataptr[0];
+            npy_intp stride = *strideptr;
+            npy_intp count = *innersizeptr;
+
+            while (count--) {
+                memcpy(in, out, elsize);
+                in += stride;
+                out += elsize;
+            }
+            if (!iternext(iter)) {
+                break;
             }
-            in += stride;
         }
+        NpyString_compact_finish(allocator);
+    }
 
-    } while (iternext(iter));
+    NpyString_release_allocator(sdescr);
 
     NpyIter_Deallocate(iter);
 
-    PyObject *ret = PyLong_FromSize_t(memory_usage);
+    PyMem_RawFree(staged);
+
+    if (res < 0) {
+        PyErr_SetString(PyExc_MemoryError,
+                        "Failed to allocate string while compacting array");
+        return NULL;
+    }
 
-    return ret;
+    Py_RETURN_TRUE;
 }
 
 static PyMethodDef string_methods[] = {
-        {"_memory_usage", _memory_usage, METH_O,
-         "get memory usage for an array"},
+        {"_memory_usage", (PyCFunction)_memory_usage,
+         METH_VARARGS | METH_KEYWORDS,
+         "get the number of bytes used by an array and the strings stored "
+         "by its allocator, which is shared with any views of the array. If "
+         "detailed is True, returns a dict breaking down the memory usage"},
+#ifdef STRINGDTYPE_DEBUG_ALLOCATOR
+        {"_set_debug_allocation_limit", _set_debug_allocation_limit, METH_O,
+         "make allocations of more than limit bytes by StringDType "
+         "instances using the debug allocator fail, or remove the limit if "
+         "limit is zero. For testing out of memory errors"},
+#endif
+        {"compact", (PyCFunction)compact, METH_VARARGS | METH_KEYWORDS,
+         "compact the string storage of an array, releasing the memory "
+         "held by freed strings. If threshold is given, only compacts if "
+         "at least that fraction of the storage is held by freed strings. "
+         "Returns True if the array was compacted. Compaction never "
+         "happens automatically."},
+        {"from_arrow_buffers", (PyCFunction)from_arrow_buffers,
+         METH_VARARGS | METH_KEYWORDS,
+         "create a StringDType array from Arrow-style string buffers: a "
+         "buffer of UTF-8 data, an array of offsets into the data, and an "
+         "optional validity bitmap"},
+        {"from_sequence", (PyCFunction)from_sequence,
+         METH_VARARGS | METH_KEYWORDS,
+         "create a StringDType array from a sequence of strings. "
+         "Equivalent to numpy.array(seq, dtype=dtype), so nested sequences "
+         "give a multidimensional array, but flat lists and tuples of str "
+         "are packed in bulk instead of one element at a time"},
+        {"to_arrow_buffers", to_arrow_buffers, METH_O,
+         "copy the contents of a StringDType array into Arrow-style string "
+         "buffers, returning a tuple of int64 offsets, UTF-8 data, and a "
+         "validity bitmap, or None if there are no null elements"},
+        {"unique", (PyCFunction)unique, METH_VARARGS | METH_KEYWORDS,
+         "find the sorted unique elements of a StringDType array using a "
+         "hash table. Like numpy.unique, optionally returns the index of "
+         "the first occurrence of each unique element, the indices of the "
+         "unique elements that reconstruct the array, and the number of "
+         "times each unique element occurs. Null elements are grouped "
+         "together after all of the strings"},
+        {"searchsorted", (PyCFunction)searchsorted,
+         METH_VARARGS | METH_KEYWORDS,
+         "find the indices where the elements of v should be inserted into "
+         "the sorted StringDType array a to maintain order. Like "
+         "numpy.searchsorted, side selects the first or last suitable index "
+         "and sorter optionally gives the indices that sort a. The "
+         "allocator locks are held for the whole batch of needles"},
         {NULL, NULL, 0, NULL},
 };
 
@@ -89,10 +305,25 @@ static struct PyModuleDef moduledef = {
 };
 
 /* Module initialization function */
+// Adds a ufunc without any legacy loops, init_module_ufuncs adds the
+// StringDType loops
+static int
+add_ufunc(PyObject *m, const char *name, int nin, const char *doc)
+{
+    PyObject *ufunc = PyUFunc_FromFuncAndData(NULL, NULL, NULL, 0, nin, 1,
+                                              PyUFunc_None, name, doc, 0);
+    if (PyModule_AddObject(m, name, ufunc) < 0) {
+        Py_XDECREF(ufunc);
+        return -1;
+    }
+    return 0;
+}
+
 PyMODINIT_FUNC
 PyInit__main(void)
 {
     import_array();
+    import_umath();
 
     if (import_experimental_dtype_api(15) < 0) {
         return NULL;
@@ -117,6 +348,10 @@ PyInit__main(void)
 
     Py_DECREF(mod);
 
+    if (init_allocator_backends() < 0) {
+        goto error;
+    }
+
     if (init_string_dtype() < 0) {
         goto error;
     }
@@ -131,6 +366,45 @@ PyInit__main(void)
         goto error;
     }
 
+    if (add_ufunc(m, "string_hash", 1,
+                  "string_hash(x, /, out=None, *, where=True, "
+                  "casting='same_kind', order='K', dtype=None, subok=True"
+                  "[, signature])\n\n"
+                  "Computes the 64-bit xxHash (XXH64) of the UTF-8 bytes of "
+                  "each string. Equal strings have equal hashes, null "
+                  "elements that are not replaced by the default string all "
+                  "hash to zero.") < 0) {
+        goto error;
+    }
+
+    if (add_ufunc(m, "upper", 1,
+                  "upper(x, /, out=None, *, where=True, casting='same_kind', "
+                  "order='K', dtype=None, subok=True[, signature])\n\n"
+                  "Converts each string to upper case, like str.upper.") < 0) {
+        goto error;
+    }
+
+    if (add_ufunc(m, "lower", 1,
+                  "lower(x, /, out=None, *, where=True, casting='same_kind', "
+                  "order='K', dtype=None, subok=True[, signature])\n\n"
+                  "Converts each string to lower case, like str.lower.") < 0) {
+        goto error;
+    }
+
+    if (add_ufunc(m, "replace", 4,
+                  "replace(x, old, new, count, /, out=None, *, where=True, "
+                  "casting='same_kind', order='K', dtype=None, subok=True[, "
+                  "signature])\n\n"
+                  "Replaces the first count occurrences of old in each "
+                  "string with new, like str.replace. A negative count "
+                  "replaces all of them.") < 0) {
+        goto error;
+    }
+
+    if (init_module_ufuncs(m) < 0) {
+        goto error;
+    }
+
     return m;
 
 error:
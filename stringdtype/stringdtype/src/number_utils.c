@@ -0,0 +1,905 @@
+#include "number_utils.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "numpy/npy_endian.h"
+
+// the ASCII characters int() and float() strip, this excludes the
+// separators 0x1C to 0x1F even though str.isspace() accepts them
+static int
+is_ascii_space(unsigned char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static int
+is_ascii_digit(unsigned char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+#if NPY_BYTE_ORDER == NPY_LITTLE_ENDIAN
+
+// Returns 1 if all eight bytes of *word*, loaded from memory in little
+// endian order, are ASCII digits.
+static int
+is_eight_digits(uint64_t word)
+{
+    return (((word + 0x4646464646464646ULL) |
+             (word - 0x3030303030303030ULL)) &
+            0x8080808080808080ULL) == 0;
+}
+
+// Converts eight ASCII digits to their value with three multiplications,
+// combining pairs of digits, then pairs of those, and so on.
+static uint64_t
+parse_eight_digits(uint64_t word)
+{
+    const uint64_t mask = 0x000000FF000000FFULL;
+    // 100 + (1000000 << 32)
+    const uint64_t mul1 = 0x000F424000000064ULL;
+    // 1 + (10000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ULL;
+    word -= 0x3030303030303030ULL;
+    word = (word * 10) + (word >> 8);
+    word = (((word & mask) * mul1) + (((word >> 16) & mask) * mul2)) >> 32;
+    return word;
+}
+
+#endif
+
+int
+parse_base10_integer(const char *buf, size_t len, uint64_t *magnitude,
+                     int *negative)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    const unsigned char *end = s + len;
+
+    while (s < end && is_ascii_space(*s)) {
+        s++;
+    }
+    while (end > s && is_ascii_space(end[-1])) {
+        end--;
+    }
+
+    *negative = 0;
+    if (s < end && (*s == '+' || *s == '-')) {
+        *negative = (*s == '-');
+        s++;
+    }
+
+    uint64_t value = 0;
+    // underscores are only allowed right after a digit
+    int after_digit = 0;
+    while (s < end) {
+#if NPY_BYTE_ORDER == NPY_LITTLE_ENDIAN
+        if (end - s >= 8) {
+            uint64_t word;
+            memcpy(&word, s, sizeof(word));
+            if (is_eight_digits(word)) {
+                uint64_t digits = parse_eight_digits(word);
+                if (value > (UINT64_MAX - digits) / 100000000) {
+                    return -1;
+                }
+                value = value * 100000000 + digits;
+                s += 8;
+                after_digit = 1;
+                continue;
+            }
+        }
+#endif
+        unsigned char c = *s;
+        if (is_ascii_digit(c)) {
+            uint64_t digit = c - '0';
+            if (value > (UINT64_MAX - digit) / 10) {
+                return -1;
+            }
+            value = value * 10 + digit;
+            after_digit = 1;
+        }
+        else if (c == '_' && after_digit && s + 1 < end &&
+                 is_ascii_digit(s[1])) {
+            after_digit = 0;
+        }
+        else {
+            return -1;
+        }
+        s++;
+    }
+
+    // also rejects strings without any digits
+    if (!after_digit) {
+        return -1;
+    }
+
+    *magnitude = value;
+    return 0;
+}
+
+// "00", "01", ..., "99", so two digits can be written with a single copy
+static const char digit_pairs[201] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+static const uint64_t integer_powers_of_ten[20] = {
+        1ULL,
+        10ULL,
+        100ULL,
+        1000ULL,
+        10000ULL,
+        100000ULL,
+        1000000ULL,
+        10000000ULL,
+        100000000ULL,
+        1000000000ULL,
+        10000000000ULL,
+        100000000000ULL,
+        1000000000000ULL,
+        10000000000000ULL,
+        100000000000000ULL,
+        1000000000000000ULL,
+        10000000000000000ULL,
+        100000000000000000ULL,
+        1000000000000000000ULL,
+        10000000000000000000ULL};
+
+size_t
+uint64_repr_size(uint64_t value)
+{
+    size_t ndigits = 1;
+    while (ndigits < 20 && value >= integer_powers_of_ten[ndigits]) {
+        ndigits++;
+    }
+    return ndigits;
+}
+
+size_t
+int64_repr_size(int64_t value)
+{
+    if (value < 0) {
+        return 1 + uint64_repr_size(0 - (uint64_t)value);
+    }
+    return uint64_repr_size((uint64_t)value);
+}
+
+void
+write_uint64(uint64_t value, size_t size, char *buf)
+{
+    // fill in the digits from the end, two at a time
+    char *p = buf + size;
+    while (value >= 100) {
+        size_t pair = (size_t)(value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        memcpy(p, &digit_pairs[pair], 2);
+    }
+    if (value >= 10) {
+        memcpy(p - 2, &digit_pairs[value * 2], 2);
+    }
+    else {
+        p[-1] = (char)('0' + value);
+    }
+}
+
+void
+write_int64(int64_t value, size_t size, char *buf)
+{
+    if (value < 0) {
+        buf[0] = '-';
+        write_uint64(0 - (uint64_t)value, size - 1, buf + 1);
+    }
+    else {
+        write_uint64((uint64_t)value, size, buf);
+    }
+}
+
+// Unsigned integers with enough precision to compare decimal and binary
+// representations of doubles exactly. The largest values needed, when
+// formatting the smallest subnormals, have about 1140 bits.
+#define BIGNUM_LIMBS 40
+
+typedef struct {
+    // number of limbs in use, the most significant one is never zero
+    int len;
+    uint32_t limbs[BIGNUM_LIMBS];
+} bignum;
+
+static const uint32_t small_powers_of_five[14] = {
+        1,       5,        25,        125,        625,
+        3125,    15625,    78125,     390625,     1953125,
+        9765625, 48828125, 244140625, 1220703125,
+};
+
+static void
+bignum_set(bignum *b, uint64_t value)
+{
+    b->len = 0;
+    while (value != 0) {
+        b->limbs[b->len++] = (uint32_t)value;
+        value >>= 32;
+    }
+}
+
+static void
+bignum_copy(bignum *dst, const bignum *src)
+{
+    dst->len = src->len;
+    memcpy(dst->limbs, src->limbs, src->len * sizeof(uint32_t));
+}
+
+static uint64_t
+bignum_to_u64(const bignum *b)
+{
+    uint64_t value = 0;
+    for (int i = b->len - 1; i >= 0; i--) {
+        value = (value << 32) | b->limbs[i];
+    }
+    return value;
+}
+
+static void
+bignum_mul_small(bignum *b, uint32_t factor)
+{
+    uint64_t carry = 0;
+    for (int i = 0; i < b->len; i++) {
+        carry += (uint64_t)b->limbs[i] * factor;
+        b->limbs[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if (carry != 0) {
+        b->limbs[b->len++] = (uint32_t)carry;
+    }
+}
+
+static void
+bignum_mul_pow5(bignum *b, int n)
+{
+    while (n >= 13) {
+        bignum_mul_small(b, small_powers_of_five[13]);
+        n -= 13;
+    }
+    if (n > 0) {
+        bignum_mul_small(b, small_powers_of_five[n]);
+    }
+}
+
+static void
+bignum_shift_left(bignum *b, int n)
+{
+    if (b->len == 0) {
+        return;
+    }
+    int words = n / 32;
+    int bits = n % 32;
+    uint32_t top = bits ? b->limbs[b->len - 1] >> (32 - bits) : 0;
+    for (int i = b->len - 1; i >= 0; i--) {
+        uint32_t low = (bits && i > 0) ? b->limbs[i - 1] >> (32 - bits) : 0;
+        b->limbs[i + words] = (b->limbs[i] << bits) | low;
+    }
+    for (int i = 0; i < words; i++) {
+        b->limbs[i] = 0;
+    }
+    b->len += words;
+    if (top != 0) {
+        b->limbs[b->len++] = top;
+    }
+}
+
+static void
+bignum_mul_pow10(bignum *b, int n)
+{
+    bignum_mul_pow5(b, n);
+    bignum_shift_left(b, n);
+}
+
+static int
+bignum_cmp(const bignum *a, const bignum *b)
+{
+    if (a->len != b->len) {
+        return a->len < b->len ? -1 : 1;
+    }
+    for (int i = a->len - 1; i >= 0; i--) {
+        if (a->limbs[i] != b->limbs[i]) {
+            return a->limbs[i] < b->limbs[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// out = a + b, out may be the same as a or b
+static void
+bignum_add(bignum *out, const bignum *a, const bignum *b)
+{
+    if (a->len < b->len) {
+        const bignum *t = a;
+        a = b;
+        b = t;
+    }
+    int len = a->len;
+    uint64_t carry = 0;
+    for (int i = 0; i < len; i++) {
+        carry += a->limbs[i];
+        if (i < b->len) {
+            carry += b->limbs[i];
+        }
+        out->limbs[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    out->len = len;
+    if (carry != 0) {
+        out->limbs[out->len++] = (uint32_t)carry;
+    }
+}
+
+// a -= b, requires a >= b
+static void
+bignum_sub(bignum *a, const bignum *b)
+{
+    uint64_t borrow = 0;
+    for (int i = 0; i < a->len; i++) {
+        uint64_t sub = borrow + (i < b->len ? b->limbs[i] : 0);
+        borrow = a->limbs[i] < sub;
+        a->limbs[i] = (uint32_t)(a->limbs[i] - sub);
+    }
+    while (a->len > 0 && a->limbs[a->len - 1] == 0) {
+        a->len--;
+    }
+}
+
+// Returns floor(r / s) and replaces r with the remainder, requires r < 10 * s.
+// The quotient is estimated from the leading limbs and then corrected.
+static uint32_t
+bignum_divmod_digit(bignum *r, const bignum *s, bignum *scratch)
+{
+    if (bignum_cmp(r, s) < 0) {
+        return 0;
+    }
+    int low = s->len > 3 ? s->len - 3 : 0;
+    double rd = 0, sd = 0;
+    for (int i = r->len - 1; i >= low; i--) {
+        rd = rd * 4294967296.0 + r->limbs[i];
+    }
+    for (int i = s->len - 1; i >= low; i--) {
+        sd = sd * 4294967296.0 + s->limbs[i];
+    }
+    uint32_t q = (uint32_t)(rd / sd);
+    if (q < 1) {
+        q = 1;
+    }
+    else if (q > 9) {
+        q = 9;
+    }
+    bignum_copy(scratch, s);
+    bignum_mul_small(scratch, q);
+    if (bignum_cmp(scratch, r) > 0) {
+        q--;
+        bignum_sub(scratch, s);
+    }
+    bignum_sub(r, scratch);
+    if (bignum_cmp(r, s) >= 0) {
+        q++;
+        bignum_sub(r, s);
+    }
+    return q;
+}
+
+// The digit generation loop of shortest_digits for small values of s.
+static int
+shortest_digits_u64(uint64_t r, uint64_t s, uint64_t mplus, uint64_t mminus,
+                    int even, char *digits)
+{
+    int n = 0;
+    for (;;) {
+        r *= 10;
+        mplus *= 10;
+        mminus *= 10;
+        uint32_t digit = (uint32_t)(r / s);
+        r %= s;
+        int low = r < mminus || (r == mminus && even);
+        int high = r + mplus > s || (r + mplus == s && even);
+        if (low && high) {
+            if (2 * r > s || (2 * r == s && (digit & 1))) {
+                digit++;
+            }
+        }
+        else if (high) {
+            digit++;
+        }
+        digits[n++] = (char)('0' + digit);
+        if (low || high) {
+            return n;
+        }
+    }
+}
+
+// Writes the shortest digits that identify the float f * 2**e, with *mbits*
+// explicit mantissa bits and smallest exponent *min_e*, to *digits* and
+// returns how many were written. The value is close to 0.DIGITS * 10**k,
+// where k is stored in *exponent*. This is the free-format algorithm of
+// Steele & White as described by Burger & Dybvig. As in Python's repr(), the
+// halfway points to the neighbouring floats are included if the mantissa is
+// even, because they round to this float, and if two digits are equally
+// close the even one is chosen.
+static int
+shortest_digits(uint64_t f, int e, int mbits, int min_e, char *digits,
+                int *exponent)
+{
+    bignum r, s, mplus, mminus, scratch;
+    // the gap to the next smaller float is half as big at powers of two
+    int unequal = (f == ((uint64_t)1 << mbits) && e > min_e);
+    int even = (f & 1) == 0;
+
+    // v = r / s and the halfway points to the neighbours are at
+    // (r - mminus) / s and (r + mplus) / s
+    bignum_set(&r, f);
+    if (e >= 0) {
+        bignum_shift_left(&r, e + 1 + unequal);
+        bignum_set(&s, 2 << unequal);
+        bignum_set(&mplus, 1);
+        bignum_shift_left(&mplus, e + unequal);
+        bignum_set(&mminus, 1);
+        bignum_shift_left(&mminus, e);
+    }
+    else {
+        bignum_shift_left(&r, 1 + unequal);
+        bignum_set(&s, 1);
+        bignum_shift_left(&s, 1 - e + unequal);
+        bignum_set(&mplus, 1 << unequal);
+        bignum_set(&mminus, 1);
+    }
+
+    // estimate k = floor(log10(v)) + 1 from below, then fix it up
+    int bitlen = 0;
+    while (bitlen < 64 && (f >> bitlen) != 0) {
+        bitlen++;
+    }
+    int k = (int)ceil((e + bitlen - 1) * 0.30102999566398114 - 1e-10);
+    if (k >= 0) {
+        bignum_mul_pow10(&s, k);
+    }
+    else {
+        bignum_mul_pow10(&r, -k);
+        bignum_mul_pow10(&mplus, -k);
+        bignum_mul_pow10(&mminus, -k);
+    }
+    for (;;) {
+        bignum_add(&scratch, &r, &mplus);
+        int c = bignum_cmp(&scratch, &s);
+        if (c < 0 || (c == 0 && !even)) {
+            break;
+        }
+        bignum_mul_small(&s, 10);
+        k++;
+    }
+    *exponent = k;
+
+    // r, mplus and mminus stay below s, so if s < 2**60 the digits can be
+    // generated with 64 bit integers
+    if (s.len <= 2 && bignum_to_u64(&s) < ((uint64_t)1 << 60)) {
+        return shortest_digits_u64(bignum_to_u64(&r), bignum_to_u64(&s),
+                                   bignum_to_u64(&mplus),
+                                   bignum_to_u64(&mminus), even, digits);
+    }
+
+    int n = 0;
+    for (;;) {
+        bignum_mul_small(&r, 10);
+        bignum_mul_small(&mplus, 10);
+        bignum_mul_small(&mminus, 10);
+        uint32_t digit = bignum_divmod_digit(&r, &s, &scratch);
+        int c = bignum_cmp(&r, &mminus);
+        int low = c < 0 || (c == 0 && even);
+        bignum_add(&scratch, &r, &mplus);
+        c = bignum_cmp(&scratch, &s);
+        int high = c > 0 || (c == 0 && even);
+        if (low && high) {
+            bignum_add(&scratch, &r, &r);
+            c = bignum_cmp(&scratch, &s);
+            if (c > 0 || (c == 0 && (digit & 1))) {
+                digit++;
+            }
+        }
+        else if (high) {
+            digit++;
+        }
+        digits[n++] = (char)('0' + digit);
+        if (low || high) {
+            return n;
+        }
+    }
+}
+
+// Formats the IEEE 754 value with the given sign, biased exponent and
+// explicit mantissa bits like numpy's str() for float scalars: positional
+// notation for magnitudes in [1e-4, 1e16) and scientific notation otherwise.
+static int
+format_ieee(int negative, int biased_exponent, uint64_t mantissa, int mbits,
+            int bias, char *buf)
+{
+    char *p = buf;
+    if (biased_exponent == 2 * bias + 1) {
+        if (mantissa != 0) {
+            memcpy(buf, "nan", 3);
+            return 3;
+        }
+        if (negative) {
+            *p++ = '-';
+        }
+        memcpy(p, "inf", 3);
+        return (int)(p - buf) + 3;
+    }
+    if (negative) {
+        *p++ = '-';
+    }
+    if (biased_exponent == 0 && mantissa == 0) {
+        memcpy(p, "0.0", 3);
+        return (int)(p - buf) + 3;
+    }
+
+    int min_e = 1 - bias - mbits;
+    uint64_t f = mantissa;
+    int e = min_e;
+    if (biased_exponent != 0) {
+        f |= (uint64_t)1 << mbits;
+        e = biased_exponent - bias - mbits;
+    }
+
+    char digits[20];
+    int k;
+    int n = shortest_digits(f, e, mbits, min_e, digits, &k);
+
+    double absval = ldexp((double)f, e);
+    if (absval >= 1e-4 && absval < 1e16) {
+        if (k <= 0) {
+            *p++ = '0';
+            *p++ = '.';
+            for (int i = 0; i < -k; i++) {
+                *p++ = '0';
+            }
+            memcpy(p, digits, n);
+            p += n;
+        }
+        else if (k < n) {
+            memcpy(p, digits, k);
+            p += k;
+            *p++ = '.';
+            memcpy(p, digits + k, n - k);
+            p += n - k;
+        }
+        else {
+            memcpy(p, digits, n);
+            p += n;
+            for (int i = n; i < k; i++) {
+                *p++ = '0';
+            }
+            *p++ = '.';
+            *p++ = '0';
+        }
+    }
+    else {
+        *p++ = digits[0];
+        if (n > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, n - 1);
+            p += n - 1;
+        }
+        int exp10 = k - 1;
+        *p++ = 'e';
+        *p++ = exp10 < 0 ? '-' : '+';
+        if (exp10 < 0) {
+            exp10 = -exp10;
+        }
+        if (exp10 >= 100) {
+            *p++ = (char)('0' + exp10 / 100);
+            exp10 %= 100;
+        }
+        *p++ = (char)('0' + exp10 / 10);
+        *p++ = (char)('0' + exp10 % 10);
+    }
+    return (int)(p - buf);
+}
+
+int
+format_float64(double value, char *buf)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return format_ieee((int)(bits >> 63), (int)((bits >> 52) & 0x7FF),
+                       bits & 0xFFFFFFFFFFFFFULL, 52, 1023, buf);
+}
+
+int
+format_float32(float value, char *buf)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return format_ieee((int)(bits >> 31), (int)((bits >> 23) & 0xFF),
+                       bits & 0x7FFFFF, 23, 127, buf);
+}
+
+int
+format_float16(uint16_t value, char *buf)
+{
+    return format_ieee(value >> 15, (value >> 10) & 0x1F, value & 0x3FF, 10,
+                       15, buf);
+}
+
+static const double exact_powers_of_ten[23] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Compares mantissa * 10**exp10 with n * 2**p. *scaled* holds
+// mantissa * 5**exp10 if exp10 is positive and mantissa otherwise.
+static int
+compare_decimal_binary(const bignum *scaled, int exp10, uint64_t n, int p)
+{
+    bignum a, b;
+    bignum_copy(&a, scaled);
+    bignum_set(&b, n);
+    if (exp10 < 0) {
+        bignum_mul_pow5(&b, -exp10);
+    }
+    if (exp10 > p) {
+        bignum_shift_left(&a, exp10 - p);
+    }
+    else {
+        bignum_shift_left(&b, p - exp10);
+    }
+    return bignum_cmp(&a, &b);
+}
+
+// Finds the double nearest to mantissa * 10**exp10 by starting from an
+// approximation and stepping to the neighbouring double while the value is
+// past one of the halfway points, which are checked exactly. Works on the
+// bits of the double so no floating point exceptions are raised for values
+// near the ends of the range. Returns -1 if the approximation is too far
+// off.
+static int
+nearest_double(uint64_t mantissa, int exp10, double *value)
+{
+    // scale by 2**offset so the approximation stays in the normal range
+    int offset = exp10 < 0 ? -600 : 600;
+    double x = ldexp((double)mantissa, -offset);
+    int e = exp10;
+    for (; e > 22; e -= 22) {
+        x *= 1e22;
+    }
+    for (; e < -22; e += 22) {
+        x /= 1e22;
+    }
+    x = e < 0 ? x / exact_powers_of_ten[-e] : x * exact_powers_of_ten[e];
+
+    int e2;
+    uint64_t m = (uint64_t)ldexp(frexp(x, &e2), 53);
+    e2 += offset - 53;
+    uint64_t bits;
+    if (e2 > 971) {
+        // DBL_MAX
+        bits = 0x7FEFFFFFFFFFFFFFULL;
+    }
+    else if (e2 >= -1074) {
+        bits = ((uint64_t)(e2 + 1075) << 52) | (m & 0xFFFFFFFFFFFFFULL);
+    }
+    else {
+        bits = -1074 - e2 < 64 ? m >> (-1074 - e2) : 0;
+    }
+
+    bignum scaled;
+    bignum_set(&scaled, mantissa);
+    if (exp10 > 0) {
+        bignum_mul_pow5(&scaled, exp10);
+    }
+
+    // the bits of positive doubles are ordered like their values, with
+    // infinity after DBL_MAX
+    for (int i = 0; i < 64; i++) {
+        int biased_exponent = (int)(bits >> 52);
+        if (biased_exponent == 0x7FF) {
+            break;
+        }
+        m = bits & 0xFFFFFFFFFFFFFULL;
+        e2 = -1074;
+        if (biased_exponent != 0) {
+            m |= (uint64_t)1 << 52;
+            e2 = biased_exponent - 1075;
+        }
+
+        // ties go to the double with an even mantissa
+        int c = compare_decimal_binary(&scaled, exp10, 2 * m + 1, e2 - 1);
+        if (c > 0 || (c == 0 && (m & 1))) {
+            bits++;
+            if (c > 0) {
+                continue;
+            }
+        }
+        else if (m != 0) {
+            if (m == ((uint64_t)1 << 52) && e2 > -1074) {
+                c = compare_decimal_binary(&scaled, exp10, 4 * m - 1, e2 - 2);
+            }
+            else {
+                c = compare_decimal_binary(&scaled, exp10, 2 * m - 1, e2 - 1);
+            }
+            if (c < 0 || (c == 0 && (m & 1))) {
+                bits--;
+                if (c < 0) {
+                    continue;
+                }
+            }
+        }
+        memcpy(value, &bits, sizeof(bits));
+        return 0;
+    }
+    if (bits == 0x7FF0000000000000ULL) {
+        *value = HUGE_VAL;
+        return 0;
+    }
+    return -1;
+}
+
+// case insensitive comparison with a lowercase word
+static int
+matches_word(const unsigned char *s, size_t len, const char *word)
+{
+    if (strlen(word) != len) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if ((s[i] | 0x20) != (unsigned char)word[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int
+parse_double(const char *buf, size_t len, double *value)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    const unsigned char *end = s + len;
+
+    while (s < end && is_ascii_space(*s)) {
+        s++;
+    }
+    while (end > s && is_ascii_space(end[-1])) {
+        end--;
+    }
+
+    int negative = 0;
+    if (s < end && (*s == '+' || *s == '-')) {
+        negative = (*s == '-');
+        s++;
+    }
+
+    size_t rest = (size_t)(end - s);
+    if (matches_word(s, rest, "inf") || matches_word(s, rest, "infinity")) {
+        *value = negative ? -HUGE_VAL : HUGE_VAL;
+        return 0;
+    }
+    if (matches_word(s, rest, "nan")) {
+        *value = negative ? -NAN : NAN;
+        return 0;
+    }
+
+    // up to 19 significant digits, the value is mantissa * 10**exp10
+    uint64_t mantissa = 0;
+    int ndigits = 0;
+    int exp10 = 0;
+    int seen_digit = 0;
+    int after_digit = 0;
+    int fraction = 0;
+    while (s < end) {
+        unsigned char c = *s;
+        if (is_ascii_digit(c)) {
+            if (mantissa == 0 && c == '0') {
+                // leading zeros are not significant
+                exp10 -= fraction;
+            }
+            else if (ndigits < 19) {
+                mantissa = mantissa * 10 + (c - '0');
+                ndigits++;
+                exp10 -= fraction;
+            }
+            else if (c != '0') {
+                return -1;
+            }
+            else {
+                exp10 += !fraction;
+            }
+            seen_digit = after_digit = 1;
+        }
+        else if (c == '_' && after_digit && s + 1 < end &&
+                 is_ascii_digit(s[1])) {
+            after_digit = 0;
+        }
+        else if (c == '.' && !fraction) {
+            fraction = 1;
+            after_digit = 0;
+        }
+        else {
+            break;
+        }
+        s++;
+    }
+    if (!seen_digit) {
+        return -1;
+    }
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        s++;
+        int exp_negative = 0;
+        if (s < end && (*s == '+' || *s == '-')) {
+            exp_negative = (*s == '-');
+            s++;
+        }
+        int exp_value = 0;
+        after_digit = 0;
+        seen_digit = 0;
+        while (s < end) {
+            unsigned char c = *s;
+            if (is_ascii_digit(c)) {
+                // large enough to overflow or underflow any double
+                if (exp_value < 100000) {
+                    exp_value = exp_value * 10 + (c - '0');
+                }
+                seen_digit = after_digit = 1;
+            }
+            else if (c == '_' && after_digit && s + 1 < end &&
+                     is_ascii_digit(s[1])) {
+                after_digit = 0;
+            }
+            else {
+                break;
+            }
+            s++;
+        }
+        if (!seen_digit) {
+            return -1;
+        }
+        exp10 += exp_negative ? -exp_value : exp_value;
+    }
+    if (s != end) {
+        return -1;
+    }
+
+    double result;
+    if (mantissa == 0) {
+        result = 0.0;
+    }
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+    // both the mantissa and the power of ten are exact doubles, so a single
+    // correctly rounded operation gives the correctly rounded result
+    else if (mantissa <= ((uint64_t)1 << 53) && exp10 >= -22 && exp10 <= 22) {
+        result = (double)mantissa;
+        if (exp10 < 0) {
+            result /= exact_powers_of_ten[-exp10];
+        }
+        else {
+            result *= exact_powers_of_ten[exp10];
+        }
+    }
+#endif
+    // at least 1e310 or less than 1e-342
+    else if (exp10 + ndigits > 310) {
+        result = HUGE_VAL;
+    }
+    else if (exp10 + ndigits < -342) {
+        result = 0.0;
+    }
+    else if (nearest_double(mantissa, exp10, &result) < 0) {
+        return -1;
+    }
+
+    *value = negative ? -result : result;
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef _NPY_NUMBER_UTILS_H
+#define _NPY_NUMBER_UTILS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parses the first *len* bytes of *buf* as a base 10 integer, using the
+// syntax accepted by Python's int(): optional surrounding whitespace, an
+// optional sign, and ASCII digits that may be separated by single
+// underscores. Stores the absolute value in *magnitude* and sets *negative*
+// to 1 for a minus sign and 0 otherwise. Returns 0 on success. Returns -1 if
+// the string can't be parsed this way, either because it is not a valid
+// integer, because it contains non-ASCII characters, or because the absolute
+// value does not fit in 64 bits. Python's int() decides what to do with
+// those strings.
+int
+parse_base10_integer(const char *buf, size_t len, uint64_t *magnitude,
+                     int *negative);
+
+// Returns the length of the base 10 representation of *value*, including
+// the minus sign of negative values.
+size_t
+uint64_repr_size(uint64_t value);
+
+size_t
+int64_repr_size(int64_t value);
+
+// Writes the base 10 representation of *value* to *buf*. *size* must be the
+// length returned by the matching repr_size function. The string is not NUL
+// terminated.
+void
+write_uint64(uint64_t value, size_t size, char *buf);
+
+void
+write_int64(int64_t value, size_t size, char *buf);
+
+// Parses the first *len* bytes of *buf* as a floating point number using the
+// syntax accepted by Python's float() and stores the correctly rounded result
+// in *value*. Returns 0 on success and -1 if the string should be handed to
+// float() instead: invalid strings, non-ASCII strings and strings with more
+// than 19 significant digits.
+int
+parse_double(const char *buf, size_t len, double *value);
+
+// enough space for the longest string written by the format functions
+#define FLOAT_REPR_BUFSIZE 32
+
+// Writes the shortest string that round trips to *value*, formatted like
+// str() of a numpy scalar of the same type, to *buf* and returns its length.
+// For doubles this is the same as Python's repr(). The string is not NUL
+// terminated.
+int
+format_float64(double value, char *buf);
+
+int
+format_float32(float value, char *buf);
+
+// *value* holds the bits of a float16
+int
+format_float16(uint16_t value, char *buf);
+
+#endif /*_NPY_NUMBER_UTILS_H */
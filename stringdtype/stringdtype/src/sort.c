@@ -0,0 +1,741 @@
+#include <Python.h>
+
+#include "sort.h"
+
+#include "static_string.h"
+
+// A string being sorted. *chunk* caches the eight bytes of the string that
+// are compared at the current depth.
+typedef struct {
+    npy_uint64 chunk;
+    const unsigned char *buf;
+    size_t size;
+    // position in the input
+    npy_intp index;
+} sort_key;
+
+#define CHUNK_SIZE sizeof(npy_uint64)
+
+// groups this small are insertion sorted
+#define SMALL_SORT_SIZE 16
+
+// Returns the bytes of *key* starting at *depth* as a big-endian integer,
+// padded with zeros, so integer order is byte order
+static inline npy_uint64
+load_chunk(const sort_key *key, size_t depth)
+{
+    unsigned char bytes[CHUNK_SIZE] = {0};
+    size_t remaining = key->size - depth;
+    if (remaining > 0) {
+        memcpy(bytes, key->buf + depth,
+               remaining < CHUNK_SIZE ? remaining : CHUNK_SIZE);
+    }
+    npy_uint64 chunk = 0;
+    for (size_t i = 0; i < CHUNK_SIZE; i++) {
+        chunk = (chunk << 8) | bytes[i];
+    }
+    return chunk;
+}
+
+static inline void
+swap_keys(sort_key *a, sort_key *b)
+{
+    sort_key tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+// Compares two keys that share their first *depth* bytes
+static inline int
+compare_keys(const sort_key *a, const sort_key *b, size_t depth)
+{
+    size_t min_size = a->size < b->size ? a->size : b->size;
+    if (min_size > depth) {
+        int cmp = memcmp(a->buf + depth, b->buf + depth, min_size - depth);
+        if (cmp != 0) {
+            return cmp;
+        }
+    }
+    return (a->size > b->size) - (a->size < b->size);
+}
+
+static void
+insertion_sort(sort_key *keys, npy_intp n, size_t depth)
+{
+    for (npy_intp i = 1; i < n; i++) {
+        sort_key tmp = keys[i];
+        npy_intp j = i;
+        while (j > 0 && compare_keys(&tmp, &keys[j - 1], depth) < 0) {
+            keys[j] = keys[j - 1];
+            j--;
+        }
+        keys[j] = tmp;
+    }
+}
+
+static void
+sift_down(sort_key *keys, npy_intp start, npy_intp n, size_t depth)
+{
+    npy_intp root = start;
+    while (2 * root + 1 < n) {
+        npy_intp child = 2 * root + 1;
+        if (child + 1 < n &&
+            compare_keys(&keys[child], &keys[child + 1], depth) < 0) {
+            child++;
+        }
+        if (compare_keys(&keys[root], &keys[child], depth) >= 0) {
+            return;
+        }
+        swap_keys(&keys[root], &keys[child]);
+        root = child;
+    }
+}
+
+// Used when the partitioning goes quadratic
+static void
+heap_sort(sort_key *keys, npy_intp n, size_t depth)
+{
+    for (npy_intp i = n / 2 - 1; i >= 0; i--) {
+        sift_down(keys, i, n, depth);
+    }
+    for (npy_intp i = n - 1; i > 0; i--) {
+        swap_keys(&keys[0], &keys[i]);
+        sift_down(keys, 0, i, depth);
+    }
+}
+
+// Returns the length of the prefix shared by all *n* keys, which share at
+// least their first *depth* bytes
+static size_t
+common_prefix(const sort_key *keys, npy_intp n, size_t depth)
+{
+    size_t prefix = keys[0].size;
+    for (npy_intp i = 1; i < n && prefix > depth; i++) {
+        const unsigned char *a = keys[0].buf;
+        const unsigned char *b = keys[i].buf;
+        size_t limit = prefix < keys[i].size ? prefix : keys[i].size;
+        size_t pos = depth;
+        while (pos + CHUNK_SIZE <= limit) {
+            npy_uint64 wa, wb;
+            memcpy(&wa, a + pos, CHUNK_SIZE);
+            memcpy(&wb, b + pos, CHUNK_SIZE);
+            if (wa != wb) {
+                break;
+            }
+            pos += CHUNK_SIZE;
+        }
+        while (pos < limit && a[pos] == b[pos]) {
+            pos++;
+        }
+        prefix = pos;
+    }
+    return prefix;
+}
+
+static inline npy_uint64
+median3(npy_uint64 a, npy_uint64 b, npy_uint64 c)
+{
+    if (a < b) {
+        return b < c ? b : (a < c ? c : a);
+    }
+    return a < c ? a : (b < c ? c : b);
+}
+
+// Multikey quicksort (Bentley and Sedgewick) comparing eight bytes at a
+// time instead of one. The keys share their first *depth* bytes, and
+// *cached* is 1 if their chunks at *depth* are already loaded. Each group
+// is partitioned three ways on the chunks, the smaller and larger parts are
+// sorted at the same depth, and the strings in the middle part either end
+// within the chunk, and so only differ by trailing NUL bytes, or are sorted
+// on the next chunk. Like introsort, groups that are split by too many
+// partitions fall back to a heap sort.
+static void
+multikey_quicksort(sort_key *keys, npy_intp n, size_t depth, int cached,
+                   int depth_limit)
+{
+    while (n > SMALL_SORT_SIZE) {
+        if (!cached) {
+            for (npy_intp i = 0; i < n; i++) {
+                keys[i].chunk = load_chunk(&keys[i], depth);
+            }
+            cached = 1;
+        }
+
+        npy_uint64 pivot = median3(keys[0].chunk, keys[n / 2].chunk,
+                                   keys[n - 1].chunk);
+        // keys[:lt] < pivot, keys[lt:i] == pivot, keys[gt:] > pivot
+        npy_intp lt = 0;
+        npy_intp i = 0;
+        npy_intp gt = n;
+        while (i < gt) {
+            if (keys[i].chunk < pivot) {
+                swap_keys(&keys[lt++], &keys[i++]);
+            }
+            else if (keys[i].chunk > pivot) {
+                swap_keys(&keys[i], &keys[--gt]);
+            }
+            else {
+                i++;
+            }
+        }
+
+        // Only the smaller and larger parts of a split count towards the
+        // limit. Moving on to the next chunk with the keys in the middle
+        // part doesn't, since that work is bounded by the length of the
+        // strings, so long shared prefixes don't use up the limit.
+        int split = lt > 0 || gt < n;
+        if (split) {
+            if (depth_limit == 0) {
+                heap_sort(keys, n, depth);
+                return;
+            }
+            multikey_quicksort(keys, lt, depth, 1, depth_limit - 1);
+            multikey_quicksort(keys + gt, n - gt, depth, 1, depth_limit - 1);
+        }
+
+        // Strings that end in this chunk go first, shortest first. Those of
+        // the same size are equal, so they are counted by size while being
+        // moved to the front and then each one is swapped straight into the
+        // slot for its size.
+        sort_key *equal = keys + lt;
+        npy_intp num_equal = gt - lt;
+        npy_intp num_done = 0;
+        npy_intp next[CHUNK_SIZE + 1] = {0};
+        for (npy_intp j = 0; j < num_equal; j++) {
+            if (equal[j].size <= depth + CHUNK_SIZE) {
+                next[equal[j].size - depth]++;
+                swap_keys(&equal[num_done++], &equal[j]);
+            }
+        }
+        npy_intp end[CHUNK_SIZE + 1];
+        npy_intp start = 0;
+        for (size_t b = 0; b <= CHUNK_SIZE; b++) {
+            end[b] = start + next[b];
+            next[b] = start;
+            start = end[b];
+        }
+        for (size_t b = 0; b <= CHUNK_SIZE; b++) {
+            while (next[b] < end[b]) {
+                size_t k = equal[next[b]].size - depth;
+                if (k == b) {
+                    next[b]++;
+                }
+                else {
+                    swap_keys(&equal[next[b]], &equal[next[k]++]);
+                }
+            }
+        }
+
+        keys = equal + num_done;
+        n = num_equal - num_done;
+        depth += CHUNK_SIZE;
+        cached = 0;
+        if (!split && n > 0) {
+            // Nothing was split off, so the keys might share a long prefix.
+            // Skipping all of it at once reads each string once instead of
+            // going through all of the keys for every chunk.
+            depth = common_prefix(keys, n, depth);
+        }
+    }
+
+    insertion_sort(keys, n, depth);
+}
+
+// Fills in *keys* for the *n* strings at *data*, or at the offsets in
+// *indices* if it is not NULL, and sorts them. Null strings that are not
+// replaced by the default string sort last. Returns the number of keys
+// that were sorted, which excludes the null strings, or -1 on error.
+static npy_intp
+sort_keys(StringDTypeObject *descr, npy_string_allocator *allocator,
+          char *data, npy_intp *indices, npy_intp n, sort_key *keys)
+{
+    int has_null = descr->na_object != NULL;
+    int has_string_na = descr->has_string_na;
+    int has_nan_na = descr->has_nan_na;
+    const npy_static_string *default_string = &descr->default_string;
+    npy_intp elsize = descr->base.elsize;
+    npy_intp num_strings = 0;
+    npy_intp num_nulls = 0;
+
+    for (npy_intp i = 0; i < n; i++) {
+        npy_intp index = indices == NULL ? i : indices[i];
+        const npy_packed_static_string *ps =
+                (npy_packed_static_string *)(data + index * elsize);
+        npy_static_string s = {0, NULL};
+        int is_null = NpyString_load(allocator, ps, &s);
+        if (is_null == -1) {
+            gil_error(PyExc_MemoryError, "Failed to load string in sort");
+            return -1;
+        }
+        sort_key *key = NULL;
+        if (is_null && has_null && !has_string_na) {
+            if (!has_nan_na) {
+                gil_error(PyExc_ValueError,
+                          "Cannot compare null this is not a nan-like value");
+                return -1;
+            }
+            // nulls fill up the keys from the end, so reverse them
+            // afterwards to keep them in order
+            key = &keys[n - 1 - num_nulls++];
+        }
+        else {
+            if (is_null) {
+                s = *default_string;
+            }
+            key = &keys[num_strings++];
+        }
+        key->buf = (const unsigned char *)s.buf;
+        key->size = s.size;
+        key->index = index;
+    }
+
+    for (npy_intp i = 0; i < num_nulls / 2; i++) {
+        swap_keys(&keys[num_strings + i], &keys[n - 1 - i]);
+    }
+
+    int depth_limit = 0;
+    for (npy_intp i = num_strings; i > 1; i >>= 1) {
+        depth_limit += 2;
+    }
+    multikey_quicksort(keys, num_strings, 0, 0, depth_limit);
+
+    return num_strings;
+}
+
+// Implementation of PyArray_SortFunc, for the default quicksort kind
+int
+sort(void *start, npy_intp num, void *arr)
+{
+    StringDTypeObject *descr = (StringDTypeObject *)PyArray_DESCR(arr);
+    npy_intp elsize = descr->base.elsize;
+    if (num < 2) {
+        return 0;
+    }
+
+    sort_key *keys = PyMem_RawMalloc(num * sizeof(sort_key));
+    char *packed = PyMem_RawMalloc(num * elsize);
+    if (keys == NULL || packed == NULL) {
+        PyMem_RawFree(keys);
+        PyMem_RawFree(packed);
+        gil_error(PyExc_MemoryError, "Failed to allocate memory for sort");
+        return -1;
+    }
+
+    // only the packed strings move, so the allocator is not modified
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
+
+    if (sort_keys(descr, allocator, start, NULL, num, keys) < 0) {
+        NpyString_release_allocator_readonly(descr);
+        PyMem_RawFree(keys);
+        PyMem_RawFree(packed);
+        return -1;
+    }
+
+    memcpy(packed, start, num * elsize);
+    for (npy_intp i = 0; i < num; i++) {
+        memcpy((char *)start + i * elsize, packed + keys[i].index * elsize,
+               elsize);
+    }
+
+    NpyString_release_allocator_readonly(descr);
+    PyMem_RawFree(keys);
+    PyMem_RawFree(packed);
+    return 0;
+}
+
+// Implementation of PyArray_ArgSortFunc, for the default quicksort kind
+int
+argsort(void *vv, npy_intp *tosort, npy_intp n, void *arr)
+{
+    StringDTypeObject *descr = (StringDTypeObject *)PyArray_DESCR(arr);
+    if (n < 2) {
+        return 0;
+    }
+
+    sort_key *keys = PyMem_RawMalloc(n * sizeof(sort_key));
+    if (keys == NULL) {
+        gil_error(PyExc_MemoryError, "Failed to allocate memory for argsort");
+        return -1;
+    }
+
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
+
+    npy_intp ret = sort_keys(descr, allocator, vv, tosort, n, keys);
+
+    NpyString_release_allocator_readonly(descr);
+
+    if (ret >= 0) {
+        for (npy_intp i = 0; i < n; i++) {
+            tosort[i] = keys[i].index;
+        }
+    }
+
+    PyMem_RawFree(keys);
+    return ret < 0 ? -1 : 0;
+}
+
+// Compares two keys that share their first *depth* bytes and whose chunks
+// hold the eight bytes after those
+static inline int
+compare_chunked_keys(const sort_key *a, const sort_key *b, size_t depth)
+{
+    if (a->chunk != b->chunk) {
+        return a->chunk < b->chunk ? -1 : 1;
+    }
+    return compare_keys(a, b, depth + CHUNK_SIZE);
+}
+
+// Fills in *key* for the packed string at *ptr*, caching the chunk at
+// *depth*. Returns 1 if the string is a null that is not replaced by the
+// default string, 0 for other strings, and -1 on error.
+static int
+load_search_key(StringDTypeObject *descr, npy_string_allocator *allocator,
+                const char *ptr, npy_intp index, size_t depth, sort_key *key)
+{
+    const npy_packed_static_string *ps = (npy_packed_static_string *)ptr;
+    npy_static_string s = {0, NULL};
+    int is_null = NpyString_load(allocator, ps, &s);
+    if (is_null == -1) {
+        gil_error(PyExc_MemoryError, "Failed to load string in searchsorted");
+        return -1;
+    }
+    if (is_null) {
+        if (descr->na_object != NULL && !descr->has_string_na) {
+            if (!descr->has_nan_na) {
+                gil_error(PyExc_ValueError,
+                          "Cannot compare null this is not a nan-like value");
+                return -1;
+            }
+            return 1;
+        }
+        s = descr->default_string;
+    }
+    key->buf = (const unsigned char *)s.buf;
+    key->size = s.size;
+    key->index = index;
+    key->chunk = key->size > depth ? load_chunk(key, depth) : 0;
+    return 0;
+}
+
+// The strings in a sorted StringDType array, in sorted order
+typedef struct {
+    StringDTypeObject *descr;
+    npy_string_allocator *allocator;
+    const char *data;
+    npy_intp stride;
+    const npy_intp *sorter;
+    npy_intp size;
+    // the prefix shared by all of the strings, which is not cached
+    const unsigned char *prefix;
+    size_t depth;
+} haystack;
+
+static inline const char *
+haystack_ptr(const haystack *h, npy_intp i)
+{
+    return h->data + (h->sorter == NULL ? i : h->sorter[i]) * h->stride;
+}
+
+// Returns the number of strings before the first null, since the nulls
+// sort last, or -1 on error
+static npy_intp
+haystack_num_strings(const haystack *h)
+{
+    npy_intp lo = 0;
+    npy_intp hi = h->size;
+    while (lo < hi) {
+        npy_intp mid = lo + (hi - lo) / 2;
+        sort_key key;
+        int is_null = load_search_key(h->descr, h->allocator,
+                                      haystack_ptr(h, mid), mid, 0, &key);
+        if (is_null == -1) {
+            return -1;
+        }
+        if (is_null) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// Finds the prefix shared by the first *n* strings of the haystack, which
+// in sorted order is the prefix shared by the first and the last of them.
+// Returns -1 on error.
+static int
+haystack_find_prefix(haystack *h, npy_intp n)
+{
+    sort_key first;
+    sort_key last;
+    if (load_search_key(h->descr, h->allocator, haystack_ptr(h, 0), 0, 0,
+                        &first) < 0 ||
+        load_search_key(h->descr, h->allocator, haystack_ptr(h, n - 1), n - 1,
+                        0, &last) < 0) {
+        return -1;
+    }
+    size_t min_size = first.size < last.size ? first.size : last.size;
+    size_t depth = 0;
+    while (depth < min_size && first.buf[depth] == last.buf[depth]) {
+        depth++;
+    }
+    h->prefix = first.buf;
+    h->depth = depth;
+    return 0;
+}
+
+// Compares the start of *needle* to the prefix shared by the strings in the
+// haystack. Needles that don't share it go before or after all of them.
+static inline int
+compare_to_prefix(const haystack *h, const sort_key *needle)
+{
+    size_t size = needle->size < h->depth ? needle->size : h->depth;
+    int cmp = size > 0 ? memcmp(needle->buf, h->prefix, size) : 0;
+    if (cmp == 0 && needle->size < h->depth) {
+        return -1;
+    }
+    return cmp;
+}
+
+// Binary search over the first *n* strings of the haystack, loading them
+// as they are visited. Used when there are too few needles to pay for
+// building a search tree. Returns -1 on error.
+static npy_intp
+haystack_search(const haystack *h, npy_intp n, const sort_key *needle,
+                int right)
+{
+    npy_intp base = 0;
+    while (n > 0) {
+        npy_intp half = n / 2;
+        sort_key key;
+        if (load_search_key(h->descr, h->allocator,
+                            haystack_ptr(h, base + half), base + half,
+                            h->depth, &key) < 0) {
+            return -1;
+        }
+        if (compare_chunked_keys(&key, needle, h->depth) < right) {
+            base += half + 1;
+            n -= half + 1;
+        }
+        else {
+            n = half;
+        }
+    }
+    return base;
+}
+
+// Fills the 1-indexed *tree* with the first *n* strings of the haystack in
+// Eytzinger (breadth first) order, by visiting the tree in order. Returns
+// the number of strings used so far, or -1 on error.
+static npy_intp
+eytzinger_fill(const haystack *h, sort_key *tree, npy_intp i, npy_intp k,
+               npy_intp n)
+{
+    if (k > n) {
+        return i;
+    }
+    i = eytzinger_fill(h, tree, i, 2 * k, n);
+    if (i < 0 ||
+        load_search_key(h->descr, h->allocator, haystack_ptr(h, i), i,
+                        h->depth, &tree[k]) < 0) {
+        return -1;
+    }
+    return eytzinger_fill(h, tree, i + 1, 2 * k + 1, n);
+}
+
+// Searches the Eytzinger *tree* of *n* strings. The descent has no
+// data-dependent branches unless the prefixes tie, and the nodes visited
+// first share cache lines across searches.
+static inline npy_intp
+eytzinger_search(const sort_key *tree, npy_intp n, const sort_key *needle,
+                 size_t depth, int right)
+{
+    npy_intp k = 1;
+    while (k <= n) {
+        k = 2 * k + (compare_chunked_keys(&tree[k], needle, depth) < right);
+    }
+    // the answer is the last node where the search went left, found by
+    // dropping the right turns taken after it
+    while (k & 1) {
+        k >>= 1;
+    }
+    k >>= 1;
+    return k == 0 ? n : tree[k].index;
+}
+
+PyObject *
+searchsorted(PyObject *NPY_UNUSED(self), PyObject *args, PyObject *kwds)
+{
+    static char *kwargs_strs[] = {"a", "v", "side", "sorter", NULL};
+    PyObject *a_obj = NULL;
+    PyObject *v_obj = NULL;
+    const char *side = "left";
+    PyObject *sorter_obj = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|sO:searchsorted",
+                                     kwargs_strs, &a_obj, &v_obj, &side,
+                                     &sorter_obj)) {
+        return NULL;
+    }
+
+    int right = 0;
+    if (strcmp(side, "right") == 0) {
+        right = 1;
+    }
+    else if (strcmp(side, "left") != 0) {
+        PyErr_Format(PyExc_ValueError,
+                     "side must be 'left' or 'right' (got '%s')", side);
+        return NULL;
+    }
+
+    if (!PyArray_Check(a_obj) ||
+        NPY_DTYPE(PyArray_DESCR((PyArrayObject *)a_obj)) !=
+                (PyArray_DTypeMeta *)&StringDType) {
+        PyErr_SetString(PyExc_TypeError,
+                        "can only be called with a StringDType array");
+        return NULL;
+    }
+
+    PyArrayObject *a = (PyArrayObject *)a_obj;
+
+    if (PyArray_NDIM(a) != 1) {
+        PyErr_SetString(PyExc_ValueError, "a must be one dimensional");
+        return NULL;
+    }
+
+    PyArrayObject *needles = NULL;
+    PyArrayObject *sorter = NULL;
+    PyArrayObject *result = NULL;
+    sort_key *tree = NULL;
+    haystack h = {(StringDTypeObject *)PyArray_DESCR(a), NULL,
+                  PyArray_BYTES(a), PyArray_STRIDES(a)[0], NULL,
+                  PyArray_DIMS(a)[0], NULL, 0};
+
+    // needles that are StringDType arrays keep their own descriptor,
+    // anything else is converted to the dtype of the haystack
+    PyArray_Descr *needle_descr = (PyArray_Descr *)h.descr;
+    if (PyArray_Check(v_obj) &&
+        NPY_DTYPE(PyArray_DESCR((PyArrayObject *)v_obj)) ==
+                (PyArray_DTypeMeta *)&StringDType) {
+        needle_descr = PyArray_DESCR((PyArrayObject *)v_obj);
+    }
+    Py_INCREF(needle_descr);
+    // steals the reference to needle_descr
+    needles = (PyArrayObject *)PyArray_FromAny(
+            v_obj, needle_descr, 0, 0,
+            NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED, NULL);
+    if (needles == NULL) {
+        goto finish;
+    }
+
+    if (sorter_obj != Py_None) {
+        sorter = (PyArrayObject *)PyArray_FROM_OTF(
+                sorter_obj, NPY_INTP,
+                NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED |
+                        NPY_ARRAY_FORCECAST);
+        if (sorter == NULL) {
+            goto finish;
+        }
+        if (PyArray_NDIM(sorter) != 1 || PyArray_DIMS(sorter)[0] != h.size) {
+            PyErr_SetString(PyExc_ValueError,
+                            "sorter.size must equal a.size");
+            goto finish;
+        }
+        h.sorter = (npy_intp *)PyArray_DATA(sorter);
+        for (npy_intp i = 0; i < h.size; i++) {
+            if (h.sorter[i] < 0 || h.sorter[i] >= h.size) {
+                PyErr_SetString(PyExc_ValueError,
+                                "Sorter index out of range.");
+                goto finish;
+            }
+        }
+    }
+
+    result = (PyArrayObject *)PyArray_SimpleNew(
+            PyArray_NDIM(needles), PyArray_DIMS(needles), NPY_INTP);
+    if (result == NULL) {
+        goto finish;
+    }
+
+    StringDTypeObject *ndescr = (StringDTypeObject *)PyArray_DESCR(needles);
+    npy_intp num_needles = PyArray_SIZE(needles);
+    npy_intp nstride = PyArray_ITEMSIZE(needles);
+    const char *nptr = PyArray_BYTES(needles);
+    npy_intp *out = (npy_intp *)PyArray_DATA(result);
+    int failed = 0;
+
+    NPY_BEGIN_THREADS_DEF;
+    NPY_BEGIN_THREADS;
+
+    // both locks are held for the whole batch of needles
+    npy_string_allocator *nallocator = NULL;
+    NpyString_acquire_allocator_readonly2(h.descr, ndescr, &h.allocator,
+                                          &nallocator);
+
+    npy_intp num_strings = haystack_num_strings(&h);
+    if (num_strings < 0 ||
+        (num_strings > 0 && haystack_find_prefix(&h, num_strings) < 0)) {
+        failed = 1;
+    }
+
+    // building the tree loads every string once, which is cheaper than
+    // searching the array directly once the needles would load more strings
+    // than that
+    npy_intp depth = 0;
+    for (npy_intp i = num_strings; i > 0; i >>= 1) {
+        depth++;
+    }
+    if (!failed && num_strings > 0 && num_needles * depth >= num_strings) {
+        tree = PyMem_RawMalloc((num_strings + 1) * sizeof(sort_key));
+        if (tree == NULL) {
+            gil_error(PyExc_MemoryError,
+                      "Failed to allocate memory for searchsorted");
+            failed = 1;
+        }
+        else if (eytzinger_fill(&h, tree, 0, 1, num_strings) < 0) {
+            failed = 1;
+        }
+    }
+
+    for (npy_intp i = 0; i < num_needles && !failed; i++) {
+        sort_key needle;
+        int is_null = load_search_key(ndescr, nallocator, nptr, 0, h.depth,
+                                      &needle);
+        int cmp = 0;
+        if (is_null == -1) {
+            failed = 1;
+        }
+        else if (is_null) {
+            out[i] = right ? h.size : num_strings;
+        }
+        else if ((cmp = compare_to_prefix(&h, &needle)) != 0) {
+            out[i] = cmp < 0 ? 0 : num_strings;
+        }
+        else if (tree != NULL) {
+            out[i] = eytzinger_search(tree, num_strings, &needle, h.depth,
+                                      right);
+        }
+        else {
+            out[i] = haystack_search(&h, num_strings, &needle, right);
+            failed = out[i] < 0;
+        }
+        nptr += nstride;
+    }
+
+    NpyString_release_allocator_readonly2(h.descr, ndescr);
+
+    NPY_END_THREADS;
+
+    if (failed) {
+        Py_CLEAR(result);
+    }
+
+finish:
+    PyMem_RawFree(tree);
+    Py_XDECREF(needles);
+    Py_XDECREF(sorter);
+    return PyArray_Return(result);
+}
@@ -0,0 +1,20 @@
+#ifndef _NPY_SORT_H
+#define _NPY_SORT_H
+
+#include "dtype.h"
+
+// Sorts the packed strings at *start* with a multikey quicksort on the
+// string bytes
+int
+sort(void *start, npy_intp num, void *arr);
+
+// Like sort, for the strings at the offsets in *tosort*
+int
+argsort(void *vv, npy_intp *tosort, npy_intp n, void *arr);
+
+// Finds the indices where the elements of v should be inserted into the
+// sorted StringDType array a to keep it sorted
+PyObject *
+searchsorted(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif /*_NPY_SORT_H */
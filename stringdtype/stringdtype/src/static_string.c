@@ -46,6 +46,9 @@ typedef union _npy_static_string_u {
 #define NPY_STRING_ON_HEAP 0x10      // 0001 0000
 #define NPY_STRING_MEDIUM 0x08       // 0000 1000
 #define NPY_STRING_FLAG_MASK 0xF8    // 1111 1000
+// Only meaningful for arena strings, since it overlaps with the size of
+// short strings. Marks a string stored in an entry of the intern table.
+#define NPY_STRING_INTERNED 0x04     // 0000 0100
 
 // short string sizes fit in a 4-bit integer
 #define NPY_SHORT_STRING_SIZE_MASK 0x0F  // 0000 1111
@@ -66,17 +69,95 @@ const _npy_static_string_u empty_string_u = {
 #define HIGH_BYTE_MASK ((size_t)0XFF << 8 * (sizeof(size_t) - 1))
 #define VSTRING_SIZE(string) (string->vstring.size_and_flags & ~HIGH_BYTE_MASK)
 
+// one size class per possible bit in the size of an allocation
+#define NPY_STRING_NUM_SIZE_CLASSES (8 * sizeof(size_t))
+// How many size classes above the smallest one that might satisfy a request
+// to look in for a freed allocation. Using a larger allocation wastes at
+// most a factor of 2**(NPY_STRING_FREE_LIST_SEARCH + 1) in space.
+#define NPY_STRING_FREE_LIST_SEARCH 2
+
+// The arena is made up of chunks that never move once they are allocated,
+// so growing the arena never copies string data and pointers into the arena
+// stay valid as it grows. Each chunk is at least twice as big as the one
+// before it. Arena offsets store the index of the chunk in the high byte and
+// the position in the chunk in the remaining bytes.
+#define NPY_STRING_MAX_CHUNKS 32
+#define NPY_STRING_FIRST_CHUNK_SIZE 256
+#define NPY_STRING_CHUNK_SHIFT (8 * (sizeof(size_t) - 1))
+#define NPY_STRING_MAX_CHUNK_SIZE ((size_t)1 << NPY_STRING_CHUNK_SHIFT)
+#define ARENA_OFFSET(chunk, pos) \
+    (((size_t)(chunk) << NPY_STRING_CHUNK_SHIFT) | (pos))
+#define ARENA_CHUNK(offset) ((offset) >> NPY_STRING_CHUNK_SHIFT)
+#define ARENA_POS(offset) ((offset) & (NPY_STRING_MAX_CHUNK_SIZE - 1))
+
+// maximum number of bytes reserved at a time by a thread-local allocation
+// buffer, unless a single string needs more
+#define NPY_STRING_TLAB_SIZE 4096
+
 typedef struct npy_string_arena {
+    char *chunks[NPY_STRING_MAX_CHUNKS];
+    size_t chunk_sizes[NPY_STRING_MAX_CHUNKS];
+    int num_chunks;
+    // position of the next allocation in the last chunk
     size_t cursor;
+    // total size of all the chunks
     size_t size;
-    char *buffer;
+    // number of bytes, including size prefixes, handed out by the arena
+    size_t used;
+    // number of bytes, including size prefixes, in freed entries that have
+    // not been reused
+    size_t dead;
+    // number of bytes taken up by the size prefixes of live entries
+    size_t prefix;
+    // Heads of the free lists, indexed by size class. Each list links
+    // together freed allocations with sizes in [2**i, 2**(i + 1)). Links
+    // are arena offsets and are stored in the first bytes of the freed
+    // allocations. Zero marks the end of a list, since it can never be the
+    // offset of an allocation.
+    size_t free_lists[NPY_STRING_NUM_SIZE_CLASSES];
 } npy_string_arena;
 
+// An entry in the intern table of an allocator. Packed strings with the
+// same contents all refer to the same arena allocation, which is only freed
+// once all of them have been freed.
+typedef struct npy_string_intern_entry {
+    size_t hash;
+    // arena offset of the string, zero marks an empty slot
+    size_t offset;
+    size_t size;
+    size_t refcount;
+    // NPY_STRING_MEDIUM if the allocation has a one byte size prefix
+    unsigned char flags;
+} npy_string_intern_entry;
+
+// the intern table is grown when it gets more than half full
+#define NPY_STRING_INTERN_MIN_CAPACITY 64
+
 struct npy_string_allocator {
     npy_string_malloc_func malloc;
     npy_string_free_func free;
     npy_string_realloc_func realloc;
     npy_string_arena arena;
+    // the arena live strings are copied out of during a compaction
+    npy_string_arena *old_arena;
+    // the intern table of the old arena, restored if a compaction fails
+    npy_string_intern_entry *old_intern_table;
+    size_t old_intern_capacity;
+    size_t old_intern_count;
+    // number of thread-local allocation buffers with reserved arena space
+    int num_tlabs;
+    // number of bytes in strings allocated on the heap
+    size_t heap;
+    // if nonzero, freed strings are never reused and every new string is
+    // appended to the arena
+    int bump;
+    // if nonzero, strings with the same contents share an allocation
+    int intern;
+    // open addressing hash table with linear probing, the capacity is
+    // always a power of two
+    npy_string_intern_entry *intern_table;
+    size_t intern_capacity;
+    size_t intern_count;
 };
 
 void
@@ -87,6 +168,16 @@ set_vstring_size(_npy_static_string_u *str, size_t size)
     str->direct_buffer.size_and_flags = current_flags;
 }
 
+char *
+arena_pointer(npy_string_arena *arena, size_t offset)
+{
+    size_t chunk = ARENA_CHUNK(offset);
+    if (chunk >= (size_t)arena->num_chunks) {
+        return NULL;
+    }
+    return arena->chunks[chunk] + ARENA_POS(offset);
+}
+
 char *
 vstring_buffer(npy_string_arena *arena, _npy_static_string_u *string)
 {
@@ -94,95 +185,410 @@ vstring_buffer(npy_string_arena *arena, _npy_static_string_u *string)
     if (flags & NPY_STRING_ON_HEAP) {
         return (char *)string->vstring.offset;
     }
-    if (arena->buffer == NULL) {
-        return NULL;
-    }
-    return (char *)((size_t)arena->buffer + string->vstring.offset);
+    return arena_pointer(arena, string->vstring.offset);
 }
 
-#define ARENA_EXPAND_FACTOR 1.25
+int
+is_medium_string(const _npy_static_string_u *s)
+{
+    unsigned char high_byte = s->direct_buffer.size_and_flags;
+    int has_short_flag = (high_byte & NPY_STRING_SHORT);
+    int has_medium_flag = (high_byte & NPY_STRING_MEDIUM);
+    return (!has_short_flag && has_medium_flag);
+}
 
-char *
-arena_malloc(npy_string_arena *arena, npy_string_realloc_func r, size_t size)
+// number of bytes used in the arena by an allocation of *size* bytes,
+// including the prefix storing the size of the allocation
+size_t
+arena_storage_size(size_t size)
 {
-    // one extra size_t to store the size of the allocation
-    size_t string_storage_size;
     if (size <= NPY_MEDIUM_STRING_MAX_SIZE) {
-        string_storage_size = size + sizeof(unsigned char);
+        return size + sizeof(unsigned char);
     }
-    else {
-        string_storage_size = size + sizeof(size_t);
+    return size + sizeof(size_t);
+}
+
+// Returns the size of the arena allocation backing *string*, which may be
+// larger than the size of the string if the allocation has been reused for
+// a shorter string. The size is stored in the byte just before *buf* for
+// medium strings and in the size_t just before *buf* otherwise.
+size_t
+arena_allocation_size(const _npy_static_string_u *string, const char *buf)
+{
+    if (is_medium_string(string)) {
+        return (size_t)(*(const unsigned char *)(buf - 1));
     }
-    if ((arena->size - arena->cursor) <= string_storage_size) {
-        // realloc the buffer so there is enough room
-        // first guess is to double the size of the buffer
-        size_t newsize;
-        if (arena->size == 0) {
-            newsize = string_storage_size;
+    // not necessarily memory-aligned, so need to use memcpy
+    size_t alloc_size;
+    memcpy(&alloc_size, buf - sizeof(size_t), sizeof(size_t));
+    return alloc_size;
+}
+
+int
+size_class(size_t size)
+{
+    int ret = 0;
+    while (size >>= 1) {
+        ret++;
+    }
+    return ret;
+}
+
+// Accounts for a freed arena allocation with room for *alloc_size* bytes.
+void
+mark_dead(npy_string_arena *arena, size_t alloc_size)
+{
+    arena->dead += arena_storage_size(alloc_size);
+    arena->prefix -= arena_storage_size(alloc_size) - alloc_size;
+}
+
+// Adds the arena allocation at *buf* with room for *alloc_size* bytes to the
+// free list for its size class.
+void
+free_list_push(npy_string_arena *arena, char *buf, size_t offset,
+               size_t alloc_size)
+{
+    size_t *head = &arena->free_lists[size_class(alloc_size)];
+    // arena allocations are at least as big as a short string so there is
+    // always room for the link
+    memcpy(buf, head, sizeof(size_t));
+    *head = offset;
+    mark_dead(arena, alloc_size);
+}
+
+// Removes a freed arena allocation with room for at least *size* bytes from
+// the free lists and returns a pointer to it, or returns NULL if there is no
+// suitable allocation. Sets *offset* to the offset of the allocation and
+// *alloc_size* to its size.
+char *
+free_list_pop(npy_string_arena *arena, size_t size, size_t *offset,
+              size_t *alloc_size)
+{
+    int cls = size_class(size);
+    int last = cls + NPY_STRING_FREE_LIST_SEARCH + 1;
+    if (last >= (int)NPY_STRING_NUM_SIZE_CLASSES) {
+        last = NPY_STRING_NUM_SIZE_CLASSES - 1;
+    }
+    for (; cls <= last; cls++) {
+        size_t *head = &arena->free_lists[cls];
+        if (*head == 0) {
+            continue;
         }
-        else if (((ARENA_EXPAND_FACTOR * arena->size) - arena->cursor) >
-                 string_storage_size) {
-            newsize = ARENA_EXPAND_FACTOR * arena->size;
+        char *buf = arena_pointer(arena, *head);
+        // allocations in the first size class that might fit can still be
+        // too small, all larger size classes always fit
+        size_t freed_size;
+        if (cls <= size_class(NPY_MEDIUM_STRING_MAX_SIZE)) {
+            freed_size = (size_t)(*(unsigned char *)(buf - 1));
         }
         else {
-            newsize = arena->size + string_storage_size;
+            memcpy(&freed_size, buf - sizeof(size_t), sizeof(size_t));
         }
-        if ((arena->cursor + size) >= newsize) {
-            // need extra room beyond the expansion factor, leave some padding
-            newsize = ARENA_EXPAND_FACTOR * (arena->cursor + size);
+        if (freed_size < size) {
+            continue;
         }
-        // passing a NULL buffer to realloc is the same as malloc
-        char *newbuf = r(arena->buffer, newsize);
-        if (newbuf == NULL) {
-            return NULL;
-        }
-        memset(newbuf + arena->cursor, 0, newsize - arena->cursor);
-        arena->buffer = newbuf;
-        arena->size = newsize;
+        *offset = *head;
+        memcpy(head, buf, sizeof(size_t));
+        arena->dead -= arena_storage_size(freed_size);
+        arena->prefix += arena_storage_size(freed_size) - freed_size;
+        *alloc_size = freed_size;
+        return buf;
     }
-    char *ret;
+    return NULL;
+}
+
+// Writes the size prefix for an allocation of *size* bytes at *size_loc*
+// and returns the size of the prefix.
+size_t
+write_size_prefix(char *size_loc, size_t size)
+{
     if (size <= NPY_MEDIUM_STRING_MAX_SIZE) {
-        unsigned char *size_loc =
-                (unsigned char *)&arena->buffer[arena->cursor];
-        *size_loc = size;
-        ret = &arena->buffer[arena->cursor + sizeof(char)];
+        *(unsigned char *)size_loc = (unsigned char)size;
+        return sizeof(unsigned char);
     }
-    else {
-        char *size_ptr = (char *)&arena->buffer[arena->cursor];
-        memcpy(size_ptr, &size, sizeof(size_t));
-        ret = &arena->buffer[arena->cursor + sizeof(size_t)];
+    memcpy(size_loc, &size, sizeof(size_t));
+    return sizeof(size_t);
+}
+
+// Returns the size of the biggest allocation that fits in *space* bytes of
+// arena memory, taking into account that the size prefix depends on the
+// allocation size, or zero if the space is too small to be worth reusing.
+size_t
+largest_allocation_size(size_t space)
+{
+    if (space < arena_storage_size(NPY_SHORT_STRING_MAX_SIZE + 1)) {
+        return 0;
     }
-    arena->cursor += string_storage_size;
-    return ret;
+    size_t alloc_size = space - sizeof(unsigned char);
+    if (alloc_size > NPY_MEDIUM_STRING_MAX_SIZE) {
+        alloc_size = space - sizeof(size_t);
+        if (alloc_size <= NPY_MEDIUM_STRING_MAX_SIZE) {
+            alloc_size = NPY_MEDIUM_STRING_MAX_SIZE;
+        }
+    }
+    return alloc_size;
+}
+
+// Allocates *size* bytes from the last chunk, which must have room.
+char *
+arena_bump(npy_string_arena *arena, size_t size, size_t *offset)
+{
+    int chunk = arena->num_chunks - 1;
+    char *size_loc = arena->chunks[chunk] + arena->cursor;
+    size_t prefix_size = write_size_prefix(size_loc, size);
+    *offset = ARENA_OFFSET(chunk, arena->cursor + prefix_size);
+    arena->cursor += prefix_size + size;
+    arena->used += prefix_size + size;
+    arena->prefix += prefix_size;
+    return size_loc + prefix_size;
 }
 
+// Adds a chunk of *size* bytes to the arena. The unused space at the end
+// of the current last chunk goes on the free lists. Returns -1 if the
+// arena cannot have any more chunks or memory allocation fails.
 int
-arena_free(npy_string_arena *arena, _npy_static_string_u *str)
+arena_add_chunk(npy_string_arena *arena, npy_string_malloc_func m,
+                size_t size)
 {
-    if (arena->size == 0 && arena->cursor == 0 && arena->buffer == NULL) {
+    if (arena->num_chunks == NPY_STRING_MAX_CHUNKS ||
+        size > NPY_STRING_MAX_CHUNK_SIZE) {
+        return -1;
+    }
+    char *buf = m(size);
+    if (buf == NULL) {
+        return -1;
+    }
+    if (arena->num_chunks > 0) {
+        size_t remaining =
+                arena->chunk_sizes[arena->num_chunks - 1] - arena->cursor;
+        size_t alloc_size = largest_allocation_size(remaining);
+        if (alloc_size > 0) {
+            size_t offset = 0;
+            char *tail = arena_bump(arena, alloc_size, &offset);
+            free_list_push(arena, tail, offset, alloc_size);
+        }
+    }
+    arena->chunks[arena->num_chunks] = buf;
+    arena->chunk_sizes[arena->num_chunks] = size;
+    arena->num_chunks += 1;
+    arena->cursor = 0;
+    arena->size += size;
+    return 0;
+}
+
+char *
+arena_malloc(npy_string_arena *arena, npy_string_malloc_func m, size_t size,
+             size_t *offset)
+{
+    size_t string_storage_size = arena_storage_size(size);
+    if (arena->num_chunks == 0 ||
+        (arena->chunk_sizes[arena->num_chunks - 1] - arena->cursor) <
+                string_storage_size) {
+        size_t newsize = NPY_STRING_FIRST_CHUNK_SIZE;
+        if (arena->num_chunks > 0) {
+            newsize = 2 * arena->chunk_sizes[arena->num_chunks - 1];
+        }
+        if (newsize < string_storage_size) {
+            newsize = string_storage_size;
+        }
+        if (newsize > NPY_STRING_MAX_CHUNK_SIZE) {
+            newsize = NPY_STRING_MAX_CHUNK_SIZE;
+        }
+        if (newsize < string_storage_size ||
+            arena_add_chunk(arena, m, newsize) < 0) {
+            return NULL;
+        }
+    }
+    return arena_bump(arena, size, offset);
+}
+
+// Frees the arena allocation backing *str*. The allocation is only made
+// available for reuse if *reuse* is nonzero.
+int
+arena_free(npy_string_arena *arena, _npy_static_string_u *str, int reuse)
+{
+    if (arena->num_chunks == 0) {
         // empty arena, nothing to do
         return 0;
     }
 
-    char *ptr = vstring_buffer(arena, str);
-    if (ptr == NULL) {
+    size_t offset = str->vstring.offset;
+    size_t chunk = ARENA_CHUNK(offset);
+    if (chunk >= (size_t)arena->num_chunks) {
         return -1;
     }
+    size_t pos = ARENA_POS(offset);
     size_t size = VSTRING_SIZE(str);
-    uintptr_t buf_start = (uintptr_t)arena->buffer;
-    uintptr_t ptr_loc = (uintptr_t)ptr;
-    uintptr_t end_loc = ptr_loc + size;
-    uintptr_t buf_end = buf_start + arena->size;
-    if (ptr_loc < buf_start || ptr_loc > buf_end || end_loc > buf_end) {
+    if (pos > arena->chunk_sizes[chunk] ||
+        size > arena->chunk_sizes[chunk] - pos) {
         return -1;
     }
 
-    memset(ptr, 0, size);
+    char *ptr = arena->chunks[chunk] + pos;
+    if (reuse) {
+        free_list_push(arena, ptr, offset, arena_allocation_size(str, ptr));
+    }
+    else {
+        mark_dead(arena, arena_allocation_size(str, ptr));
+    }
+
+    return 0;
+}
+
+void
+arena_release(npy_string_arena *arena, npy_string_free_func f)
+{
+    for (int i = 0; i < arena->num_chunks; i++) {
+        f(arena->chunks[i]);
+    }
+}
+
+// Hashes *size* bytes of *buf* eight bytes at a time.
+size_t
+string_hash(const char *buf, size_t size)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ size;
+    while (size >= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, buf, sizeof(uint64_t));
+        h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+        buf += sizeof(uint64_t);
+        size -= sizeof(uint64_t);
+    }
+    if (size > 0) {
+        uint64_t word = 0;
+        memcpy(&word, buf, size);
+        h = (h ^ word) * 0xC4CEB9FE1A85EC53ULL;
+    }
+    h ^= h >> 29;
+    return (size_t)h;
+}
+
+// Returns the entry for the string with contents *buf* in the intern
+// table, or NULL if there is no such entry.
+npy_string_intern_entry *
+intern_find(npy_string_allocator *allocator, const char *buf, size_t size,
+            size_t hash)
+{
+    if (allocator->intern_count == 0) {
+        return NULL;
+    }
+    size_t mask = allocator->intern_capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        npy_string_intern_entry *entry = &allocator->intern_table[i];
+        if (entry->offset == 0) {
+            return NULL;
+        }
+        if (entry->hash == hash && entry->size == size &&
+            memcmp(arena_pointer(&allocator->arena, entry->offset), buf,
+                   size) == 0) {
+            return entry;
+        }
+    }
+}
+
+// Returns the entry for the string at arena offset *offset*, which hashes
+// to *hash*, or NULL if the string isn't in the intern table.
+npy_string_intern_entry *
+intern_find_offset(npy_string_allocator *allocator, size_t offset,
+                   size_t hash)
+{
+    if (allocator->intern_count == 0) {
+        return NULL;
+    }
+    size_t mask = allocator->intern_capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        npy_string_intern_entry *entry = &allocator->intern_table[i];
+        if (entry->offset == 0) {
+            return NULL;
+        }
+        if (entry->offset == offset) {
+            return entry;
+        }
+    }
+}
 
+// Adds a string that is not in the table yet with a reference count of
+// one. Returns -1 if growing the table fails.
+int
+intern_insert(npy_string_allocator *allocator, size_t hash, size_t offset,
+              size_t size, unsigned char flags)
+{
+    if (2 * (allocator->intern_count + 1) > allocator->intern_capacity) {
+        size_t new_capacity = 2 * allocator->intern_capacity;
+        if (new_capacity < NPY_STRING_INTERN_MIN_CAPACITY) {
+            new_capacity = NPY_STRING_INTERN_MIN_CAPACITY;
+        }
+        npy_string_intern_entry *new_table = allocator->malloc(
+                new_capacity * sizeof(npy_string_intern_entry));
+        if (new_table == NULL) {
+            return -1;
+        }
+        memset(new_table, 0, new_capacity * sizeof(npy_string_intern_entry));
+        size_t mask = new_capacity - 1;
+        for (size_t i = 0; i < allocator->intern_capacity; i++) {
+            npy_string_intern_entry *entry = &allocator->intern_table[i];
+            if (entry->offset == 0) {
+                continue;
+            }
+            size_t j = entry->hash & mask;
+            while (new_table[j].offset != 0) {
+                j = (j + 1) & mask;
+            }
+            new_table[j] = *entry;
+        }
+        allocator->free(allocator->intern_table);
+        allocator->intern_table = new_table;
+        allocator->intern_capacity = new_capacity;
+    }
+    size_t mask = allocator->intern_capacity - 1;
+    size_t i = hash & mask;
+    while (allocator->intern_table[i].offset != 0) {
+        i = (i + 1) & mask;
+    }
+    npy_string_intern_entry *entry = &allocator->intern_table[i];
+    entry->hash = hash;
+    entry->offset = offset;
+    entry->size = size;
+    entry->refcount = 1;
+    entry->flags = flags;
+    allocator->intern_count += 1;
     return 0;
 }
 
-static npy_string_arena NEW_ARENA = {0, 0, NULL};
+// Removes *entry* from the table, moving later entries in its probe
+// sequence back so that lookups don't need tombstones.
+void
+intern_remove(npy_string_allocator *allocator, npy_string_intern_entry *entry)
+{
+    npy_string_intern_entry *table = allocator->intern_table;
+    size_t mask = allocator->intern_capacity - 1;
+    size_t hole = entry - table;
+    for (size_t i = (hole + 1) & mask; table[i].offset != 0;
+         i = (i + 1) & mask) {
+        size_t home = table[i].hash & mask;
+        // move the entry into the hole unless its home slot lies in
+        // (hole, i], in which case the hole doesn't break its probe sequence
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            table[hole] = table[i];
+            hole = i;
+        }
+    }
+    table[hole].offset = 0;
+    allocator->intern_count -= 1;
+}
+
+void
+intern_clear(npy_string_allocator *allocator)
+{
+    allocator->free(allocator->intern_table);
+    allocator->intern_table = NULL;
+    allocator->intern_capacity = 0;
+    allocator->intern_count = 0;
+}
+
+static const npy_string_arena NEW_ARENA = {{NULL}, {0}, 0, 0, 0, 0, 0, 0, {0}};
 
 npy_string_allocator *
 NpyString_new_allocator(npy_string_malloc_func m, npy_string_free_func f,
@@ -195,8 +601,19 @@ NpyString_new_allocator(npy_string_malloc_func m, npy_string_free_func f,
     allocator->malloc = m;
     allocator->free = f;
     allocator->realloc = r;
-    // arena buffer gets allocated in arena_malloc
+    // arena chunks get allocated in arena_malloc
     allocator->arena = NEW_ARENA;
+    allocator->old_arena = NULL;
+    allocator->old_intern_table = NULL;
+    allocator->old_intern_capacity = 0;
+    allocator->old_intern_count = 0;
+    allocator->num_tlabs = 0;
+    allocator->heap = 0;
+    allocator->bump = 0;
+    allocator->intern = 0;
+    allocator->intern_table = NULL;
+    allocator->intern_capacity = 0;
+    allocator->intern_count = 0;
     return allocator;
 }
 
@@ -205,9 +622,8 @@ NpyString_free_allocator(npy_string_allocator *allocator)
 {
     npy_string_free_func f = allocator->free;
 
-    if (allocator->arena.buffer != NULL) {
-        f(allocator->arena.buffer);
-    }
+    arena_release(&allocator->arena, f);
+    f(allocator->intern_table);
 
     f(allocator);
 }
@@ -222,15 +638,6 @@ is_short_string(const npy_packed_static_string *s)
     return has_short_flag && !has_on_heap_flag;
 }
 
-int
-is_medium_string(const _npy_static_string_u *s)
-{
-    unsigned char high_byte = s->direct_buffer.size_and_flags;
-    int has_short_flag = (high_byte & NPY_STRING_SHORT);
-    int has_medium_flag = (high_byte & NPY_STRING_MEDIUM);
-    return (!has_short_flag && has_medium_flag);
-}
-
 int
 NpyString_isnull(const npy_packed_static_string *s)
 {
@@ -290,60 +697,69 @@ NpyString_load(npy_string_allocator *allocator,
     return 0;
 }
 
+// Allocates *size* bytes on the heap for a string with flags *flags*.
+char *
+heap_allocate(npy_string_allocator *allocator, unsigned char *flags,
+              size_t size, size_t *offset)
+{
+    char *buf = allocator->malloc(sizeof(char) * size);
+    if (buf == NULL) {
+        return NULL;
+    }
+    allocator->heap += size;
+    *flags |= NPY_STRING_ON_HEAP;
+    *offset = (size_t)buf;
+    return buf;
+}
+
+// Returns a buffer with room for *size* bytes and sets *offset* to the
+// value the vstring offset should be set to, either an arena offset or the
+// address of a heap allocation.
 char *
 heap_or_arena_allocate(npy_string_allocator *allocator,
                        _npy_static_string_u *to_init_u, size_t size,
-                       int *on_heap)
+                       size_t *offset)
 {
     unsigned char *flags = &to_init_u->direct_buffer.size_and_flags;
-    if (*flags & NPY_STRING_SHORT) {
-        // Have to heap allocate since there isn't a preexisting
-        // allocation. This leaves the NPY_STRING_SHORT flag set to indicate
-        // that there is no room in the arena buffer for strings in this
-        // entry
-        *flags |= NPY_STRING_ON_HEAP;
-        *on_heap = 1;
-        return allocator->malloc(sizeof(char) * size);
-    }
     npy_string_arena *arena = &allocator->arena;
     if (arena == NULL) {
         return NULL;
     }
-    if (*flags & NPY_STRING_ARENA_FREED) {
-        // Check if there's room for the new string in the existing
-        // allocation. The size is stored one size_t "behind" the beginning of
-        // the allocation.
-        char *buf = vstring_buffer(arena, to_init_u);
-        if (buf == NULL) {
-            return NULL;
-        }
-        size_t alloc_size;
-        if (is_medium_string(to_init_u)) {
-            // stored in a char so direct access is OK
-            alloc_size = (size_t) * (buf - 1);
-        }
-        else {
-            // not necessarily memory-aligned, so need to use memcpy
-            size_t *size_loc = (size_t *)((uintptr_t)buf - sizeof(size_t));
-            memcpy(&alloc_size, size_loc, sizeof(size_t));
-        }
-        if (size <= alloc_size) {
-            // we have room!
-            *flags &= ~NPY_STRING_ARENA_FREED;
+    if (!allocator->bump) {
+        // Any entry can reuse an allocation freed by any other entry
+        size_t alloc_size = 0;
+        char *buf = free_list_pop(arena, size, offset, &alloc_size);
+        if (buf != NULL) {
+            *flags &= ~(NPY_STRING_SHORT | NPY_STRING_ARENA_FREED);
+            if (alloc_size <= NPY_MEDIUM_STRING_MAX_SIZE) {
+                *flags |= NPY_STRING_MEDIUM;
+            }
+            else {
+                *flags &= ~NPY_STRING_MEDIUM;
+            }
             return buf;
         }
-        else {
-            // No room, resort to a heap allocation.
-            *flags = NPY_STRING_ON_HEAP;
-            *on_heap = 1;
-            return allocator->malloc(sizeof(char) * size);
-        }
     }
-    // string isn't previously allocated, so add to existing arena allocation
-    char *ret = arena_malloc(arena, allocator->realloc, sizeof(char) * size);
-    if (size < NPY_MEDIUM_STRING_MAX_SIZE) {
+    // Append to the arena, even if the entry held a string before. Growth
+    // of the arena is bounded by the free lists and by compaction, so
+    // replacing strings doesn't need a heap allocation per entry.
+    char *ret = arena_malloc(arena, allocator->malloc, sizeof(char) * size,
+                             offset);
+    if (ret == NULL) {
+        // The arena can't grow any more, so fall back to the heap. The
+        // NPY_STRING_ARENA_FREED flag marks that there is no room in the
+        // arena for the string in this entry.
+        *flags &= ~NPY_STRING_MEDIUM;
+        *flags |= NPY_STRING_ARENA_FREED;
+        return heap_allocate(allocator, flags, size, offset);
+    }
+    *flags &= ~(NPY_STRING_SHORT | NPY_STRING_ARENA_FREED);
+    if (size <= NPY_MEDIUM_STRING_MAX_SIZE) {
         *flags |= NPY_STRING_MEDIUM;
     }
+    else {
+        *flags &= ~NPY_STRING_MEDIUM;
+    }
     return ret;
 }
 
@@ -357,33 +773,112 @@ heap_or_arena_deallocate(npy_string_allocator *allocator,
         // deallocated with free(). For heap strings the offset is a raw
         // address so this cast is safe.
         allocator->free((char *)str_u->vstring.offset);
+        allocator->heap -= VSTRING_SIZE(str_u);
         if (*flags & NPY_STRING_SHORT) {
             *flags = 0 | NPY_STRING_SHORT;
         }
         else {
+            // the size and address are left behind, so the entry must be
+            // marked as freed to make freeing it again a no-op
             *flags &= ~NPY_STRING_ON_HEAP;
+            *flags |= NPY_STRING_ARENA_FREED;
         }
     }
+    else if (*flags & NPY_STRING_ARENA_FREED) {
+        // Already freed, for example by free_and_copy followed by
+        // NpyString_pack_null. The allocation may belong to another string
+        // by now, so it must not be released again.
+        return 0;
+    }
     else if (VSTRING_SIZE(str_u) != 0) {
         npy_string_arena *arena = &allocator->arena;
         if (arena == NULL) {
             return -1;
         }
-        if (arena_free(arena, str_u) < 0) {
+        if (*flags & NPY_STRING_INTERNED) {
+            size_t size = VSTRING_SIZE(str_u);
+            char *buf = arena_pointer(arena, str_u->vstring.offset);
+            if (buf == NULL) {
+                return -1;
+            }
+            npy_string_intern_entry *entry = intern_find_offset(
+                    allocator, str_u->vstring.offset, string_hash(buf, size));
+            if (entry == NULL) {
+                return -1;
+            }
+            // only drop the flag once this string's reference is released,
+            // a string still marked as interned is never freed on its own
+            *flags &= ~NPY_STRING_INTERNED;
+            entry->refcount -= 1;
+            if (entry->refcount > 0) {
+                // other strings still refer to the allocation
+                *flags |= NPY_STRING_ARENA_FREED;
+                return 0;
+            }
+            intern_remove(allocator, entry);
+        }
+        if (arena_free(arena, str_u, !allocator->bump) < 0) {
             return -1;
         }
-        if (arena->buffer != NULL) {
+        if (arena->num_chunks > 0) {
             str_u->direct_buffer.size_and_flags |= NPY_STRING_ARENA_FREED;
         }
     }
     return 0;
 }
 
+// Like NpyString_newsize, but shares the allocation of an existing string
+// with the same contents if there is one.
+int
+intern_newsize(const char *init, size_t size, _npy_static_string_u *to_init_u,
+               npy_string_allocator *allocator)
+{
+    if (size > NPY_MAX_STRING_SIZE) {
+        return -1;
+    }
+    unsigned char *flags = &to_init_u->direct_buffer.size_and_flags;
+    size_t hash = string_hash(init, size);
+    npy_string_intern_entry *entry =
+            intern_find(allocator, init, size, hash);
+    if (entry != NULL) {
+        entry->refcount += 1;
+        unsigned char kept_flags =
+                *flags & ~(NPY_STRING_SHORT | NPY_STRING_ARENA_FREED |
+                           NPY_STRING_ON_HEAP | NPY_STRING_MEDIUM |
+                           NPY_SHORT_STRING_SIZE_MASK);
+        to_init_u->vstring.offset = entry->offset;
+        set_vstring_size(to_init_u, size);
+        *flags = kept_flags | entry->flags | NPY_STRING_INTERNED;
+        return 0;
+    }
+
+    if (NpyString_newemptysize(size, (npy_packed_static_string *)to_init_u,
+                               allocator) < 0) {
+        return -1;
+    }
+    memcpy(vstring_buffer(&allocator->arena, to_init_u), init, size);
+    if (*flags & NPY_STRING_ON_HEAP) {
+        return 0;
+    }
+    // if the table can't grow the string just isn't shared
+    if (intern_insert(allocator, hash, to_init_u->vstring.offset, size,
+                      *flags & NPY_STRING_MEDIUM) == 0) {
+        *flags |= NPY_STRING_INTERNED;
+    }
+    return 0;
+}
+
 int
 NpyString_newsize(const char *init, size_t size,
                   npy_packed_static_string *to_init,
                   npy_string_allocator *allocator)
 {
+    _npy_static_string_u *to_init_u = ((_npy_static_string_u *)to_init);
+
+    if (allocator->intern && size > NPY_SHORT_STRING_MAX_SIZE) {
+        return intern_newsize(init, size, to_init_u, allocator);
+    }
+
     if (NpyString_newemptysize(size, to_init, allocator) < 0) {
         return -1;
     }
@@ -392,8 +887,6 @@ NpyString_newsize(const char *init, size_t size,
         return 0;
     }
 
-    _npy_static_string_u *to_init_u = ((_npy_static_string_u *)to_init);
-
     char *buf = NULL;
 
     if (size > NPY_SHORT_STRING_MAX_SIZE) {
@@ -428,23 +921,14 @@ NpyString_newemptysize(size_t size, npy_packed_static_string *out,
     }
 
     if (size > NPY_SHORT_STRING_MAX_SIZE) {
-        int on_heap = 0;
-        char *buf = heap_or_arena_allocate(allocator, out_u, size, &on_heap);
+        size_t offset = 0;
+        char *buf = heap_or_arena_allocate(allocator, out_u, size, &offset);
 
         if (buf == NULL) {
             return -1;
         }
 
-        if (on_heap) {
-            out_u->vstring.offset = (size_t)buf;
-        }
-        else {
-            npy_string_arena *arena = &allocator->arena;
-            if (arena == NULL) {
-                return -1;
-            }
-            out_u->vstring.offset = (size_t)buf - (size_t)arena->buffer;
-        }
+        out_u->vstring.offset = offset;
         set_vstring_size(out_u, size);
     }
     else {
@@ -463,9 +947,10 @@ NpyString_free(npy_packed_static_string *str, npy_string_allocator *allocator)
 {
     _npy_static_string_u *str_u = (_npy_static_string_u *)str;
     if (is_not_a_vstring(str)) {
-        // zero out, keeping flags
+        // zero out, keeping flags except for the null flag
         unsigned char *flags = &str_u->direct_buffer.size_and_flags;
-        unsigned char current_flags = *flags & ~NPY_SHORT_STRING_SIZE_MASK;
+        unsigned char current_flags =
+                *flags & ~(NPY_SHORT_STRING_SIZE_MASK | NPY_STRING_MISSING);
         memcpy(str_u, &empty_string_u, sizeof(_npy_static_string_u));
         *flags |= current_flags;
     }
@@ -504,26 +989,13 @@ NpyString_dup(const npy_packed_static_string *in,
         out_u->direct_buffer.size_and_flags |= flags;
         return 0;
     }
-    char *in_buf = NULL;
-    npy_string_arena *arena = &in_allocator->arena;
-    if (arena->buffer == NULL) {
+    // arena chunks never move, so the input buffer stays valid even if
+    // allocating the output string grows the arena
+    char *in_buf = vstring_buffer(&in_allocator->arena, in_u);
+    if (in_buf == NULL) {
         return -1;
     }
-    int used_malloc = 0;
-    if (in_allocator == out_allocator && is_a_vstring(in)) {
-        in_buf = in_allocator->malloc(size);
-        memcpy(in_buf, vstring_buffer(arena, in_u), size);
-        used_malloc = 1;
-    }
-    else {
-        in_buf = vstring_buffer(arena, in_u);
-    }
-    int ret =
-            NpyString_newsize(in_buf, VSTRING_SIZE(in_u), out, out_allocator);
-    if (used_malloc) {
-        in_allocator->free(in_buf);
-    }
-    return ret;
+    return NpyString_newsize(in_buf, size, out, out_allocator);
 }
 
 int
@@ -533,8 +1005,9 @@ NpyString_cmp(const npy_static_string *s1, const npy_static_string *s2)
 
     int cmp = 0;
 
-    if (minsize != 0) {
-        cmp = strncmp(s1->buf, s2->buf, minsize);
+    // interned strings with the same contents share a buffer
+    if (minsize != 0 && s1->buf != s2->buf) {
+        cmp = memcmp(s1->buf, s2->buf, minsize);
     }
 
     if (cmp == 0) {
@@ -549,6 +1022,71 @@ NpyString_cmp(const npy_static_string *s1, const npy_static_string *s2)
     return cmp;
 }
 
+int
+NpyString_eq(const npy_static_string *s1, const npy_static_string *s2)
+{
+    if (s1->size != s2->size) {
+        return 0;
+    }
+    return s1->size == 0 || s1->buf == s2->buf ||
+           memcmp(s1->buf, s2->buf, s1->size) == 0;
+}
+
+#if NPY_BYTE_ORDER == NPY_LITTLE_ENDIAN
+
+// the string data of a short string starts at the beginning of the packed
+// string, so the whole buffer can be compared a word at a time
+static inline int
+short_string_eq(const _npy_static_string_u *s1, const _npy_static_string_u *s2,
+                size_t size)
+{
+    // masks[16 - size:] starts with *size* bytes that are all ones, enough
+    // to mask out everything but the string data
+    static const unsigned char masks[32] = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    };
+    size_t w1[2], w2[2], mask[2];
+    memcpy(w1, s1, sizeof(w1));
+    memcpy(w2, s2, sizeof(w2));
+    memcpy(mask, masks + 16 - size, sizeof(mask));
+    return (((w1[0] ^ w2[0]) & mask[0]) | ((w1[1] ^ w2[1]) & mask[1])) == 0;
+}
+
+#else
+
+static inline int
+short_string_eq(const _npy_static_string_u *s1, const _npy_static_string_u *s2,
+                size_t size)
+{
+    return memcmp(s1->direct_buffer.buf, s2->direct_buffer.buf, size) == 0;
+}
+
+#endif
+
+int
+NpyString_packed_eq(npy_string_allocator *allocator1,
+                    const npy_packed_static_string *s1,
+                    npy_string_allocator *allocator2,
+                    const npy_packed_static_string *s2)
+{
+    if (NpyString_size(s1) != NpyString_size(s2)) {
+        return 0;
+    }
+    if (is_short_string(s1) && is_short_string(s2)) {
+        return short_string_eq((const _npy_static_string_u *)s1,
+                               (const _npy_static_string_u *)s2,
+                               NpyString_size(s1));
+    }
+    npy_static_string u1 = {0, NULL};
+    npy_static_string u2 = {0, NULL};
+    if (NpyString_load(allocator1, s1, &u1) < 0 ||
+        NpyString_load(allocator2, s2, &u2) < 0) {
+        return -1;
+    }
+    return NpyString_eq(&u1, &u2);
+}
+
 size_t
 NpyString_size(const npy_packed_static_string *packed_string)
 {
@@ -591,3 +1129,375 @@ NpyString_pack_null(npy_string_allocator *allocator,
     *flags = current_flags | NPY_STRING_MISSING;
     return 0;
 }
+
+size_t
+NpyString_arena_storage_size(size_t size)
+{
+    if (size <= NPY_SHORT_STRING_MAX_SIZE) {
+        return 0;
+    }
+    return arena_storage_size(size);
+}
+
+int
+NpyString_arena_reserve(npy_string_allocator *allocator, size_t size)
+{
+    npy_string_arena *arena = &allocator->arena;
+    if (size == 0 || (arena->num_chunks > 0 &&
+                      (arena->chunk_sizes[arena->num_chunks - 1] -
+                       arena->cursor) >= size)) {
+        return 0;
+    }
+    size_t newsize = NPY_STRING_FIRST_CHUNK_SIZE;
+    if (arena->num_chunks > 0) {
+        newsize = 2 * arena->chunk_sizes[arena->num_chunks - 1];
+    }
+    if (newsize < size) {
+        newsize = size;
+    }
+    if (newsize > NPY_STRING_MAX_CHUNK_SIZE) {
+        // strings that don't fit will end up on the heap
+        newsize = NPY_STRING_MAX_CHUNK_SIZE;
+    }
+    return arena_add_chunk(arena, allocator->malloc, newsize);
+}
+
+double
+NpyString_arena_dead_fraction(const npy_string_allocator *allocator)
+{
+    const npy_string_arena *arena = &allocator->arena;
+    if (arena->used == 0) {
+        return 0;
+    }
+    return (double)arena->dead / (double)arena->used;
+}
+
+int
+NpyString_compact_begin(npy_string_allocator *allocator)
+{
+    npy_string_arena *old_arena = allocator->malloc(sizeof(npy_string_arena));
+    if (old_arena == NULL) {
+        return -1;
+    }
+    npy_string_arena compacted = NEW_ARENA;
+    // Live strings never need more space in the compacted arena than they
+    // use in the current one, so one chunk of this size holds all of them.
+    // If it can't be allocated, the compacted arena grows as strings are
+    // moved instead.
+    size_t live_size = allocator->arena.used - allocator->arena.dead;
+    if (live_size > NPY_STRING_MAX_CHUNK_SIZE) {
+        live_size = NPY_STRING_MAX_CHUNK_SIZE;
+    }
+    if (live_size > 0) {
+        arena_add_chunk(&compacted, allocator->malloc, live_size);
+    }
+    *old_arena = allocator->arena;
+    allocator->arena = compacted;
+    allocator->old_arena = old_arena;
+    // interned strings are added back to a new table as they are moved
+    allocator->old_intern_table = allocator->intern_table;
+    allocator->old_intern_capacity = allocator->intern_capacity;
+    allocator->old_intern_count = allocator->intern_count;
+    allocator->intern_table = NULL;
+    allocator->intern_capacity = 0;
+    allocator->intern_count = 0;
+    return 0;
+}
+
+int
+NpyString_compact_entry(npy_string_allocator *allocator,
+                        npy_packed_static_string *packed_string)
+{
+    _npy_static_string_u *str_u = (_npy_static_string_u *)packed_string;
+    unsigned char *flags = &str_u->direct_buffer.size_and_flags;
+
+    if (*flags & NPY_STRING_ON_HEAP) {
+        // heap strings don't live in the arena
+        return 0;
+    }
+
+    if (is_not_a_vstring(packed_string)) {
+        // any arena allocation this entry used to refer to is going away
+        *flags &= ~NPY_STRING_ARENA_FREED;
+        return 0;
+    }
+
+    size_t size = VSTRING_SIZE(str_u);
+
+    if ((*flags & NPY_STRING_ARENA_FREED) || size == 0) {
+        memcpy(str_u, &empty_string_u, sizeof(_npy_static_string_u));
+        return 0;
+    }
+
+    char *old_buf = vstring_buffer(allocator->old_arena, str_u);
+    if (old_buf == NULL) {
+        return -1;
+    }
+
+    size_t hash = 0;
+    if (*flags & NPY_STRING_INTERNED) {
+        hash = string_hash(old_buf, size);
+        npy_string_intern_entry *entry =
+                intern_find(allocator, old_buf, size, hash);
+        if (entry != NULL) {
+            // another string with the same contents has been moved already
+            entry->refcount += 1;
+            str_u->vstring.offset = entry->offset;
+            *flags = entry->flags | NPY_STRING_INTERNED;
+            return 0;
+        }
+    }
+
+    size_t offset = 0;
+    char *buf = arena_malloc(&allocator->arena, allocator->malloc, size,
+                             &offset);
+    if (buf == NULL) {
+        return -1;
+    }
+    memcpy(buf, old_buf, size);
+    str_u->vstring.offset = offset;
+    unsigned char interned = *flags & NPY_STRING_INTERNED;
+    if (size <= NPY_MEDIUM_STRING_MAX_SIZE) {
+        *flags = NPY_STRING_MEDIUM;
+    }
+    else {
+        *flags = 0;
+    }
+    if (interned && intern_insert(allocator, hash, offset, size,
+                                  *flags & NPY_STRING_MEDIUM) == 0) {
+        *flags |= NPY_STRING_INTERNED;
+    }
+    return 0;
+}
+
+void
+NpyString_compact_finish(npy_string_allocator *allocator)
+{
+    arena_release(allocator->old_arena, allocator->free);
+    allocator->free(allocator->old_arena);
+    allocator->old_arena = NULL;
+    allocator->free(allocator->old_intern_table);
+    allocator->old_intern_table = NULL;
+    allocator->old_intern_capacity = 0;
+    allocator->old_intern_count = 0;
+}
+
+void
+NpyString_compact_abort(npy_string_allocator *allocator)
+{
+    arena_release(&allocator->arena, allocator->free);
+    allocator->free(allocator->intern_table);
+    allocator->arena = *allocator->old_arena;
+    allocator->free(allocator->old_arena);
+    allocator->old_arena = NULL;
+    allocator->intern_table = allocator->old_intern_table;
+    allocator->intern_capacity = allocator->old_intern_capacity;
+    allocator->intern_count = allocator->old_intern_count;
+    allocator->old_intern_table = NULL;
+    allocator->old_intern_capacity = 0;
+    allocator->old_intern_count = 0;
+}
+
+void
+NpyString_tlab_init(npy_string_tlab *tlab, npy_string_allocator *allocator)
+{
+    tlab->allocator = allocator;
+    tlab->buf = NULL;
+    tlab->offset = 0;
+    tlab->remaining = 0;
+    tlab->prefix = 0;
+    tlab->reserved = 0;
+}
+
+int
+NpyString_tlab_newemptysize(npy_string_tlab *tlab, size_t size,
+                            npy_packed_static_string *out, char **buf)
+{
+    if (size > NPY_MAX_STRING_SIZE) {
+        return -1;
+    }
+
+    _npy_static_string_u *out_u = (_npy_static_string_u *)out;
+    unsigned char flags =
+            out_u->direct_buffer.size_and_flags & ~NPY_SHORT_STRING_SIZE_MASK;
+
+    if (is_a_vstring(out) && VSTRING_SIZE(out_u) != 0 &&
+        (!(flags & NPY_STRING_ARENA_FREED) || (flags & NPY_STRING_ON_HEAP))) {
+        // freeing the existing allocation needs the allocator lock. Heap
+        // strings can be live even though NPY_STRING_ARENA_FREED is set.
+        return 1;
+    }
+
+    if (size > NPY_SHORT_STRING_MAX_SIZE) {
+        size_t storage_size = arena_storage_size(size);
+        if (tlab->buf == NULL || tlab->remaining < storage_size) {
+            return 1;
+        }
+        size_t prefix_size = write_size_prefix(tlab->buf, size);
+        *buf = tlab->buf + prefix_size;
+        out_u->vstring.offset = tlab->offset + prefix_size;
+        out_u->vstring.size_and_flags = size;
+        flags &= ~(NPY_STRING_SHORT | NPY_STRING_ARENA_FREED |
+                   NPY_STRING_MISSING);
+        if (size <= NPY_MEDIUM_STRING_MAX_SIZE) {
+            flags |= NPY_STRING_MEDIUM;
+        }
+        else {
+            flags &= ~NPY_STRING_MEDIUM;
+        }
+        out_u->direct_buffer.size_and_flags = flags;
+        tlab->buf += storage_size;
+        tlab->offset += storage_size;
+        tlab->remaining -= storage_size;
+        tlab->prefix += prefix_size;
+        return 0;
+    }
+
+    // short strings don't need any arena space
+    flags &= ~NPY_STRING_MISSING;
+    if (size == 0) {
+        memcpy(out_u, &empty_string_u, sizeof(_npy_static_string_u));
+        out_u->direct_buffer.size_and_flags |= flags;
+    }
+    else {
+        out_u->direct_buffer.size_and_flags = NPY_STRING_SHORT | flags | size;
+    }
+    *buf = out_u->direct_buffer.buf;
+    return 0;
+}
+
+// Puts the unused part of the buffer on the free lists and empties the
+// buffer.
+void
+tlab_retire(npy_string_tlab *tlab)
+{
+    if (tlab->buf == NULL) {
+        return;
+    }
+    npy_string_allocator *allocator = tlab->allocator;
+    npy_string_arena *arena = &allocator->arena;
+    // all of the reserved space already counts as used, so space that
+    // can't be reused counts as dead
+    NpyString_tlab_sync(tlab);
+    size_t alloc_size = 0;
+    if (!allocator->bump) {
+        alloc_size = largest_allocation_size(tlab->remaining);
+    }
+    if (alloc_size > 0) {
+        size_t prefix_size = write_size_prefix(tlab->buf, alloc_size);
+        arena->prefix += prefix_size;
+        free_list_push(arena, tlab->buf + prefix_size,
+                       tlab->offset + prefix_size, alloc_size);
+        arena->dead += tlab->remaining - arena_storage_size(alloc_size);
+    }
+    else {
+        arena->dead += tlab->remaining;
+    }
+    allocator->num_tlabs -= 1;
+    size_t reserved = tlab->reserved;
+    NpyString_tlab_init(tlab, allocator);
+    tlab->reserved = reserved;
+}
+
+void
+NpyString_tlab_sync(npy_string_tlab *tlab)
+{
+    tlab->allocator->arena.prefix += tlab->prefix;
+    tlab->prefix = 0;
+}
+
+int
+NpyString_tlab_refill(npy_string_tlab *tlab, size_t size)
+{
+    size_t storage_size = arena_storage_size(size);
+    if (tlab->buf != NULL && tlab->remaining >= storage_size) {
+        return 0;
+    }
+    tlab_retire(tlab);
+
+    npy_string_allocator *allocator = tlab->allocator;
+    npy_string_arena *arena = &allocator->arena;
+    size_t available = 0;
+    if (arena->num_chunks > 0) {
+        available = arena->chunk_sizes[arena->num_chunks - 1] - arena->cursor;
+    }
+    if (available < storage_size) {
+        size_t newsize = NPY_STRING_FIRST_CHUNK_SIZE;
+        if (arena->num_chunks > 0) {
+            newsize = 2 * arena->chunk_sizes[arena->num_chunks - 1];
+        }
+        if (newsize < storage_size) {
+            newsize = storage_size;
+        }
+        if (newsize > NPY_STRING_MAX_CHUNK_SIZE) {
+            newsize = NPY_STRING_MAX_CHUNK_SIZE;
+        }
+        if (newsize < storage_size ||
+            arena_add_chunk(arena, allocator->malloc, newsize) < 0) {
+            return -1;
+        }
+        available = newsize;
+    }
+
+    // Reserve as much as has been reserved so far, up to
+    // NPY_STRING_TLAB_SIZE, so a loop that only writes a few small strings
+    // doesn't take a whole buffer's worth of the arena.
+    size_t reserved = tlab->reserved + storage_size;
+    if (reserved > NPY_STRING_TLAB_SIZE) {
+        reserved = NPY_STRING_TLAB_SIZE;
+    }
+    if (reserved < storage_size) {
+        reserved = storage_size;
+    }
+    if (reserved > available) {
+        reserved = available;
+    }
+    int chunk = arena->num_chunks - 1;
+    tlab->buf = arena->chunks[chunk] + arena->cursor;
+    tlab->offset = ARENA_OFFSET(chunk, arena->cursor);
+    tlab->remaining = reserved;
+    tlab->reserved += reserved;
+    arena->cursor += reserved;
+    arena->used += reserved;
+    allocator->num_tlabs += 1;
+    return 0;
+}
+
+void
+NpyString_tlab_release(npy_string_tlab *tlab)
+{
+    tlab_retire(tlab);
+}
+
+int
+NpyString_num_tlabs(const npy_string_allocator *allocator)
+{
+    return allocator->num_tlabs;
+}
+
+void
+NpyString_memory_usage(const npy_string_allocator *allocator,
+                       npy_string_memory_usage *usage)
+{
+    const npy_string_arena *arena = &allocator->arena;
+    usage->arena_capacity = arena->size;
+    usage->arena_live = arena->used - arena->dead - arena->prefix;
+    usage->arena_dead = arena->dead;
+    usage->arena_prefix = arena->prefix;
+    usage->arena_unused = arena->size - arena->used;
+    usage->heap = allocator->heap;
+    usage->intern_table =
+            allocator->intern_capacity * sizeof(npy_string_intern_entry);
+}
+
+void
+NpyString_set_bump_allocation(npy_string_allocator *allocator)
+{
+    allocator->bump = 1;
+}
+
+void
+NpyString_set_interning(npy_string_allocator *allocator)
+{
+    allocator->intern = 1;
+}
@@ -29,6 +29,23 @@ npy_string_allocator *
 NpyString_new_allocator(npy_string_malloc_func m, npy_string_free_func f,
                         npy_string_realloc_func r);
 
+// Makes *allocator* a bump allocator: every new string is appended to the
+// arena, even if the packed string held an allocation before, and freed
+// strings are never reused until the arena is compacted. This avoids all of
+// the free list bookkeeping for data that is written once. Must be called
+// before anything is allocated.
+void
+NpyString_set_bump_allocation(npy_string_allocator *allocator);
+
+// Makes *allocator* intern the strings it allocates with NpyString_newsize,
+// NpyString_pack, and NpyString_dup: strings with the same contents share a
+// single reference counted arena allocation, which is freed when the last
+// string referring to it is freed. Strings allocated with
+// NpyString_newemptysize are never shared, since the caller writes their
+// contents afterwards. Must be called before anything is allocated.
+void
+NpyString_set_interning(npy_string_allocator *allocator);
+
 // Deallocates the internal buffer and the allocator itself.
 void
 NpyString_free_allocator(npy_string_allocator *allocator);
@@ -86,11 +103,28 @@ NpyString_newemptysize(size_t size, npy_packed_static_string *out,
 int
 NpyString_isnull(const npy_packed_static_string *in);
 
-// Compare two strings. Has the same semantics as if strcmp were passed
-// null-terminated C strings with the contents of *s1* and *s2*.
+// Compare two strings. Has the same semantics as memcmp, with a string
+// that is a prefix of the other string comparing as less than it. Embedded
+// null characters are compared like any other character.
 int
 NpyString_cmp(const npy_static_string *s1, const npy_static_string *s2);
 
+// Returns 1 if *s1* and *s2* have the same contents and 0 otherwise.
+// Cheaper than NpyString_cmp, since strings with different sizes are never
+// equal.
+int
+NpyString_eq(const npy_static_string *s1, const npy_static_string *s2);
+
+// Returns 1 if the packed strings *s1* and *s2*, neither of which may be a
+// null string, have the same contents and 0 otherwise. Compares the sizes
+// first, and compares short strings without unpacking them. Returns -1 if
+// unpacking either string fails.
+int
+NpyString_packed_eq(npy_string_allocator *allocator1,
+                    const npy_packed_static_string *s1,
+                    npy_string_allocator *allocator2,
+                    const npy_packed_static_string *s2);
+
 // Copy and pack the first *size* entries of the buffer pointed to by *buf*
 // into the *packed_string*. Returns 0 on success and -1 on failure.
 int
@@ -113,7 +147,9 @@ NpyString_pack_null(npy_string_allocator *allocator,
 // null string, sets *unpacked_string* to the NULL pointer. Returns -1 if
 // unpacking the string fails, returns 1 if *packed_string* is the null
 // string, and returns 0 otherwise. This function can be used to
-// simultaneously unpack a string and determine if it is a null string.
+// simultaneously unpack a string and determine if it is a null string. The
+// view stays valid until *packed_string* is freed or packed into, even if
+// other strings are allocated with *allocator* in the meantime.
 int
 NpyString_load(npy_string_allocator *allocator,
                const npy_packed_static_string *packed_string,
@@ -125,4 +161,151 @@ NpyString_load(npy_string_allocator *allocator,
 size_t
 NpyString_size(const npy_packed_static_string *packed_string);
 
+// Returns the number of bytes of arena memory used by a newly allocated
+// string of *size* bytes, or zero if the string is small enough to be stored
+// directly in the packed string.
+size_t
+NpyString_arena_storage_size(size_t size);
+
+// Makes room in the allocator's arena so that strings using a total of
+// *size* bytes of arena memory, as reported by NpyString_arena_storage_size,
+// can be allocated without growing the arena again. Returns -1 if memory
+// allocation fails. Returns 0 on success.
+int
+NpyString_arena_reserve(npy_string_allocator *allocator, size_t size);
+
+// Returns the fraction of the bytes in the allocator's arena that
+// belong to freed strings and have not been reused.
+double
+NpyString_arena_dead_fraction(const npy_string_allocator *allocator);
+
+// Compacting an arena copies all live arena-allocated strings into a new,
+// densely packed arena and frees the old one. Since the allocator
+// does not know which packed strings refer to it, the caller drives the
+// compaction: call NpyString_compact_begin, then NpyString_compact_entry on
+// a copy of *every* packed string allocated by *allocator*, then
+// NpyString_compact_finish. Only once the compaction has finished may the
+// copies be written back in place of the original packed strings. If
+// moving any string fails, call NpyString_compact_abort instead, which
+// restores the old arena so that the original packed strings stay valid.
+// Heap-allocated strings are left alone. The allocator must not be used
+// for anything else until the compaction is finished or aborted.
+//
+// NpyString_compact_begin returns -1 if memory allocation fails, in which
+// case nothing has been modified and neither NpyString_compact_finish nor
+// NpyString_compact_abort must be called. Returns 0 on success.
+int
+NpyString_compact_begin(npy_string_allocator *allocator);
+
+// Moves the copy of a packed string in *packed_string* into the compacted
+// arena, updating its offset. Returns -1 if memory allocation fails or the
+// string can't be found in the old arena. Returns 0 on success.
+int
+NpyString_compact_entry(npy_string_allocator *allocator,
+                        npy_packed_static_string *packed_string);
+
+// Frees the old arena.
+void
+NpyString_compact_finish(npy_string_allocator *allocator);
+
+// Frees the compacted arena and goes back to using the old arena, undoing
+// the compaction.
+void
+NpyString_compact_abort(npy_string_allocator *allocator);
+
+// A thread-local allocation buffer is a region of an allocator's arena
+// reserved for the use of a single thread. Strings can be allocated from
+// the buffer without holding the allocator's lock, so threads writing to
+// different entries of the same array only need to synchronize when a
+// buffer runs out. Buffers are meant to be stack-allocated and to live for
+// the duration of a single loop. Initialize a buffer with
+// NpyString_tlab_init and return any unused space to the arena with
+// NpyString_tlab_release.
+typedef struct npy_string_tlab {
+    npy_string_allocator *allocator;
+    // the next unused byte in the buffer, or NULL if the buffer is empty
+    char *buf;
+    // arena offset of *buf*
+    size_t offset;
+    // number of unused bytes in the buffer
+    size_t remaining;
+    // number of bytes used by the size prefixes of strings allocated from
+    // the buffer that haven't been added to the allocator's count yet
+    size_t prefix;
+    // total number of bytes reserved by the buffer so far, which sets the
+    // size of the next reservation
+    size_t reserved;
+} npy_string_tlab;
+
+// Initializes an empty buffer for *allocator*. Does not allocate anything,
+// so the allocator lock is not needed.
+void
+NpyString_tlab_init(npy_string_tlab *tlab, npy_string_allocator *allocator);
+
+// Like NpyString_newemptysize, but allocates from the buffer and does not
+// need the allocator lock. Sets *buf* to the string buffer for *out*, which
+// the caller must initialize. Returns 1 without modifying *out* if the
+// buffer does not have room for the string or if *out* holds an allocation
+// that must be freed first. In that case the caller should acquire the
+// allocator lock, free *out*, and call NpyString_tlab_refill before trying
+// again. Returns -1 if the string would exceed the maximum allowed string
+// size. Returns 0 on success.
+int
+NpyString_tlab_newemptysize(npy_string_tlab *tlab, size_t size,
+                            npy_packed_static_string *out, char **buf);
+
+// Makes sure there is room in the buffer for a string of *size* bytes,
+// reserving a new region of the arena if necessary. The unused part of the
+// old region goes on the allocator's free lists. Each region is as big as
+// all of the earlier ones together, up to a limit, so loops that write
+// little don't reserve much. The allocator lock must be held. Returns -1 if
+// the arena cannot grow. Returns 0 on success.
+int
+NpyString_tlab_refill(npy_string_tlab *tlab, size_t size);
+
+// Adds the size prefixes of the strings allocated from the buffer so far to
+// the allocator's memory usage counts. The allocator lock must be held.
+// Must be called before freeing a string that may have been allocated from
+// the buffer, so the counts never go out of range. Strings allocated from
+// the buffer must not be freed by other threads until it is released.
+void
+NpyString_tlab_sync(npy_string_tlab *tlab);
+
+// Returns the unused part of the buffer to the arena. The allocator lock
+// must be held.
+void
+NpyString_tlab_release(npy_string_tlab *tlab);
+
+// Returns the number of buffers that currently reserve part of the
+// allocator's arena. The arena must not be compacted while this is nonzero.
+int
+NpyString_num_tlabs(const npy_string_allocator *allocator);
+
+// A snapshot of the memory used by an allocator for string data, in bytes.
+typedef struct npy_string_memory_usage {
+    // total size of the arena
+    size_t arena_capacity;
+    // arena space taken up by live strings, including space left over when
+    // a freed allocation is reused for a shorter string
+    size_t arena_live;
+    // arena space taken up by freed strings that has not been reused
+    size_t arena_dead;
+    // arena space taken up by the size prefixes of live strings
+    size_t arena_prefix;
+    // arena space that has not been handed out yet
+    size_t arena_unused;
+    // total size of strings allocated on the heap
+    size_t heap;
+    // size of the table used to find interned strings
+    size_t intern_table;
+} npy_string_memory_usage;
+
+// Fills in *usage* with the memory used by *allocator*. The counts are
+// maintained as strings are allocated and freed, so this does not need to
+// look at any strings. Space reserved by thread-local allocation buffers
+// counts as live until the buffers are released.
+void
+NpyString_memory_usage(const npy_string_allocator *allocator,
+                       npy_string_memory_usage *usage);
+
 #endif /*_NPY_STATIC_STRING_H */
@@ -3,7 +3,74 @@
 #include "umath.h"
 
 #include "dtype.h"
+#include "hash_utils.h"
 #include "static_string.h"
+#include "utf8_utils.h"
+
+// Allocates a string of *size* bytes for *out* from *tlab*, only acquiring
+// the allocator lock of *descr* if the buffer needs to be refilled or the
+// existing contents of *out* need to be freed. Returns the buffer the
+// caller must fill in with the string data, or NULL on failure.
+static char *
+tlab_newemptysize(StringDTypeObject *descr, npy_string_tlab *tlab,
+                  size_t size, npy_packed_static_string *out)
+{
+    char *buf = NULL;
+    int ret = NpyString_tlab_newemptysize(tlab, size, out, &buf);
+    if (ret == 0) {
+        return buf;
+    }
+    else if (ret < 0) {
+        return NULL;
+    }
+    npy_string_allocator *allocator = NpyString_acquire_allocator(descr);
+    // *out* may have been allocated from the buffer earlier in the loop
+    NpyString_tlab_sync(tlab);
+    if (NpyString_free(out, allocator) < 0) {
+        goto fail;
+    }
+    if (NpyString_tlab_refill(tlab, size) == 0) {
+        ret = NpyString_tlab_newemptysize(tlab, size, out, &buf);
+    }
+    if (ret != 0) {
+        // the arena can't grow any more
+        npy_static_string os = {0, NULL};
+        if (NpyString_newemptysize(size, out, allocator) < 0 ||
+            NpyString_load(allocator, out, &os) < 0) {
+            goto fail;
+        }
+        // explicitly discard const; initializing new buffer
+        buf = (char *)os.buf;
+    }
+    NpyString_release_allocator(descr);
+    return buf;
+
+fail:
+    NpyString_release_allocator(descr);
+    return NULL;
+}
+
+static int
+locked_pack_null(StringDTypeObject *descr, npy_string_tlab *tlab,
+                 npy_packed_static_string *out)
+{
+    npy_string_allocator *allocator = NpyString_acquire_allocator(descr);
+    NpyString_tlab_sync(tlab);
+    int ret = NpyString_pack_null(allocator, out);
+    NpyString_release_allocator(descr);
+    return ret;
+}
+
+// Returns the space left in *tlab* to the arena of *descr*
+static void
+release_tlab(StringDTypeObject *descr, npy_string_tlab *tlab)
+{
+    if (tlab->buf != NULL) {
+        NpyString_acquire_allocator(descr);
+        NpyString_tlab_release(tlab);
+        NpyString_release_allocator(descr);
+    }
+}
 
 static NPY_CASTING
 multiply_resolve_descriptors(
@@ -25,7 +92,7 @@ multiply_resolve_descriptors(
 
     if (given_descrs[2] == NULL) {
         out_descr = (PyArray_Descr *)new_stringdtype_instance(
-                odescr->na_object, odescr->coerce);
+                odescr->na_object, odescr->coerce, odescr->backend);
         if (out_descr == NULL) {
             return (NPY_CASTING)-1;
         }
@@ -54,8 +121,17 @@ multiply_resolve_descriptors(
     {                                                                         \
         npy_string_allocator *iallocator = NULL;                              \
         npy_string_allocator *oallocator = NULL;                              \
-        NpyString_acquire_allocator2(idescr, odescr, &iallocator,             \
-                                     &oallocator);                            \
+        /* see add_strided_loop */                                            \
+        int inplace = (idescr == odescr);                                     \
+        npy_string_tlab tlab;                                                 \
+        if (inplace) {                                                        \
+            NpyString_acquire_allocator2(idescr, odescr, &iallocator,         \
+                                         &oallocator);                        \
+        }                                                                     \
+        else {                                                                \
+            iallocator = NpyString_acquire_allocator_readonly(idescr);        \
+            NpyString_tlab_init(&tlab, odescr->allocator);                    \
+        }                                                                     \
         while (N--) {                                                         \
             const npy_packed_static_string *ips =                             \
                     (npy_packed_static_string *)sin;                          \
@@ -69,7 +145,10 @@ multiply_resolve_descriptors(
             }                                                                 \
             else if (is_isnull) {                                             \
                 if (has_nan_na) {                                             \
-                    if (NpyString_pack_null(oallocator, ops) < 0) {           \
+                    int pack_res =                                            \
+                            inplace ? NpyString_pack_null(oallocator, ops)    \
+                                    : locked_pack_null(odescr, &tlab, ops);   \
+                    if (pack_res < 0) {                                       \
                         gil_error(PyExc_MemoryError,                          \
                                   "Failed to deallocate string in multiply"); \
                         goto fail;                                            \
@@ -101,33 +180,16 @@ multiply_resolve_descriptors(
             }                                                                 \
                                                                               \
             char *buf = NULL;                                                 \
-            npy_static_string os = {0, NULL};                                 \
-            if (odescr == idescr) {                                           \
+            if (inplace) {                                                    \
                 buf = PyMem_RawMalloc(newsize);                               \
-                if (buf == NULL) {                                            \
-                    gil_error(PyExc_MemoryError,                              \
-                              "Failed to allocate string in multiply");       \
-                    goto fail;                                                \
-                }                                                             \
             }                                                                 \
             else {                                                            \
-                if (NpyString_free(ops, oallocator) < 0) {                    \
-                    gil_error(PyExc_MemoryError,                              \
-                              "Failed to deallocate string in multiply");     \
-                    goto fail;                                                \
-                }                                                             \
-                if (NpyString_newemptysize(newsize, ops, oallocator) < 0) {   \
-                    gil_error(PyExc_MemoryError,                              \
-                              "Failed to allocate string in multiply");       \
-                    goto fail;                                                \
-                }                                                             \
-                if (NpyString_load(oallocator, ops, &os) < 0) {               \
-                    gil_error(PyExc_MemoryError,                              \
-                              "Failed to load string in multiply");           \
-                    goto fail;                                                \
-                }                                                             \
-                /* excplicitly discard const; initializing new buffer */      \
-                buf = (char *)os.buf;                                         \
+                buf = tlab_newemptysize(odescr, &tlab, newsize, ops);         \
+            }                                                                 \
+            if (buf == NULL) {                                                \
+                gil_error(PyExc_MemoryError,                                  \
+                          "Failed to allocate string in multiply");           \
+                goto fail;                                                    \
             }                                                                 \
                                                                               \
             for (size_t i = 0; i < (size_t)factor; i++) {                     \
@@ -136,7 +198,7 @@ multiply_resolve_descriptors(
                 memcpy((char *)buf + i * cursize, is.buf, cursize);           \
             }                                                                 \
                                                                               \
-            if (idescr == odescr) {                                           \
+            if (inplace) {                                                    \
                 if (NpyString_pack(oallocator, ops, buf, newsize) < 0) {      \
                     gil_error(PyExc_MemoryError,                              \
                               "Failed to pack string in multiply");           \
@@ -150,11 +212,23 @@ multiply_resolve_descriptors(
             iin += i_stride;                                                  \
             out += o_stride;                                                  \
         }                                                                     \
-        NpyString_release_allocator2(idescr, odescr);                         \
+        if (inplace) {                                                        \
+            NpyString_release_allocator2(idescr, odescr);                     \
+        }                                                                     \
+        else {                                                                \
+            NpyString_release_allocator_readonly(idescr);                     \
+            release_tlab(odescr, &tlab);                                      \
+        }                                                                     \
         return 0;                                                             \
                                                                               \
     fail:                                                                     \
-        NpyString_release_allocator2(idescr, odescr);                         \
+        if (inplace) {                                                        \
+            NpyString_release_allocator2(idescr, odescr);                     \
+        }                                                                     \
+        else {                                                                \
+            NpyString_release_allocator_readonly(idescr);                     \
+            release_tlab(odescr, &tlab);                                      \
+        }                                                                     \
         return -1;                                                            \
     }                                                                         \
                                                                               \
@@ -272,7 +346,8 @@ binary_resolve_descriptors(struct PyArrayMethodObject_tag *NPY_UNUSED(method),
     if (given_descrs[2] == NULL) {
         out_descr = (PyArray_Descr *)new_stringdtype_instance(
                 ((StringDTypeObject *)given_descrs[1])->na_object,
-                ((StringDTypeObject *)given_descrs[1])->coerce);
+                ((StringDTypeObject *)given_descrs[1])->coerce,
+                ((StringDTypeObject *)given_descrs[1])->backend);
 
         if (out_descr == NULL) {
             return (NPY_CASTING)-1;
@@ -311,8 +386,22 @@ add_strided_loop(PyArrayMethod_Context *context, char *const data[],
     npy_string_allocator *s1allocator = NULL;
     npy_string_allocator *s2allocator = NULL;
     npy_string_allocator *oallocator = NULL;
-    NpyString_acquire_allocator3(s1descr, s2descr, odescr, &s1allocator,
-                                 &s2allocator, &oallocator);
+    // When the output doesn't share an allocator with the inputs, the
+    // inputs only need to be read and the output strings are allocated
+    // from a thread-local buffer, so threads adding into different parts of
+    // the same array don't hold the output allocator lock for the whole
+    // loop.
+    int inplace = (odescr == s1descr || odescr == s2descr);
+    npy_string_tlab tlab;
+    if (inplace) {
+        NpyString_acquire_allocator3(s1descr, s2descr, odescr, &s1allocator,
+                                     &s2allocator, &oallocator);
+    }
+    else {
+        NpyString_acquire_allocator_readonly2(s1descr, s2descr, &s1allocator,
+                                              &s2allocator);
+        NpyString_tlab_init(&tlab, odescr->allocator);
+    }
 
     while (N--) {
         const npy_packed_static_string *ps1 = (npy_packed_static_string *)in1;
@@ -328,7 +417,9 @@ add_strided_loop(PyArrayMethod_Context *context, char *const data[],
         npy_packed_static_string *ops = (npy_packed_static_string *)out;
         if (NPY_UNLIKELY(s1_isnull || s2_isnull)) {
             if (has_nan_na) {
-                if (NpyString_pack_null(oallocator, ops) < 0) {
+                int pack_res = inplace ? NpyString_pack_null(oallocator, ops)
+                                       : locked_pack_null(odescr, &tlab, ops);
+                if (pack_res < 0) {
                     gil_error(PyExc_MemoryError,
                               "Failed to deallocate string in add");
                     goto fail;
@@ -358,39 +449,21 @@ add_strided_loop(PyArrayMethod_Context *context, char *const data[],
         }
 
         char *buf = NULL;
-        npy_static_string os = {0, NULL};
-        if (odescr == s1descr || odescr == s2descr) {
+        if (inplace) {
             buf = PyMem_RawMalloc(newsize);
-
-            if (buf == NULL) {
-                gil_error(PyExc_MemoryError,
-                          "Failed to allocate string in add");
-                goto fail;
-            }
         }
         else {
-            if (NpyString_free(ops, oallocator) < 0) {
-                gil_error(PyExc_MemoryError,
-                          "Failed to deallocate string in add");
-                goto fail;
-            }
-            if (NpyString_newemptysize(newsize, ops, oallocator) < 0) {
-                gil_error(PyExc_MemoryError,
-                          "Failed to allocate string in add");
-                goto fail;
-            }
-            if (NpyString_load(oallocator, ops, &os) < 0) {
-                gil_error(PyExc_MemoryError, "Failed to load string in add");
-                goto fail;
-            }
-            // excplicitly discard const; initializing new buffer
-            buf = (char *)os.buf;
+            buf = tlab_newemptysize(odescr, &tlab, newsize, ops);
+        }
+        if (buf == NULL) {
+            gil_error(PyExc_MemoryError, "Failed to allocate string in add");
+            goto fail;
         }
 
         memcpy(buf, s1.buf, s1.size);
         memcpy(buf + s1.size, s2.buf, s2.size);
 
-        if (s1descr == odescr || s2descr == odescr) {
+        if (inplace) {
             if (NpyString_pack(oallocator, ops, buf, newsize) < 0) {
                 gil_error(PyExc_MemoryError,
                           "Failed to pack output string in add");
@@ -405,14 +478,185 @@ add_strided_loop(PyArrayMethod_Context *context, char *const data[],
         in2 += in2_stride;
         out += out_stride;
     }
+    if (inplace) {
+        NpyString_release_allocator3(s1descr, s2descr, odescr);
+    }
+    else {
+        NpyString_release_allocator_readonly2(s1descr, s2descr);
+        release_tlab(odescr, &tlab);
+    }
+    return 0;
+
+fail:
+    if (inplace) {
+        NpyString_release_allocator3(s1descr, s2descr, odescr);
+    }
+    else {
+        NpyString_release_allocator_readonly2(s1descr, s2descr);
+        release_tlab(odescr, &tlab);
+    }
+    return -1;
+}
+
+// Specialization of add_strided_loop for add.reduce, where the first input
+// and the output are the same accumulator. Rather than concatenating one
+// string at a time, which copies the accumulated string on every step,
+// sums up the size of the result first and builds it in a single buffer.
+static int
+add_reduce_loop(PyArrayMethod_Context *context, char *const data[],
+                npy_intp const dimensions[], npy_intp const strides[],
+                NpyAuxData *auxdata)
+{
+    if (data[0] != data[2] || strides[0] != 0 || strides[2] != 0) {
+        return add_strided_loop(context, data, dimensions, strides, auxdata);
+    }
+
+    StringDTypeObject *s1descr = (StringDTypeObject *)context->descriptors[0];
+    StringDTypeObject *s2descr = (StringDTypeObject *)context->descriptors[1];
+    StringDTypeObject *odescr = (StringDTypeObject *)context->descriptors[2];
+    int has_null = s1descr->na_object != NULL;
+    int has_nan_na = s1descr->has_nan_na;
+    int has_string_na = s1descr->has_string_na;
+    const npy_static_string *default_string = &s1descr->default_string;
+    npy_intp N = dimensions[0];
+    npy_packed_static_string *acc = (npy_packed_static_string *)data[0];
+    char *in2 = data[1];
+    npy_intp in2_stride = strides[1];
+
+    npy_string_allocator *s1allocator = NULL;
+    npy_string_allocator *s2allocator = NULL;
+    npy_string_allocator *oallocator = NULL;
+    NpyString_acquire_allocator3(s1descr, s2descr, odescr, &s1allocator,
+                                 &s2allocator, &oallocator);
+
+    char *buf = NULL;
+    npy_static_string s1 = {0, NULL};
+    int s1_isnull = NpyString_load(s1allocator, acc, &s1);
+    if (s1_isnull == -1) {
+        goto load_fail;
+    }
+
+    // first pass: the size of the result, or whether it is null
+    int result_isnull = 0;
+    size_t newsize = 0;
+    char *in = in2;
+    for (npy_intp i = -1; i < N; i++) {
+        npy_static_string s2 = s1;
+        int s2_isnull = s1_isnull;
+        if (i >= 0) {
+            s2_isnull = NpyString_load(s2allocator,
+                                       (npy_packed_static_string *)in, &s2);
+            in += in2_stride;
+        }
+        if (s2_isnull == -1) {
+            goto load_fail;
+        }
+        if (NPY_UNLIKELY(s2_isnull)) {
+            if (has_nan_na) {
+                result_isnull = 1;
+                break;
+            }
+            else if (has_string_na || !has_null) {
+                s2 = *default_string;
+            }
+            else {
+                gil_error(PyExc_TypeError,
+                          "Cannot add null that is not a nan-like value");
+                goto fail;
+            }
+        }
+        // check for overflow
+        if (newsize + s2.size < newsize) {
+            gil_error(PyExc_MemoryError, "Failed to allocate string in add");
+            goto fail;
+        }
+        newsize += s2.size;
+    }
+
+    if (result_isnull) {
+        if (NpyString_pack_null(oallocator, acc) < 0) {
+            gil_error(PyExc_MemoryError,
+                      "Failed to deallocate string in add");
+            goto fail;
+        }
+        NpyString_release_allocator3(s1descr, s2descr, odescr);
+        return 0;
+    }
+
+    // second pass: copy the strings into the result
+    buf = PyMem_RawMalloc(newsize > 0 ? newsize : 1);
+    if (buf == NULL) {
+        gil_error(PyExc_MemoryError, "Failed to allocate string in add");
+        goto fail;
+    }
+    if (s1_isnull) {
+        s1 = *default_string;
+    }
+    memcpy(buf, s1.buf, s1.size);
+    size_t pos = s1.size;
+    in = in2;
+    for (npy_intp i = 0; i < N; i++) {
+        npy_static_string s2 = {0, NULL};
+        if (NpyString_load(s2allocator, (npy_packed_static_string *)in,
+                           &s2) == 1) {
+            s2 = *default_string;
+        }
+        memcpy(buf + pos, s2.buf, s2.size);
+        pos += s2.size;
+        in += in2_stride;
+    }
+
+    if (NpyString_pack(oallocator, acc, buf, newsize) < 0) {
+        gil_error(PyExc_MemoryError, "Failed to pack output string in add");
+        goto fail;
+    }
+
+    PyMem_RawFree(buf);
     NpyString_release_allocator3(s1descr, s2descr, odescr);
     return 0;
 
+load_fail:
+    gil_error(PyExc_MemoryError, "Failed to load string in add");
 fail:
+    PyMem_RawFree(buf);
     NpyString_release_allocator3(s1descr, s2descr, odescr);
     return -1;
 }
 
+static int
+add_get_loop(PyArrayMethod_Context *NPY_UNUSED(context),
+             int NPY_UNUSED(aligned), int NPY_UNUSED(move_references),
+             const npy_intp *strides, PyArrayMethod_StridedLoop **out_loop,
+             NpyAuxData **out_transferdata, NPY_ARRAYMETHOD_FLAGS *flags)
+{
+    // Reductions accumulate into an operand with a stride of zero. NumPy
+    // only passes the strides of the accumulator and the input for
+    // reductions, so the output stride can't be checked here.
+    if (strides[0] == 0) {
+        *out_loop = &add_reduce_loop;
+    }
+    else {
+        *out_loop = &add_strided_loop;
+    }
+    *out_transferdata = NULL;
+    *flags = NPY_METH_NO_FLOATINGPOINT_ERRORS;
+    return 0;
+}
+
+// The empty string is the identity of add, but like for object arrays it
+// is only used for empty reductions.
+static int
+add_get_reduction_initial(PyArrayMethod_Context *context,
+                          npy_bool reduction_is_empty, char *initial)
+{
+    if (!reduction_is_empty) {
+        return 0;
+    }
+    // a zero-filled packed string is an empty string
+    memset(initial, 0, context->descriptors[0]->elsize);
+    return 1;
+}
+
 static int
 maximum_strided_loop(PyArrayMethod_Context *context, char *const data[],
                      npy_intp const dimensions[], npy_intp const strides[],
@@ -535,546 +779,1882 @@ fail:
     return -1;
 }
 
+// Specialization of maximum_strided_loop and minimum_strided_loop for
+// reductions, where the first input and the output are the same
+// accumulator. Only the position of the current extremum is tracked while
+// looping, so the winning string is copied into the accumulator once
+// instead of every time the extremum changes. *sign* is 1 for maximum and
+// -1 for minimum.
 static int
-string_equal_strided_loop(PyArrayMethod_Context *context, char *const data[],
-                          npy_intp const dimensions[],
-                          npy_intp const strides[],
-                          NpyAuxData *NPY_UNUSED(auxdata))
+minmax_reduce(PyArrayMethod_Context *context, char *const data[],
+              npy_intp const dimensions[], npy_intp const strides[],
+              int sign, const char *name)
 {
-    StringDTypeObject *descr1 = (StringDTypeObject *)context->descriptors[0];
-    StringDTypeObject *descr2 = (StringDTypeObject *)context->descriptors[1];
-    int has_null = descr1->na_object != NULL;
-    int has_nan_na = descr1->has_nan_na;
-    int has_string_na = descr1->has_string_na;
-    const npy_static_string *default_string = &descr1->default_string;
+    StringDTypeObject *in1_descr =
+            ((StringDTypeObject *)context->descriptors[0]);
+    StringDTypeObject *in2_descr =
+            ((StringDTypeObject *)context->descriptors[1]);
+    StringDTypeObject *out_descr =
+            ((StringDTypeObject *)context->descriptors[2]);
     npy_intp N = dimensions[0];
-    char *in1 = data[0];
+    char *acc = data[0];
     char *in2 = data[1];
-    npy_bool *out = (npy_bool *)data[2];
-    npy_intp in1_stride = strides[0];
     npy_intp in2_stride = strides[1];
-    npy_intp out_stride = strides[2];
 
-    npy_string_allocator *allocator1 = NULL;
-    npy_string_allocator *allocator2 = NULL;
-    NpyString_acquire_allocator2(descr1, descr2, &allocator1, &allocator2);
+    npy_string_allocator *in1_allocator = NULL;
+    npy_string_allocator *in2_allocator = NULL;
+    npy_string_allocator *out_allocator = NULL;
+    NpyString_acquire_allocator3(in1_descr, in2_descr, out_descr,
+                                 &in1_allocator, &in2_allocator,
+                                 &out_allocator);
 
+    char *best = acc;
+    StringDTypeObject *best_descr = in1_descr;
     while (N--) {
-        const npy_packed_static_string *ps1 = (npy_packed_static_string *)in1;
-        npy_static_string s1 = {0, NULL};
-        int s1_isnull = NpyString_load(allocator1, ps1, &s1);
-        const npy_packed_static_string *ps2 = (npy_packed_static_string *)in2;
-        npy_static_string s2 = {0, NULL};
-        int s2_isnull = NpyString_load(allocator2, ps2, &s2);
-        if (NPY_UNLIKELY(s1_isnull < 0 || s2_isnull < 0)) {
-            gil_error(PyExc_MemoryError, "Failed to load string in equal");
-            goto fail;
-        }
-        else if (NPY_UNLIKELY(s1_isnull || s2_isnull)) {
-            if (has_nan_na) {
-                // s1 or s2 is NA
-                *out = (npy_bool)0;
-                goto next_step;
-            }
-            else if (has_null && !has_string_na) {
-                if (s1_isnull && s2_isnull) {
-                    *out = (npy_bool)1;
-                }
-                else {
-                    *out = (npy_bool)0;
-                }
-            }
-            else {
-                if (s1_isnull) {
-                    s1 = *default_string;
-                }
-                if (s2_isnull) {
-                    s2 = *default_string;
-                }
-            }
+        if (sign * _compare(best, in2, best_descr, in2_descr) <= 0) {
+            best = in2;
+            best_descr = in2_descr;
         }
-        if (s1.size == s2.size &&
-            (s1.size == 0 || strncmp(s1.buf, s2.buf, s1.size) == 0)) {
-            *out = (npy_bool)1;
-        }
-        else {
-            *out = (npy_bool)0;
-        }
-
-    next_step:
-        in1 += in1_stride;
         in2 += in2_stride;
-        out += out_stride;
     }
 
-    NpyString_release_allocator2(descr1, descr2);
-
-    return 0;
-
-fail:
-    NpyString_release_allocator2(descr1, descr2);
+    int res = 0;
+    if (best != acc) {
+        res = free_and_copy(in2_allocator, out_allocator,
+                            (npy_packed_static_string *)best,
+                            (npy_packed_static_string *)acc, name);
+    }
 
-    return -1;
+    NpyString_release_allocator3(in1_descr, in2_descr, out_descr);
+    return res;
 }
 
 static int
-string_not_equal_strided_loop(PyArrayMethod_Context *context,
-                              char *const data[], npy_intp const dimensions[],
-                              npy_intp const strides[],
-                              NpyAuxData *NPY_UNUSED(auxdata))
+maximum_reduce_loop(PyArrayMethod_Context *context, char *const data[],
+                    npy_intp const dimensions[], npy_intp const strides[],
+                    NpyAuxData *auxdata)
 {
-    StringDTypeObject *descr1 = (StringDTypeObject *)context->descriptors[0];
-    StringDTypeObject *descr2 = (StringDTypeObject *)context->descriptors[1];
-    int has_null = descr1->na_object != NULL;
-    int has_nan_na = descr1->has_nan_na;
-    int has_string_na = descr1->has_string_na;
-    const npy_static_string *default_string = &descr1->default_string;
-    npy_intp N = dimensions[0];
-    char *in1 = data[0];
-    char *in2 = data[1];
-    npy_bool *out = (npy_bool *)data[2];
-    npy_intp in1_stride = strides[0];
-    npy_intp in2_stride = strides[1];
-    npy_intp out_stride = strides[2];
-
-    npy_string_allocator *allocator1 = NULL;
-    npy_string_allocator *allocator2 = NULL;
-    NpyString_acquire_allocator2(descr1, descr2, &allocator1, &allocator2);
-
-    while (N--) {
-        const npy_packed_static_string *ps1 = (npy_packed_static_string *)in1;
-        npy_static_string s1 = {0, NULL};
-        int s1_isnull = NpyString_load(allocator1, ps1, &s1);
-        const npy_packed_static_string *ps2 = (npy_packed_static_string *)in2;
-        npy_static_string s2 = {0, NULL};
-        int s2_isnull = NpyString_load(allocator2, ps2, &s2);
-        if (NPY_UNLIKELY(s1_isnull < 0 || s2_isnull < 0)) {
-            gil_error(PyExc_MemoryError, "Failed to load string in not equal");
-            goto fail;
-        }
-        else if (NPY_UNLIKELY(s1_isnull || s2_isnull)) {
-            if (has_nan_na) {
-                // s1 or s2 is NA
-                *out = (npy_bool)0;
-                goto next_step;
-            }
-            else if (has_null && !has_string_na) {
-                if (s1_isnull && s2_isnull) {
-                    *out = (npy_bool)0;
-                }
-                else {
-                    *out = (npy_bool)1;
-                }
-            }
-            else {
-                if (s1_isnull) {
-                    s1 = *default_string;
-                }
-                if (s2_isnull) {
-                    s2 = *default_string;
-                }
-            }
-        }
-
-        if (s1.size == s2.size && strncmp(s1.buf, s2.buf, s1.size) == 0) {
-            *out = (npy_bool)0;
-        }
-        else {
-            *out = (npy_bool)1;
-        }
-
-    next_step:
-        in1 += in1_stride;
-        in2 += in2_stride;
-        out += out_stride;
+    if (data[0] != data[2] || strides[0] != 0 || strides[2] != 0) {
+        return maximum_strided_loop(context, data, dimensions, strides,
+                                    auxdata);
     }
-
-    NpyString_release_allocator2(descr1, descr2);
-
-    return 0;
-
-fail:
-    NpyString_release_allocator2(descr1, descr2);
-
-    return -1;
+    return minmax_reduce(context, data, dimensions, strides, 1, "maximum");
 }
 
 static int
-string_greater_strided_loop(PyArrayMethod_Context *context, char *const data[],
-                            npy_intp const dimensions[],
-                            npy_intp const strides[],
-                            NpyAuxData *NPY_UNUSED(auxdata))
+minimum_reduce_loop(PyArrayMethod_Context *context, char *const data[],
+                    npy_intp const dimensions[], npy_intp const strides[],
+                    NpyAuxData *auxdata)
 {
-    StringDTypeObject *descr1 = (StringDTypeObject *)context->descriptors[0];
+    if (data[0] != data[2] || strides[0] != 0 || strides[2] != 0) {
+        return minimum_strided_loop(context, data, dimensions, strides,
+                                    auxdata);
+    }
+    return minmax_reduce(context, data, dimensions, strides, -1, "minimum");
+}
+
+#define MINMAX_GET_LOOP(name)                                                 \
+    static int name##_get_loop(                                               \
+            PyArrayMethod_Context *NPY_UNUSED(context),                       \
+            int NPY_UNUSED(aligned), int NPY_UNUSED(move_references),         \
+            const npy_intp *strides, PyArrayMethod_StridedLoop **out_loop,    \
+            NpyAuxData **out_transferdata, NPY_ARRAYMETHOD_FLAGS *flags)      \
+    {                                                                         \
+        /* see add_get_loop */                                            \
+        if (strides[0] == 0) {                                                \
+            *out_loop = &name##_reduce_loop;                                  \
+        }                                                                     \
+        else {                                                                \
+            *out_loop = &name##_strided_loop;                                 \
+        }                                                                     \
+        *out_transferdata = NULL;                                             \
+        *flags = NPY_METH_NO_FLOATINGPOINT_ERRORS;                            \
+        return 0;                                                             \
+    }
+
+MINMAX_GET_LOOP(maximum)
+MINMAX_GET_LOOP(minimum)
+
+// Returns 1 if neither input of a comparison can hold null strings.
+static int
+comparison_has_no_na(PyArrayMethod_Context *context)
+{
+    StringDTypeObject *descr1 = (StringDTypeObject *)context->descriptors[0];
+    StringDTypeObject *descr2 = (StringDTypeObject *)context->descriptors[1];
+    return descr1->na_object == NULL && descr2->na_object == NULL;
+}
+
+// Defines the loops for == or !=. *result_if_equal* is the output for
+// strings that compare equal. Non-null strings are compared with
+// NpyString_packed_eq, which checks the sizes before looking at any string
+// data. The get_loop function picks a loop that loads a broadcast operand
+// only once, or one that skips the null checks if there can't be any null
+// strings.
+#define STRING_EQUALITY_LOOP(name, opname, result_if_equal)                   \
+    static int string_##name##_strided_loop(                                  \
+            PyArrayMethod_Context *context, char *const data[],               \
+            npy_intp const dimensions[], npy_intp const strides[],            \
+            NpyAuxData *NPY_UNUSED(auxdata))                                  \
+    {                                                                         \
+        StringDTypeObject *descr1 =                                           \
+                (StringDTypeObject *)context->descriptors[0];                 \
+        StringDTypeObject *descr2 =                                           \
+                (StringDTypeObject *)context->descriptors[1];                 \
+        int has_null = descr1->na_object != NULL;                             \
+        int has_nan_na = descr1->has_nan_na;                                  \
+        int has_string_na = descr1->has_string_na;                            \
+        const npy_static_string *default_string = &descr1->default_string;    \
+        npy_intp N = dimensions[0];                                           \
+        char *in1 = data[0];                                                  \
+        char *in2 = data[1];                                                  \
+        npy_bool *out = (npy_bool *)data[2];                                  \
+        npy_intp in1_stride = strides[0];                                     \
+        npy_intp in2_stride = strides[1];                                     \
+        npy_intp out_stride = strides[2];                                     \
+                                                                              \
+        npy_string_allocator *allocator1 = NULL;                              \
+        npy_string_allocator *allocator2 = NULL;                              \
+        NpyString_acquire_allocator_readonly2(descr1, descr2, &allocator1,    \
+                                              &allocator2);                   \
+                                                                              \
+        while (N--) {                                                         \
+            const npy_packed_static_string *ps1 =                             \
+                    (npy_packed_static_string *)in1;                          \
+            const npy_packed_static_string *ps2 =                             \
+                    (npy_packed_static_string *)in2;                          \
+            int s1_isnull = NpyString_isnull(ps1);                            \
+            int s2_isnull = NpyString_isnull(ps2);                            \
+            int eq = 0;                                                       \
+            if (NPY_LIKELY(!s1_isnull && !s2_isnull)) {                       \
+                eq = NpyString_packed_eq(allocator1, ps1, allocator2, ps2);   \
+            }                                                                 \
+            else if (has_nan_na) {                                            \
+                /* s1 or s2 is NA */                                          \
+                *out = (npy_bool)0;                                           \
+                goto next_step;                                               \
+            }                                                                 \
+            else if (has_null && !has_string_na) {                            \
+                eq = s1_isnull && s2_isnull;                                  \
+            }                                                                 \
+            else {                                                            \
+                npy_static_string s1 = {0, NULL};                             \
+                npy_static_string s2 = {0, NULL};                             \
+                if (NpyString_load(allocator1, ps1, &s1) < 0 ||               \
+                    NpyString_load(allocator2, ps2, &s2) < 0) {               \
+                    eq = -1;                                                  \
+                }                                                             \
+                else {                                                        \
+                    if (s1_isnull) {                                          \
+                        s1 = *default_string;                                 \
+                    }                                                         \
+                    if (s2_isnull) {                                          \
+                        s2 = *default_string;                                 \
+                    }                                                         \
+                    eq = NpyString_eq(&s1, &s2);                              \
+                }                                                             \
+            }                                                                 \
+            if (NPY_UNLIKELY(eq < 0)) {                                       \
+                gil_error(PyExc_MemoryError,                                  \
+                          "Failed to load string in " opname);                \
+                goto fail;                                                    \
+            }                                                                 \
+            *out = (npy_bool)(eq ? result_if_equal : !result_if_equal);       \
+                                                                              \
+        next_step:                                                            \
+            in1 += in1_stride;                                                \
+            in2 += in2_stride;                                                \
+            out += out_stride;                                                \
+        }                                                                     \
+                                                                              \
+        NpyString_release_allocator_readonly2(descr1, descr2);                \
+                                                                              \
+        return 0;                                                             \
+                                                                              \
+    fail:                                                                     \
+        NpyString_release_allocator_readonly2(descr1, descr2);                \
+                                                                              \
+        return -1;                                                            \
+    }                                                                         \
+                                                                              \
+    static int string_##name##_no_na_loop(                                    \
+            PyArrayMethod_Context *context, char *const data[],               \
+            npy_intp const dimensions[], npy_intp const strides[],            \
+            NpyAuxData *NPY_UNUSED(auxdata))                                  \
+    {                                                                         \
+        StringDTypeObject *descr1 =                                           \
+                (StringDTypeObject *)context->descriptors[0];                 \
+        StringDTypeObject *descr2 =                                           \
+                (StringDTypeObject *)context->descriptors[1];                 \
+        npy_intp N = dimensions[0];                                           \
+        char *in1 = data[0];                                                  \
+        char *in2 = data[1];                                                  \
+        npy_bool *out = (npy_bool *)data[2];                                  \
+        npy_intp in1_stride = strides[0];                                     \
+        npy_intp in2_stride = strides[1];                                     \
+        npy_intp out_stride = strides[2];                                     \
+                                                                              \
+        npy_string_allocator *allocator1 = NULL;                              \
+        npy_string_allocator *allocator2 = NULL;                              \
+        NpyString_acquire_allocator_readonly2(descr1, descr2, &allocator1,    \
+                                              &allocator2);                   \
+                                                                              \
+        while (N--) {                                                         \
+            int eq = NpyString_packed_eq(allocator1,                          \
+                                         (npy_packed_static_string *)in1,     \
+                                         allocator2,                          \
+                                         (npy_packed_static_string *)in2);    \
+            if (NPY_UNLIKELY(eq < 0)) {                                       \
+                gil_error(PyExc_MemoryError,                                  \
+                          "Failed to load string in " opname);                \
+                NpyString_release_allocator_readonly2(descr1, descr2);        \
+                return -1;                                                    \
+            }                                                                 \
+            *out = (npy_bool)(eq ? result_if_equal : !result_if_equal);       \
+            in1 += in1_stride;                                                \
+            in2 += in2_stride;                                                \
+            out += out_stride;                                                \
+        }                                                                     \
+                                                                              \
+        NpyString_release_allocator_readonly2(descr1, descr2);                \
+                                                                              \
+        return 0;                                                             \
+    }                                                                         \
+                                                                              \
+    static int string_##name##_scalar_loop(                                   \
+            PyArrayMethod_Context *context, char *const data[],               \
+            npy_intp const dimensions[], npy_intp const strides[],            \
+            NpyAuxData *auxdata)                                              \
+    {                                                                         \
+        int scalar_index = strides[1] == 0 ? 1 : 0;                           \
+        if (strides[scalar_index] != 0) {                                     \
+            return string_##name##_strided_loop(context, data, dimensions,    \
+                                                strides, auxdata);            \
+        }                                                                     \
+        int array_index = 1 - scalar_index;                                   \
+        StringDTypeObject *descr1 =                                           \
+                (StringDTypeObject *)context->descriptors[0];                 \
+        StringDTypeObject *descr2 =                                           \
+                (StringDTypeObject *)context->descriptors[1];                 \
+        int has_null = descr1->na_object != NULL;                             \
+        int has_nan_na = descr1->has_nan_na;                                  \
+        int has_string_na = descr1->has_string_na;                            \
+        const npy_static_string *default_string = &descr1->default_string;    \
+        npy_intp N = dimensions[0];                                           \
+        char *in = data[array_index];                                         \
+        npy_bool *out = (npy_bool *)data[2];                                  \
+        npy_intp in_stride = strides[array_index];                            \
+        npy_intp out_stride = strides[2];                                     \
+                                                                              \
+        npy_string_allocator *allocators[2] = {NULL, NULL};                   \
+        NpyString_acquire_allocator_readonly2(descr1, descr2, &allocators[0], \
+                                              &allocators[1]);                \
+        npy_string_allocator *allocator = allocators[array_index];            \
+                                                                              \
+        npy_static_string scalar = {0, NULL};                                 \
+        int scalar_isnull = NpyString_load(                                   \
+                allocators[scalar_index],                                     \
+                (npy_packed_static_string *)data[scalar_index], &scalar);     \
+        if (NPY_UNLIKELY(scalar_isnull < 0)) {                                \
+            goto load_fail;                                                   \
+        }                                                                     \
+        /* like the strided loop, treat nulls as the default string */      \
+        if (scalar_isnull && (has_string_na || !has_null)) {                  \
+            scalar = *default_string;                                         \
+            scalar_isnull = 0;                                                \
+        }                                                                     \
+                                                                              \
+        while (N--) {                                                         \
+            const npy_packed_static_string *ps =                              \
+                    (npy_packed_static_string *)in;                           \
+            int isnull = NpyString_isnull(ps);                                \
+            int eq = 0;                                                       \
+            if (NPY_UNLIKELY(scalar_isnull || isnull)) {                      \
+                if (has_nan_na) {                                             \
+                    /* the scalar or the element is NA */                     \
+                    *out = (npy_bool)0;                                       \
+                    goto next_step;                                           \
+                }                                                             \
+                else if (has_null && !has_string_na) {                        \
+                    eq = scalar_isnull && isnull;                             \
+                }                                                             \
+                else {                                                        \
+                    /* only the element can still be null */                  \
+                    eq = NpyString_eq(default_string, &scalar);               \
+                }                                                             \
+            }                                                                 \
+            else if (NpyString_size(ps) != scalar.size) {                     \
+                eq = 0;                                                       \
+            }                                                                 \
+            else {                                                            \
+                npy_static_string s = {0, NULL};                              \
+                if (NpyString_load(allocator, ps, &s) < 0) {                  \
+                    goto load_fail;                                           \
+                }                                                             \
+                eq = NpyString_eq(&s, &scalar);                               \
+            }                                                                 \
+            *out = (npy_bool)(eq ? result_if_equal : !result_if_equal);       \
+                                                                              \
+        next_step:                                                            \
+            in += in_stride;                                                  \
+            out += out_stride;                                                \
+        }                                                                     \
+                                                                              \
+        NpyString_release_allocator_readonly2(descr1, descr2);                \
+                                                                              \
+        return 0;                                                             \
+                                                                              \
+    load_fail:                                                                \
+        gil_error(PyExc_MemoryError, "Failed to load string in " opname);     \
+        NpyString_release_allocator_readonly2(descr1, descr2);                \
+                                                                              \
+        return -1;                                                            \
+    }                                                                         \
+                                                                              \
+    static int string_##name##_get_loop(                                      \
+            PyArrayMethod_Context *context, int NPY_UNUSED(aligned),          \
+            int NPY_UNUSED(move_references), const npy_intp *strides,         \
+            PyArrayMethod_StridedLoop **out_loop,                             \
+            NpyAuxData **out_transferdata, NPY_ARRAYMETHOD_FLAGS *flags)      \
+    {                                                                         \
+        if (strides[0] == 0 || strides[1] == 0) {                             \
+            *out_loop = &string_##name##_scalar_loop;                         \
+        }                                                                     \
+        else if (comparison_has_no_na(context)) {                             \
+            *out_loop = &string_##name##_no_na_loop;                          \
+        }                                                                     \
+        else {                                                                \
+            *out_loop = &string_##name##_strided_loop;                        \
+        }                                                                     \
+        *out_transferdata = NULL;                                             \
+        *flags = NPY_METH_NO_FLOATINGPOINT_ERRORS;                            \
+        return 0;                                                             \
+    }
+
+STRING_EQUALITY_LOOP(equal, "equal", 1)
+STRING_EQUALITY_LOOP(not_equal, "not equal", 0)
+
+// Defines the loops for one of the ordering comparisons, *op* compares the
+// result of NpyString_cmp with zero. As for == and !=, a broadcast operand
+// is only loaded once.
+#define STRING_ORDERING_LOOP(name, opname, opsym, op)                         \
+    static int string_##name##_strided_loop(                                  \
+            PyArrayMethod_Context *context, char *const data[],               \
+            npy_intp const dimensions[], npy_intp const strides[],            \
+            NpyAuxData *NPY_UNUSED(auxdata))                                  \
+    {                                                                         \
+        StringDTypeObject *descr1 =                                           \
+                (StringDTypeObject *)context->descriptors[0];                 \
+        StringDTypeObject *descr2 =                                           \
+                (StringDTypeObject *)context->descriptors[1];                 \
+        int has_null = descr1->na_object != NULL;                             \
+        int has_nan_na = descr1->has_nan_na;                                  \
+        int has_string_na = descr1->has_string_na;                            \
+        const npy_static_string *default_string = &descr1->default_string;    \
+        npy_intp N = dimensions[0];                                           \
+        char *in1 = data[0];                                                  \
+        char *in2 = data[1];                                                  \
+        npy_bool *out = (npy_bool *)data[2];                                  \
+        npy_intp in1_stride = strides[0];                                     \
+        npy_intp in2_stride = strides[1];                                     \
+        npy_intp out_stride = strides[2];                                     \
+                                                                              \
+        npy_string_allocator *allocator1 = NULL;                              \
+        npy_string_allocator *allocator2 = NULL;                              \
+        NpyString_acquire_allocator_readonly2(descr1, descr2, &allocator1,    \
+                                              &allocator2);                   \
+                                                                              \
+        while (N--) {                                                         \
+            const npy_packed_static_string *ps1 =                             \
+                    (npy_packed_static_string *)in1;                          \
+            npy_static_string s1 = {0, NULL};                                 \
+            int s1_isnull = NpyString_load(allocator1, ps1, &s1);             \
+            const npy_packed_static_string *ps2 =                             \
+                    (npy_packed_static_string *)in2;                          \
+            npy_static_string s2 = {0, NULL};                                 \
+            int s2_isnull = NpyString_load(allocator2, ps2, &s2);             \
+            if (NPY_UNLIKELY(s1_isnull < 0 || s2_isnull < 0)) {               \
+                gil_error(PyExc_MemoryError,                                  \
+                          "Failed to load string in " opname);                \
+                goto fail;                                                    \
+            }                                                                 \
+            else if (NPY_UNLIKELY(s1_isnull || s2_isnull)) {                  \
+                if (has_nan_na) {                                             \
+                    /* s1 or s2 is NA */                                      \
+                    *out = (npy_bool)0;                                       \
+                    goto next_step;                                           \
+                }                                                             \
+                else if (has_null && !has_string_na) {                        \
+                    gil_error(PyExc_TypeError,                                \
+                              "'" opsym "' not supported for null values "    \
+                              "that are not nan-like.");                      \
+                    goto fail;                                                \
+                }                                                             \
+                else {                                                        \
+                    if (s1_isnull) {                                          \
+                        s1 = *default_string;                                 \
+                    }                                                         \
+                    if (s2_isnull) {                                          \
+                        s2 = *default_string;                                 \
+                    }                                                         \
+                }                                                             \
+            }                                                                 \
+            *out = (npy_bool)(NpyString_cmp(&s1, &s2) op 0);                  \
+                                                                              \
+        next_step:                                                            \
+            in1 += in1_stride;                                                \
+            in2 += in2_stride;                                                \
+            out += out_stride;                                                \
+        }                                                                     \
+                                                                              \
+        NpyString_release_allocator_readonly2(descr1, descr2);                \
+                                                                              \
+        return 0;                                                             \
+                                                                              \
+    fail:                                                                     \
+        NpyString_release_allocator_readonly2(descr1, descr2);                \
+                                                                              \
+        return -1;                                                            \
+    }                                                                         \
+                                                                              \
+    static int string_##name##_scalar_loop(                                   \
+            PyArrayMethod_Context *context, char *const data[],               \
+            npy_intp const dimensions[], npy_intp const strides[],            \
+            NpyAuxData *auxdata)                                              \
+    {                                                                         \
+        int scalar_index = strides[1] == 0 ? 1 : 0;                           \
+        if (strides[scalar_index] != 0) {                                     \
+            return string_##name##_strided_loop(context, data, dimensions,    \
+                                                strides, auxdata);            \
+        }                                                                     \
+        int array_index = 1 - scalar_index;                                   \
+        StringDTypeObject *descr1 =                                           \
+                (StringDTypeObject *)context->descriptors[0];                 \
+        StringDTypeObject *descr2 =                                           \
+                (StringDTypeObject *)context->descriptors[1];                 \
+        int has_null = descr1->na_object != NULL;                             \
+        int has_nan_na = descr1->has_nan_na;                                  \
+        int has_string_na = descr1->has_string_na;                            \
+        const npy_static_string *default_string = &descr1->default_string;    \
+        npy_intp N = dimensions[0];                                           \
+        char *in = data[array_index];                                         \
+        npy_bool *out = (npy_bool *)data[2];                                  \
+        npy_intp in_stride = strides[array_index];                            \
+        npy_intp out_stride = strides[2];                                     \
+                                                                              \
+        npy_string_allocator *allocators[2] = {NULL, NULL};                   \
+        NpyString_acquire_allocator_readonly2(descr1, descr2, &allocators[0], \
+                                              &allocators[1]);                \
+        npy_string_allocator *allocator = allocators[array_index];            \
+                                                                              \
+        npy_static_string scalar = {0, NULL};                                 \
+        int scalar_isnull = NpyString_load(                                   \
+                allocators[scalar_index],                                     \
+                (npy_packed_static_string *)data[scalar_index], &scalar);     \
+        if (NPY_UNLIKELY(scalar_isnull < 0)) {                                \
+            goto load_fail;                                                   \
+        }                                                                     \
+        /* like the strided loop, treat nulls as the default string */      \
+        if (scalar_isnull && (has_string_na || !has_null)) {                  \
+            scalar = *default_string;                                         \
+            scalar_isnull = 0;                                                \
+        }                                                                     \
+                                                                              \
+        while (N--) {                                                         \
+            npy_static_string s = {0, NULL};                                  \
+            int isnull = NpyString_load(allocator,                            \
+                                        (npy_packed_static_string *)in, &s);  \
+            if (NPY_UNLIKELY(isnull < 0)) {                                   \
+                goto load_fail;                                               \
+            }                                                                 \
+            else if (NPY_UNLIKELY(scalar_isnull || isnull)) {                 \
+                if (has_nan_na) {                                             \
+                    /* the scalar or the element is NA */                     \
+                    *out = (npy_bool)0;                                       \
+                    goto next_step;                                           \
+                }                                                             \
+                else if (has_null && !has_string_na) {                        \
+                    gil_error(PyExc_TypeError,                                \
+                              "'" opsym "' not supported for null values "    \
+                              "that are not nan-like.");                      \
+                    goto fail;                                                \
+                }                                                             \
+                else if (isnull) {                                            \
+                    s = *default_string;                                      \
+                }                                                             \
+            }                                                                 \
+            if (scalar_index == 1) {                                          \
+                *out = (npy_bool)(NpyString_cmp(&s, &scalar) op 0);           \
+            }                                                                 \
+            else {                                                            \
+                *out = (npy_bool)(NpyString_cmp(&scalar, &s) op 0);           \
+            }                                                                 \
+                                                                              \
+        next_step:                                                            \
+            in += in_stride;                                                  \
+            out += out_stride;                                                \
+        }                                                                     \
+                                                                              \
+        NpyString_release_allocator_readonly2(descr1, descr2);                \
+                                                                              \
+        return 0;                                                             \
+                                                                              \
+    load_fail:                                                                \
+        gil_error(PyExc_MemoryError, "Failed to load string in " opname);     \
+    fail:                                                                     \
+        NpyString_release_allocator_readonly2(descr1, descr2);                \
+                                                                              \
+        return -1;                                                            \
+    }                                                                         \
+                                                                              \
+    static int string_##name##_get_loop(                                      \
+            PyArrayMethod_Context *NPY_UNUSED(context),                       \
+            int NPY_UNUSED(aligned), int NPY_UNUSED(move_references),         \
+            const npy_intp *strides, PyArrayMethod_StridedLoop **out_loop,    \
+            NpyAuxData **out_transferdata, NPY_ARRAYMETHOD_FLAGS *flags)      \
+    {                                                                         \
+        if (strides[0] == 0 || strides[1] == 0) {                             \
+            *out_loop = &string_##name##_scalar_loop;                         \
+        }                                                                     \
+        else {                                                                \
+            *out_loop = &string_##name##_strided_loop;                        \
+        }                                                                     \
+        *out_transferdata = NULL;                                             \
+        *flags = NPY_METH_NO_FLOATINGPOINT_ERRORS;                            \
+        return 0;                                                             \
+    }
+
+STRING_ORDERING_LOOP(greater, "greater", ">", >)
+STRING_ORDERING_LOOP(greater_equal, "greater equal", ">=", >=)
+STRING_ORDERING_LOOP(less, "less", "<", <)
+STRING_ORDERING_LOOP(less_equal, "less equal", "<=", <=)
+
+static NPY_CASTING
+string_comparison_resolve_descriptors(
+        struct PyArrayMethodObject_tag *NPY_UNUSED(method),
+        PyArray_DTypeMeta *NPY_UNUSED(dtypes[]), PyArray_Descr *given_descrs[],
+        PyArray_Descr *loop_descrs[], npy_intp *NPY_UNUSED(view_offset))
+{
+    Py_INCREF(given_descrs[0]);
+    loop_descrs[0] = given_descrs[0];
+    Py_INCREF(given_descrs[1]);
+    loop_descrs[1] = given_descrs[1];
+
+    loop_descrs[2] = PyArray_DescrFromType(NPY_BOOL);  // cannot fail
+
+    return NPY_NO_CASTING;
+}
+
+static int
+string_isnan_strided_loop(PyArrayMethod_Context *context, char *const data[],
+                          npy_intp const dimensions[],
+                          npy_intp const strides[],
+                          NpyAuxData *NPY_UNUSED(auxdata))
+{
+    StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
+    int has_nan_na = descr->has_nan_na;
+
+    npy_intp N = dimensions[0];
+    char *in = data[0];
+    npy_bool *out = (npy_bool *)data[1];
+    npy_intp in_stride = strides[0];
+    npy_intp out_stride = strides[1];
+
+    while (N--) {
+        const npy_packed_static_string *s = (npy_packed_static_string *)in;
+        if (has_nan_na && NpyString_isnull(s)) {
+            *out = (npy_bool)1;
+        }
+        else {
+            *out = (npy_bool)0;
+        }
+
+        in += in_stride;
+        out += out_stride;
+    }
+
+    return 0;
+}
+
+// without a nan-like null, no string is nan
+static int
+string_isnan_no_nan_loop(PyArrayMethod_Context *NPY_UNUSED(context),
+                         char *const data[], npy_intp const dimensions[],
+                         npy_intp const strides[],
+                         NpyAuxData *NPY_UNUSED(auxdata))
+{
+    npy_intp N = dimensions[0];
+    char *out = data[1];
+    npy_intp out_stride = strides[1];
+
+    if (out_stride == sizeof(npy_bool)) {
+        memset(out, 0, N * sizeof(npy_bool));
+        return 0;
+    }
+
+    while (N--) {
+        *(npy_bool *)out = (npy_bool)0;
+        out += out_stride;
+    }
+
+    return 0;
+}
+
+static int
+string_isnan_get_loop(PyArrayMethod_Context *context, int NPY_UNUSED(aligned),
+                      int NPY_UNUSED(move_references),
+                      const npy_intp *NPY_UNUSED(strides),
+                      PyArrayMethod_StridedLoop **out_loop,
+                      NpyAuxData **out_transferdata,
+                      NPY_ARRAYMETHOD_FLAGS *flags)
+{
+    StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
+    if (descr->has_nan_na) {
+        *out_loop = &string_isnan_strided_loop;
+    }
+    else {
+        *out_loop = &string_isnan_no_nan_loop;
+    }
+    *out_transferdata = NULL;
+    *flags = NPY_METH_NO_FLOATINGPOINT_ERRORS;
+    return 0;
+}
+
+static NPY_CASTING
+string_isnan_resolve_descriptors(
+        struct PyArrayMethodObject_tag *NPY_UNUSED(method),
+        PyArray_DTypeMeta *NPY_UNUSED(dtypes[]), PyArray_Descr *given_descrs[],
+        PyArray_Descr *loop_descrs[], npy_intp *NPY_UNUSED(view_offset))
+{
+    Py_INCREF(given_descrs[0]);
+    loop_descrs[0] = given_descrs[0];
+    loop_descrs[1] = PyArray_DescrFromType(NPY_BOOL);  // cannot fail
+
+    return NPY_NO_CASTING;
+}
+
+// Null strings that are not replaced by the default string all have this
+// hash
+#define NULL_STRING_HASH 0
+
+static int
+string_hash_strided_loop(PyArrayMethod_Context *context, char *const data[],
+                         npy_intp const dimensions[], npy_intp const strides[],
+                         NpyAuxData *NPY_UNUSED(auxdata))
+{
+    StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
+    int has_null = descr->na_object != NULL;
+    int has_string_na = descr->has_string_na;
+    const npy_static_string *default_string = &descr->default_string;
+
+    npy_intp N = dimensions[0];
+    char *in = data[0];
+    char *out = data[1];
+    npy_intp in_stride = strides[0];
+    npy_intp out_stride = strides[1];
+
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
+
+    while (N--) {
+        const npy_packed_static_string *ps = (npy_packed_static_string *)in;
+        npy_static_string s = {0, NULL};
+        int is_null = NpyString_load(allocator, ps, &s);
+        if (is_null == -1) {
+            gil_error(PyExc_MemoryError, "Failed to load string in hash");
+            goto fail;
+        }
+        if (is_null && has_null && !has_string_na) {
+            *(npy_uint64 *)out = NULL_STRING_HASH;
+        }
+        else {
+            if (is_null) {
+                s = *default_string;
+            }
+            *(npy_uint64 *)out = xxh64(s.buf, s.size, 0);
+        }
+
+        in += in_stride;
+        out += out_stride;
+    }
+
+    NpyString_release_allocator_readonly(descr);
+    return 0;
+
+fail:
+    NpyString_release_allocator_readonly(descr);
+    return -1;
+}
+
+static NPY_CASTING
+string_hash_resolve_descriptors(
+        struct PyArrayMethodObject_tag *NPY_UNUSED(method),
+        PyArray_DTypeMeta *NPY_UNUSED(dtypes[]), PyArray_Descr *given_descrs[],
+        PyArray_Descr *loop_descrs[], npy_intp *NPY_UNUSED(view_offset))
+{
+    Py_INCREF(given_descrs[0]);
+    loop_descrs[0] = given_descrs[0];
+    loop_descrs[1] = PyArray_DescrFromType(NPY_UINT64);  // cannot fail
+
+    return NPY_NO_CASTING;
+}
+
+// Loops for the string functions. NumPy implements most of the np.strings
+// functions with ufuncs. The StringDType loops work directly on the UTF-8
+// bytes, with fast paths for ASCII strings, instead of converting every
+// element to a Python string.
+
+// Like gil_error, with *name* substituted into *format*
+static void
+gil_error_format(PyObject *type, const char *format, const char *name)
+{
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    if (!PyErr_Occurred()) {
+        PyErr_Format(type, format, name);
+    }
+    PyGILState_Release(gstate);
+}
+
+// Loads the string in *ps* into *s*. A null string is replaced by the
+// default string of *descr* if the null is a string or if *descr* has no
+// na_object. Returns 1 for the other null strings, 0 for strings, and -1 if
+// the string can't be loaded.
+static int
+load_string_or_default(npy_string_allocator *allocator,
+                       const npy_packed_static_string *ps,
+                       StringDTypeObject *descr, npy_static_string *s)
+{
+    int is_null = NpyString_load(allocator, ps, s);
+    if (is_null == 1 && (descr->has_string_na || descr->na_object == NULL)) {
+        *s = descr->default_string;
+        return 0;
+    }
+    return is_null;
+}
+
+// The output of a loop that creates strings. When the output shares its
+// descriptor with an input, the allocator is locked for the whole loop, so
+// each result is built in a temporary buffer and packed once it is
+// finished. Otherwise results are written straight into space taken from a
+// thread-local buffer.
+typedef struct {
+    StringDTypeObject *descr;
+    npy_string_allocator *allocator;
+    npy_string_tlab tlab;
+    int inplace;
+} string_output;
+
+static void
+string_output_init(string_output *output, StringDTypeObject *descr,
+                   int inplace)
+{
+    output->descr = descr;
+    output->allocator = descr->allocator;
+    output->inplace = inplace;
+    if (!inplace) {
+        NpyString_tlab_init(&output->tlab, descr->allocator);
+    }
+}
+
+// Returns a buffer for the *size* byte string that goes in *out*, or NULL
+// on failure. Once it is filled in, the buffer must be passed to
+// string_output_finish.
+static char *
+string_output_buffer(string_output *output, size_t size,
+                     npy_packed_static_string *out)
+{
+    if (output->inplace) {
+        return PyMem_RawMalloc(size);
+    }
+    return tlab_newemptysize(output->descr, &output->tlab, size, out);
+}
+
+static int
+string_output_finish(string_output *output, npy_packed_static_string *out,
+                     char *buf, size_t size)
+{
+    if (output->inplace) {
+        int ret = NpyString_pack(output->allocator, out, buf, size);
+        PyMem_RawFree(buf);
+        return ret;
+    }
+    return 0;
+}
+
+// *buf* may point into the string that is replaced
+static int
+string_output_copy(string_output *output, npy_packed_static_string *out,
+                   const char *buf, size_t size)
+{
+    char *obuf = string_output_buffer(output, size, out);
+    if (obuf == NULL) {
+        return -1;
+    }
+    if (size > 0) {
+        memcpy(obuf, buf, size);
+    }
+    return string_output_finish(output, out, obuf, size);
+}
+
+static int
+string_output_null(string_output *output, npy_packed_static_string *out)
+{
+    if (output->inplace) {
+        return NpyString_pack_null(output->allocator, out);
+    }
+    return locked_pack_null(output->descr, &output->tlab, out);
+}
+
+static void
+string_output_release(string_output *output)
+{
+    if (!output->inplace) {
+        release_tlab(output->descr, &output->tlab);
+    }
+}
+
+// Resolves the descriptors of a loop with *nin* inputs, which are used as
+// given, and an output with the builtin type *out_type*
+static NPY_CASTING
+fixed_output_resolve_descriptors(int nin, PyArray_Descr *given_descrs[],
+                                 PyArray_Descr *loop_descrs[], int out_type)
+{
+    for (int i = 0; i < nin; i++) {
+        Py_INCREF(given_descrs[i]);
+        loop_descrs[i] = given_descrs[i];
+    }
+    loop_descrs[nin] = PyArray_DescrFromType(out_type);  // cannot fail
+
+    return NPY_NO_CASTING;
+}
+
+// Resolves the descriptors of a loop with *nin* inputs and a StringDType
+// output, which handles nulls like the first input
+static NPY_CASTING
+string_output_resolve_descriptors(int nin, PyArray_Descr *given_descrs[],
+                                  PyArray_Descr *loop_descrs[])
+{
+    for (int i = 0; i < nin; i++) {
+        Py_INCREF(given_descrs[i]);
+        loop_descrs[i] = given_descrs[i];
+    }
+
+    if (given_descrs[nin] == NULL) {
+        StringDTypeObject *descr = (StringDTypeObject *)given_descrs[0];
+        loop_descrs[nin] = (PyArray_Descr *)new_stringdtype_instance(
+                descr->na_object, descr->coerce, descr->backend);
+        if (loop_descrs[nin] == NULL) {
+            return (NPY_CASTING)-1;
+        }
+    }
+    else {
+        Py_INCREF(given_descrs[nin]);
+        loop_descrs[nin] = given_descrs[nin];
+    }
+
+    return NPY_NO_CASTING;
+}
+
+#define RESOLVE_DESCRIPTORS(name, call)                                    \
+    static NPY_CASTING name##_resolve_descriptors(                         \
+            struct PyArrayMethodObject_tag *NPY_UNUSED(method),            \
+            PyArray_DTypeMeta *NPY_UNUSED(dtypes[]),                       \
+            PyArray_Descr *given_descrs[], PyArray_Descr *loop_descrs[],   \
+            npy_intp *NPY_UNUSED(view_offset))                             \
+    {                                                                      \
+        return call;                                                       \
+    }
+
+RESOLVE_DESCRIPTORS(str_len, fixed_output_resolve_descriptors(
+                                     1, given_descrs, loop_descrs, NPY_INT64))
+RESOLVE_DESCRIPTORS(string_is, fixed_output_resolve_descriptors(
+                                       1, given_descrs, loop_descrs, NPY_BOOL))
+RESOLVE_DESCRIPTORS(findlike, fixed_output_resolve_descriptors(
+                                      4, given_descrs, loop_descrs, NPY_INT64))
+RESOLVE_DESCRIPTORS(startswith_endswith,
+                    fixed_output_resolve_descriptors(4, given_descrs,
+                                                     loop_descrs, NPY_BOOL))
+RESOLVE_DESCRIPTORS(unary_string, string_output_resolve_descriptors(
+                                          1, given_descrs, loop_descrs))
+RESOLVE_DESCRIPTORS(strip_chars, string_output_resolve_descriptors(
+                                         2, given_descrs, loop_descrs))
+RESOLVE_DESCRIPTORS(replace, string_output_resolve_descriptors(
+                                     4, given_descrs, loop_descrs))
+
+static int
+string_str_len_strided_loop(PyArrayMethod_Context *context,
+                            char *const data[], npy_intp const dimensions[],
+                            npy_intp const strides[],
+                            NpyAuxData *NPY_UNUSED(auxdata))
+{
+    StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
+    npy_intp N = dimensions[0];
+    char *in = data[0];
+    char *out = data[1];
+    npy_intp in_stride = strides[0];
+    npy_intp out_stride = strides[1];
+
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
+
+    while (N--) {
+        npy_static_string s = {0, NULL};
+        int is_null = load_string_or_default(
+                allocator, (npy_packed_static_string *)in, descr, &s);
+        if (is_null == -1) {
+            gil_error(PyExc_MemoryError, "Failed to load string in str_len");
+            goto fail;
+        }
+        if (is_null) {
+            gil_error(PyExc_ValueError,
+                      "The length of a null string is undefined");
+            goto fail;
+        }
+        *(npy_int64 *)out = (npy_int64)utf8_num_codepoints(s.buf, s.size);
+
+        in += in_stride;
+        out += out_stride;
+    }
+
+    NpyString_release_allocator_readonly(descr);
+    return 0;
+
+fail:
+    NpyString_release_allocator_readonly(descr);
+    return -1;
+}
+
+typedef int(codepoint_predicate)(uint32_t codepoint);
+
+// The character classes of str.isalpha, str.isdigit and str.isspace. The
+// ASCII checks avoid the lookups in the Unicode database.
+static int
+codepoint_isalpha(uint32_t codepoint)
+{
+    return codepoint < 0x80 ? Py_ISALPHA(codepoint)
+                            : Py_UNICODE_ISALPHA(codepoint);
+}
+
+static int
+codepoint_isdigit(uint32_t codepoint)
+{
+    return codepoint < 0x80 ? Py_ISDIGIT(codepoint)
+                            : Py_UNICODE_ISDIGIT(codepoint);
+}
+
+static int
+codepoint_isspace(uint32_t codepoint)
+{
+    return Py_UNICODE_ISSPACE(codepoint);
+}
+
+// Returns 1 if *s* is not empty and *predicate* holds for all of its code
+// points, like the str.is* methods
+static int
+string_all(const npy_static_string *s, codepoint_predicate *predicate)
+{
+    if (s->size == 0) {
+        return 0;
+    }
+    const char *p = s->buf;
+    const char *end = s->buf + s->size;
+    while (p < end) {
+        uint32_t codepoint = (unsigned char)*p;
+        if (codepoint < 0x80) {
+            p++;
+        }
+        else {
+            p += utf8_decode(p, &codepoint);
+        }
+        if (!predicate(codepoint)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int
+string_is_loop(PyArrayMethod_Context *context, char *const data[],
+               npy_intp const dimensions[], npy_intp const strides[],
+               codepoint_predicate *predicate, const char *name)
+{
+    StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
+    int has_nan_na = descr->has_nan_na;
+    npy_intp N = dimensions[0];
+    char *in = data[0];
+    npy_bool *out = (npy_bool *)data[1];
+    npy_intp in_stride = strides[0];
+    npy_intp out_stride = strides[1];
+
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
+
+    while (N--) {
+        npy_static_string s = {0, NULL};
+        int is_null = load_string_or_default(
+                allocator, (npy_packed_static_string *)in, descr, &s);
+        if (is_null == -1) {
+            gil_error_format(PyExc_MemoryError,
+                             "Failed to load string in %s", name);
+            goto fail;
+        }
+        if (is_null) {
+            if (!has_nan_na) {
+                gil_error_format(PyExc_ValueError,
+                                 "Cannot use %s with a null that is not a "
+                                 "nan-like value",
+                                 name);
+                goto fail;
+            }
+            *out = (npy_bool)0;
+        }
+        else {
+            *out = (npy_bool)string_all(&s, predicate);
+        }
+
+        in += in_stride;
+        out += out_stride;
+    }
+
+    NpyString_release_allocator_readonly(descr);
+    return 0;
+
+fail:
+    NpyString_release_allocator_readonly(descr);
+    return -1;
+}
+
+#define STRING_IS_LOOP(name)                                                 \
+    static int string_##name##_strided_loop(                                 \
+            PyArrayMethod_Context *context, char *const data[],              \
+            npy_intp const dimensions[], npy_intp const strides[],           \
+            NpyAuxData *NPY_UNUSED(auxdata))                                 \
+    {                                                                        \
+        return string_is_loop(context, data, dimensions, strides,            \
+                              &codepoint_##name, #name);                     \
+    }
+
+STRING_IS_LOOP(isalpha)
+STRING_IS_LOOP(isdigit)
+STRING_IS_LOOP(isspace)
+
+// Returns the byte offset of the first occurrence of *needle* in
+// *haystack*, or -1 if there is none. Matches in valid UTF-8 always start
+// at a code point.
+static npy_intp
+string_search(const char *haystack, size_t haystack_size, const char *needle,
+              size_t needle_size)
+{
+    if (needle_size == 0) {
+        return 0;
+    }
+    if (needle_size > haystack_size) {
+        return -1;
+    }
+    const char *p = haystack;
+    const char *last = haystack + (haystack_size - needle_size);
+    while (p <= last) {
+        p = memchr(p, needle[0], last - p + 1);
+        if (p == NULL) {
+            return -1;
+        }
+        if (memcmp(p + 1, needle + 1, needle_size - 1) == 0) {
+            return p - haystack;
+        }
+        p++;
+    }
+    return -1;
+}
+
+// Like string_search, for the last occurrence of *needle*
+static npy_intp
+string_rsearch(const char *haystack, size_t haystack_size, const char *needle,
+               size_t needle_size)
+{
+    if (needle_size == 0) {
+        return (npy_intp)haystack_size;
+    }
+    if (needle_size > haystack_size) {
+        return -1;
+    }
+    const char *p = haystack + (haystack_size - needle_size);
+    while (1) {
+        if (*p == needle[0] &&
+            memcmp(p + 1, needle + 1, needle_size - 1) == 0) {
+            return p - haystack;
+        }
+        if (p == haystack) {
+            return -1;
+        }
+        p--;
+    }
+}
+
+// Sets *slice* to the code points of *s* between *start* and *end*, which
+// are clipped like the indices of a slice. Returns the code point index
+// where *slice* starts, or -1 if the indices don't select anything, and
+// sets *is_ascii* to whether *s* is ASCII, in which case byte offsets in
+// *slice* are also code point offsets.
+static npy_int64
+string_slice(const npy_static_string *s, npy_int64 start, npy_int64 end,
+             npy_static_string *slice, int *is_ascii)
+{
+    npy_int64 len = (npy_int64)utf8_num_codepoints(s->buf, s->size);
+    *is_ascii = (size_t)len == s->size;
+
+    if (end > len) {
+        end = len;
+    }
+    else if (end < 0) {
+        end += len;
+        if (end < 0) {
+            end = 0;
+        }
+    }
+    if (start < 0) {
+        start += len;
+        if (start < 0) {
+            start = 0;
+        }
+    }
+    if (end < start) {
+        return -1;
+    }
+
+    size_t byte_start = (size_t)start;
+    size_t byte_end = (size_t)end;
+    if (!*is_ascii) {
+        byte_start = utf8_codepoint_offset(s->buf, s->size, byte_start);
+        byte_end = byte_start + utf8_codepoint_offset(s->buf + byte_start,
+                                                      s->size - byte_start,
+                                                      (size_t)(end - start));
+    }
+    slice->buf = s->buf + byte_start;
+    slice->size = byte_end - byte_start;
+    return start;
+}
+
+typedef npy_int64(findlike_function)(const npy_static_string *s,
+                                     const npy_static_string *sub,
+                                     npy_int64 start, npy_int64 end);
+
+static npy_int64
+string_find(const npy_static_string *s, const npy_static_string *sub,
+            npy_int64 start, npy_int64 end)
+{
+    npy_static_string slice = {0, NULL};
+    int is_ascii = 0;
+    npy_int64 first = string_slice(s, start, end, &slice, &is_ascii);
+    if (first < 0) {
+        return -1;
+    }
+    npy_intp pos = string_search(slice.buf, slice.size, sub->buf, sub->size);
+    if (pos < 0) {
+        return -1;
+    }
+    if (!is_ascii) {
+        pos = (npy_intp)utf8_num_codepoints(slice.buf, pos);
+    }
+    return first + pos;
+}
+
+static npy_int64
+string_rfind(const npy_static_string *s, const npy_static_string *sub,
+             npy_int64 start, npy_int64 end)
+{
+    npy_static_string slice = {0, NULL};
+    int is_ascii = 0;
+    npy_int64 first = string_slice(s, start, end, &slice, &is_ascii);
+    if (first < 0) {
+        return -1;
+    }
+    npy_intp pos = string_rsearch(slice.buf, slice.size, sub->buf, sub->size);
+    if (pos < 0) {
+        return -1;
+    }
+    if (!is_ascii) {
+        pos = (npy_intp)utf8_num_codepoints(slice.buf, pos);
+    }
+    return first + pos;
+}
+
+// Counts non-overlapping occurrences, an empty *sub* matches between all
+// code points
+static npy_int64
+string_count(const npy_static_string *s, const npy_static_string *sub,
+             npy_int64 start, npy_int64 end)
+{
+    npy_static_string slice = {0, NULL};
+    int is_ascii = 0;
+    if (string_slice(s, start, end, &slice, &is_ascii) < 0) {
+        return 0;
+    }
+    if (sub->size == 0) {
+        if (is_ascii) {
+            return (npy_int64)slice.size + 1;
+        }
+        return (npy_int64)utf8_num_codepoints(slice.buf, slice.size) + 1;
+    }
+    npy_int64 count = 0;
+    const char *p = slice.buf;
+    size_t remaining = slice.size;
+    while (1) {
+        npy_intp pos = string_search(p, remaining, sub->buf, sub->size);
+        if (pos < 0) {
+            return count;
+        }
+        count++;
+        p += pos + sub->size;
+        remaining -= pos + sub->size;
+    }
+}
+
+static npy_int64
+string_startswith(const npy_static_string *s, const npy_static_string *sub,
+                  npy_int64 start, npy_int64 end)
+{
+    npy_static_string slice = {0, NULL};
+    int is_ascii = 0;
+    if (string_slice(s, start, end, &slice, &is_ascii) < 0 ||
+        slice.size < sub->size) {
+        return 0;
+    }
+    return sub->size == 0 || memcmp(slice.buf, sub->buf, sub->size) == 0;
+}
+
+static npy_int64
+string_endswith(const npy_static_string *s, const npy_static_string *sub,
+                npy_int64 start, npy_int64 end)
+{
+    npy_static_string slice = {0, NULL};
+    int is_ascii = 0;
+    if (string_slice(s, start, end, &slice, &is_ascii) < 0 ||
+        slice.size < sub->size) {
+        return 0;
+    }
+    return sub->size == 0 ||
+           memcmp(slice.buf + (slice.size - sub->size), sub->buf,
+                  sub->size) == 0;
+}
+
+// index and rindex are find and rfind that raise if there is no match
+static int
+string_findlike_loop(PyArrayMethod_Context *context, char *const data[],
+                     npy_intp const dimensions[], npy_intp const strides[],
+                     findlike_function *function, int out_is_bool,
+                     int raise_if_missing, const char *name)
+{
+    StringDTypeObject *descr1 = (StringDTypeObject *)context->descriptors[0];
     StringDTypeObject *descr2 = (StringDTypeObject *)context->descriptors[1];
-    int has_null = descr1->na_object != NULL;
-    int has_nan_na = descr1->has_nan_na;
-    int has_string_na = descr1->has_string_na;
-    const npy_static_string *default_string = &descr1->default_string;
     npy_intp N = dimensions[0];
     char *in1 = data[0];
     char *in2 = data[1];
-    npy_bool *out = (npy_bool *)data[2];
-    npy_intp in1_stride = strides[0];
-    npy_intp in2_stride = strides[1];
-    npy_intp out_stride = strides[2];
+    char *in3 = data[2];
+    char *in4 = data[3];
+    char *out = data[4];
 
     npy_string_allocator *allocator1 = NULL;
     npy_string_allocator *allocator2 = NULL;
-    NpyString_acquire_allocator2(descr1, descr2, &allocator1, &allocator2);
+    NpyString_acquire_allocator_readonly2(descr1, descr2, &allocator1,
+                                          &allocator2);
 
     while (N--) {
-        const npy_packed_static_string *ps1 = (npy_packed_static_string *)in1;
         npy_static_string s1 = {0, NULL};
-        int s1_isnull = NpyString_load(allocator1, ps1, &s1);
-        const npy_packed_static_string *ps2 = (npy_packed_static_string *)in2;
         npy_static_string s2 = {0, NULL};
-        int s2_isnull = NpyString_load(allocator2, ps2, &s2);
-        if (NPY_UNLIKELY(s1_isnull < 0 || s2_isnull < 0)) {
-            gil_error(PyExc_MemoryError, "Failed to load string in greater");
+        int s1_isnull = load_string_or_default(
+                allocator1, (npy_packed_static_string *)in1, descr1, &s1);
+        int s2_isnull = load_string_or_default(
+                allocator2, (npy_packed_static_string *)in2, descr2, &s2);
+        if (s1_isnull == -1 || s2_isnull == -1) {
+            gil_error_format(PyExc_MemoryError,
+                             "Failed to load string in %s", name);
             goto fail;
         }
-        else if (NPY_UNLIKELY(s1_isnull || s2_isnull)) {
-            if (has_nan_na) {
-                // s1 or s2 is NA
-                *out = (npy_bool)0;
-                goto next_step;
-            }
-            else if (has_null && !has_string_na) {
-                gil_error(PyExc_TypeError,
-                          "'>' not supported for null values that are not "
-                          "nan-like.");
-                goto fail;
-            }
-            else {
-                if (s1_isnull) {
-                    s1 = *default_string;
-                }
-                if (s2_isnull) {
-                    s2 = *default_string;
-                }
-            }
+        if (s1_isnull || s2_isnull) {
+            gil_error_format(PyExc_ValueError,
+                             "Cannot use %s with a null that is not a "
+                             "string",
+                             name);
+            goto fail;
         }
-        if (NpyString_cmp(&s1, &s2) > 0) {
-            *out = (npy_bool)1;
+        npy_int64 res = function(&s1, &s2, *(npy_int64 *)in3,
+                                 *(npy_int64 *)in4);
+        if (raise_if_missing && res < 0) {
+            gil_error(PyExc_ValueError, "substring not found");
+            goto fail;
+        }
+        if (out_is_bool) {
+            *(npy_bool *)out = (npy_bool)res;
         }
         else {
-            *out = (npy_bool)0;
+            *(npy_int64 *)out = res;
         }
 
-    next_step:
-        in1 += in1_stride;
-        in2 += in2_stride;
-        out += out_stride;
+        in1 += strides[0];
+        in2 += strides[1];
+        in3 += strides[2];
+        in4 += strides[3];
+        out += strides[4];
     }
 
-    NpyString_release_allocator2(descr1, descr2);
-
+    NpyString_release_allocator_readonly2(descr1, descr2);
     return 0;
 
 fail:
-    NpyString_release_allocator2(descr1, descr2);
-
+    NpyString_release_allocator_readonly2(descr1, descr2);
     return -1;
 }
 
+#define FINDLIKE_LOOP(name, function, out_is_bool, raise_if_missing)        \
+    static int string_##name##_strided_loop(                                 \
+            PyArrayMethod_Context *context, char *const data[],              \
+            npy_intp const dimensions[], npy_intp const strides[],           \
+            NpyAuxData *NPY_UNUSED(auxdata))                                 \
+    {                                                                        \
+        return string_findlike_loop(context, data, dimensions, strides,      \
+                                    &function, out_is_bool,                  \
+                                    raise_if_missing, #name);                \
+    }
+
+FINDLIKE_LOOP(find, string_find, 0, 0)
+FINDLIKE_LOOP(rfind, string_rfind, 0, 0)
+FINDLIKE_LOOP(index, string_find, 0, 1)
+FINDLIKE_LOOP(rindex, string_rfind, 0, 1)
+FINDLIKE_LOOP(count, string_count, 0, 0)
+FINDLIKE_LOOP(startswith, string_startswith, 1, 0)
+FINDLIKE_LOOP(endswith, string_endswith, 1, 0)
+
+typedef enum {
+    LEFTSTRIP,
+    RIGHTSTRIP,
+    BOTHSTRIP,
+} STRIPTYPE;
+
+// Returns 1 if the *size* byte code point *codepoint* at *buf* is stripped:
+// whitespace if *chars* is NULL, otherwise one of the code points of
+// *chars*.
 static int
-string_greater_equal_strided_loop(PyArrayMethod_Context *context,
-                                  char *const data[],
-                                  npy_intp const dimensions[],
-                                  npy_intp const strides[],
-                                  NpyAuxData *NPY_UNUSED(auxdata))
+is_stripped(const char *buf, size_t size, uint32_t codepoint,
+            const npy_static_string *chars)
 {
-    StringDTypeObject *descr1 = (StringDTypeObject *)context->descriptors[0];
-    StringDTypeObject *descr2 = (StringDTypeObject *)context->descriptors[1];
-    int has_null = descr1->na_object != NULL;
-    int has_nan_na = descr1->has_nan_na;
-    int has_string_na = descr1->has_string_na;
-    const npy_static_string *default_string = &descr1->default_string;
+    if (chars == NULL) {
+        return Py_UNICODE_ISSPACE(codepoint);
+    }
+    if (chars->size == 0) {
+        return 0;
+    }
+    if (size == 1) {
+        return memchr(chars->buf, buf[0], chars->size) != NULL;
+    }
+    return string_search(chars->buf, chars->size, buf, size) >= 0;
+}
+
+// Sets *out* to what is left of *s* after stripping code points from the
+// ends given by *striptype*
+static void
+strip_string(const npy_static_string *s, const npy_static_string *chars,
+             STRIPTYPE striptype, npy_static_string *out)
+{
+    const char *start = s->buf;
+    const char *end = s->buf + s->size;
+
+    if (striptype != RIGHTSTRIP) {
+        while (start < end) {
+            uint32_t codepoint = (unsigned char)*start;
+            size_t size = 1;
+            if (codepoint >= 0x80) {
+                size = utf8_decode(start, &codepoint);
+            }
+            if (!is_stripped(start, size, codepoint, chars)) {
+                break;
+            }
+            start += size;
+        }
+    }
+    if (striptype != LEFTSTRIP) {
+        while (end > start) {
+            uint32_t codepoint = (unsigned char)end[-1];
+            size_t size = 1;
+            if (codepoint >= 0x80) {
+                size = utf8_last_codepoint_size(start, end - start);
+                utf8_decode(end - size, &codepoint);
+            }
+            if (!is_stripped(end - size, size, codepoint, chars)) {
+                break;
+            }
+            end -= size;
+        }
+    }
+
+    out->buf = start;
+    out->size = end - start;
+}
+
+// Strips whitespace if *has_chars* is 0, otherwise the code points in the
+// second input
+static int
+string_strip_loop(PyArrayMethod_Context *context, char *const data[],
+                  npy_intp const dimensions[], npy_intp const strides[],
+                  STRIPTYPE striptype, int has_chars, const char *name)
+{
+    int nin = has_chars ? 2 : 1;
+    StringDTypeObject *idescr = (StringDTypeObject *)context->descriptors[0];
+    StringDTypeObject *cdescr =
+            (StringDTypeObject *)context->descriptors[nin - 1];
+    StringDTypeObject *odescr =
+            (StringDTypeObject *)context->descriptors[nin];
+    int has_nan_na = idescr->has_nan_na;
     npy_intp N = dimensions[0];
-    char *in1 = data[0];
-    char *in2 = data[1];
-    npy_bool *out = (npy_bool *)data[2];
-    npy_intp in1_stride = strides[0];
-    npy_intp in2_stride = strides[1];
-    npy_intp out_stride = strides[2];
+    char *in = data[0];
+    char *chars_in = data[nin - 1];
+    char *out = data[nin];
+    npy_intp in_stride = strides[0];
+    npy_intp chars_stride = strides[nin - 1];
+    npy_intp out_stride = strides[nin];
 
-    npy_string_allocator *allocator1 = NULL;
-    npy_string_allocator *allocator2 = NULL;
-    NpyString_acquire_allocator2(descr1, descr2, &allocator1, &allocator2);
+    npy_string_allocator *iallocator = NULL;
+    npy_string_allocator *callocator = NULL;
+    npy_string_allocator *oallocator = NULL;
+    int inplace = (odescr == idescr || odescr == cdescr);
+    if (inplace) {
+        NpyString_acquire_allocator3(idescr, cdescr, odescr, &iallocator,
+                                     &callocator, &oallocator);
+    }
+    else {
+        NpyString_acquire_allocator_readonly2(idescr, cdescr, &iallocator,
+                                              &callocator);
+    }
+    string_output output;
+    string_output_init(&output, odescr, inplace);
 
     while (N--) {
-        const npy_packed_static_string *ps1 = (npy_packed_static_string *)in1;
-        npy_static_string s1 = {0, NULL};
-        int s1_isnull = NpyString_load(allocator1, ps1, &s1);
-        const npy_packed_static_string *ps2 = (npy_packed_static_string *)in2;
-        npy_static_string s2 = {0, NULL};
-        int s2_isnull = NpyString_load(allocator2, ps2, &s2);
-        if (NPY_UNLIKELY(s1_isnull < 0 || s2_isnull < 0)) {
-            gil_error(PyExc_MemoryError,
-                      "Failed to load string in greater equal");
+        npy_static_string s = {0, NULL};
+        npy_static_string chars = {0, NULL};
+        int s_isnull = load_string_or_default(
+                iallocator, (npy_packed_static_string *)in, idescr, &s);
+        int chars_isnull = 0;
+        if (has_chars) {
+            chars_isnull = load_string_or_default(
+                    callocator, (npy_packed_static_string *)chars_in, cdescr,
+                    &chars);
+        }
+        if (s_isnull == -1 || chars_isnull == -1) {
+            gil_error_format(PyExc_MemoryError,
+                             "Failed to load string in %s", name);
             goto fail;
         }
-        else if (NPY_UNLIKELY(s1_isnull || s2_isnull)) {
-            if (has_nan_na) {
-                // s1 or s2 is NA
-                *out = (npy_bool)0;
-                goto next_step;
-            }
-            else if (has_null && !has_string_na) {
-                gil_error(PyExc_TypeError,
-                          "'>=' not supported for null values that are not "
-                          "nan-like.");
+        npy_packed_static_string *ops = (npy_packed_static_string *)out;
+        if (NPY_UNLIKELY(s_isnull || chars_isnull)) {
+            if (!has_nan_na) {
+                gil_error_format(PyExc_ValueError,
+                                 "Cannot use %s with a null that is not a "
+                                 "nan-like value",
+                                 name);
                 goto fail;
             }
-            else {
-                if (s1_isnull) {
-                    s1 = *default_string;
-                }
-                if (s2_isnull) {
-                    s2 = *default_string;
-                }
+            if (string_output_null(&output, ops) < 0) {
+                gil_error_format(PyExc_MemoryError,
+                                 "Failed to deallocate string in %s", name);
+                goto fail;
             }
         }
-        if (NpyString_cmp(&s1, &s2) >= 0) {
-            *out = (npy_bool)1;
-        }
         else {
-            *out = (npy_bool)0;
+            npy_static_string stripped = {0, NULL};
+            strip_string(&s, has_chars ? &chars : NULL, striptype,
+                         &stripped);
+            if (string_output_copy(&output, ops, stripped.buf,
+                                   stripped.size) < 0) {
+                gil_error_format(PyExc_MemoryError,
+                                 "Failed to allocate string in %s", name);
+                goto fail;
+            }
         }
 
-    next_step:
-        in1 += in1_stride;
-        in2 += in2_stride;
+        in += in_stride;
+        chars_in += chars_stride;
         out += out_stride;
     }
 
-    NpyString_release_allocator2(descr1, descr2);
-
+    string_output_release(&output);
+    if (inplace) {
+        NpyString_release_allocator3(idescr, cdescr, odescr);
+    }
+    else {
+        NpyString_release_allocator_readonly2(idescr, cdescr);
+    }
     return 0;
 
 fail:
-    NpyString_release_allocator2(descr1, descr2);
-
+    string_output_release(&output);
+    if (inplace) {
+        NpyString_release_allocator3(idescr, cdescr, odescr);
+    }
+    else {
+        NpyString_release_allocator_readonly2(idescr, cdescr);
+    }
     return -1;
 }
 
+#define STRIP_LOOP(name, striptype, has_chars)                               \
+    static int string_##name##_strided_loop(                                 \
+            PyArrayMethod_Context *context, char *const data[],              \
+            npy_intp const dimensions[], npy_intp const strides[],           \
+            NpyAuxData *NPY_UNUSED(auxdata))                                 \
+    {                                                                        \
+        return string_strip_loop(context, data, dimensions, strides,         \
+                                 striptype, has_chars, #name);               \
+    }
+
+STRIP_LOOP(lstrip_whitespace, LEFTSTRIP, 0)
+STRIP_LOOP(rstrip_whitespace, RIGHTSTRIP, 0)
+STRIP_LOOP(strip_whitespace, BOTHSTRIP, 0)
+STRIP_LOOP(lstrip_chars, LEFTSTRIP, 1)
+STRIP_LOOP(rstrip_chars, RIGHTSTRIP, 1)
+STRIP_LOOP(strip_chars, BOTHSTRIP, 1)
+
+// Writes the upper or lower case version of the string *s* to *ops*. ASCII
+// strings are converted a byte at a time, the rest go through str.upper
+// or str.lower to get the full Unicode case mappings, which can change the
+// number of code points. Python code must not run while the allocator is
+// locked, so the lock the loop holds on *idescr* is released around the
+// call to the str method, exclusively held if *inplace* and shared
+// otherwise.
 static int
-string_less_strided_loop(PyArrayMethod_Context *context, char *const data[],
-                         npy_intp const dimensions[], npy_intp const strides[],
-                         NpyAuxData *NPY_UNUSED(auxdata))
+change_case(string_output *output, npy_packed_static_string *ops,
+            const npy_static_string *s, int upper, StringDTypeObject *idescr,
+            int inplace)
 {
-    StringDTypeObject *descr1 = (StringDTypeObject *)context->descriptors[0];
-    StringDTypeObject *descr2 = (StringDTypeObject *)context->descriptors[1];
-    int has_null = descr1->na_object != NULL;
-    int has_nan_na = descr1->has_nan_na;
-    int has_string_na = descr1->has_string_na;
-    const npy_static_string *default_string = &descr1->default_string;
+    if (utf8_is_ascii(s->buf, s->size)) {
+        char *buf = string_output_buffer(output, s->size, ops);
+        if (buf == NULL) {
+            return -1;
+        }
+        const unsigned char *in = (const unsigned char *)s->buf;
+        unsigned char from = upper ? 'a' : 'A';
+        for (size_t i = 0; i < s->size; i++) {
+            unsigned char c = in[i];
+            // flips the case bit of the letters of the other case
+            buf[i] = (char)(c ^ (((unsigned char)(c - from) < 26) << 5));
+        }
+        return string_output_finish(output, ops, buf, s->size);
+    }
+
+    // other threads can replace the input once the lock is released
+    char *copy = PyMem_RawMalloc(s->size);
+    if (copy == NULL) {
+        return -1;
+    }
+    memcpy(copy, s->buf, s->size);
+    size_t size_in = s->size;
+    if (inplace) {
+        NpyString_release_allocator(idescr);
+    }
+    else {
+        NpyString_release_allocator_readonly(idescr);
+    }
+
+    PyObject *res = NULL;
+    PyObject *str = PyUnicode_DecodeUTF8(copy, size_in, NULL);
+    PyMem_RawFree(copy);
+    if (str != NULL) {
+        res = PyObject_CallMethod(str, upper ? "upper" : "lower", NULL);
+        Py_DECREF(str);
+    }
+
+    if (inplace) {
+        NpyString_acquire_allocator(idescr);
+    }
+    else {
+        NpyString_acquire_allocator_readonly(idescr);
+    }
+    if (res == NULL) {
+        return -1;
+    }
+    Py_ssize_t size = 0;
+    const char *buf = PyUnicode_AsUTF8AndSize(res, &size);
+    int ret = -1;
+    if (buf != NULL) {
+        ret = string_output_copy(output, ops, buf, (size_t)size);
+    }
+    Py_DECREF(res);
+    return ret;
+}
+
+// Needs the GIL for the strings that aren't ASCII
+static int
+string_case_loop(PyArrayMethod_Context *context, char *const data[],
+                 npy_intp const dimensions[], npy_intp const strides[],
+                 int upper, const char *name)
+{
+    StringDTypeObject *idescr = (StringDTypeObject *)context->descriptors[0];
+    StringDTypeObject *odescr = (StringDTypeObject *)context->descriptors[1];
+    int has_nan_na = idescr->has_nan_na;
     npy_intp N = dimensions[0];
-    char *in1 = data[0];
-    char *in2 = data[1];
-    npy_bool *out = (npy_bool *)data[2];
-    npy_intp in1_stride = strides[0];
-    npy_intp in2_stride = strides[1];
-    npy_intp out_stride = strides[2];
+    char *in = data[0];
+    char *out = data[1];
+    npy_intp in_stride = strides[0];
+    npy_intp out_stride = strides[1];
 
-    npy_string_allocator *allocator1 = NULL;
-    npy_string_allocator *allocator2 = NULL;
-    NpyString_acquire_allocator2(descr1, descr2, &allocator1, &allocator2);
+    npy_string_allocator *iallocator = NULL;
+    npy_string_allocator *oallocator = NULL;
+    int inplace = odescr == idescr;
+    if (inplace) {
+        NpyString_acquire_allocator2(idescr, odescr, &iallocator,
+                                     &oallocator);
+    }
+    else {
+        iallocator = NpyString_acquire_allocator_readonly(idescr);
+    }
+    string_output output;
+    string_output_init(&output, odescr, inplace);
 
     while (N--) {
-        const npy_packed_static_string *ps1 = (npy_packed_static_string *)in1;
-        npy_static_string s1 = {0, NULL};
-        int s1_isnull = NpyString_load(allocator1, ps1, &s1);
-        const npy_packed_static_string *ps2 = (npy_packed_static_string *)in2;
-        npy_static_string s2 = {0, NULL};
-        int s2_isnull = NpyString_load(allocator2, ps2, &s2);
-        if (NPY_UNLIKELY(s1_isnull < 0 || s2_isnull < 0)) {
-            gil_error(PyExc_MemoryError, "Failed to load string in less");
+        npy_static_string s = {0, NULL};
+        int is_null = load_string_or_default(
+                iallocator, (npy_packed_static_string *)in, idescr, &s);
+        if (is_null == -1) {
+            gil_error_format(PyExc_MemoryError,
+                             "Failed to load string in %s", name);
             goto fail;
         }
-        else if (NPY_UNLIKELY(s1_isnull || s2_isnull)) {
-            if (has_nan_na) {
-                // s1 or s2 is NA
-                *out = (npy_bool)0;
-                goto next_step;
-            }
-            else if (has_null && !has_string_na) {
-                gil_error(PyExc_TypeError,
-                          "'<' not supported for null values that are not "
-                          "nan-like.");
+        npy_packed_static_string *ops = (npy_packed_static_string *)out;
+        if (NPY_UNLIKELY(is_null)) {
+            if (!has_nan_na) {
+                gil_error_format(PyExc_ValueError,
+                                 "Cannot use %s with a null that is not a "
+                                 "nan-like value",
+                                 name);
                 goto fail;
             }
-            else {
-                if (s1_isnull) {
-                    s1 = *default_string;
-                }
-                if (s2_isnull) {
-                    s2 = *default_string;
-                }
+            if (string_output_null(&output, ops) < 0) {
+                gil_error_format(PyExc_MemoryError,
+                                 "Failed to deallocate string in %s", name);
+                goto fail;
             }
         }
-        if (NpyString_cmp(&s1, &s2) < 0) {
-            *out = (npy_bool)1;
-        }
-        else {
-            *out = (npy_bool)0;
+        else if (change_case(&output, ops, &s, upper, idescr, inplace) < 0) {
+            gil_error_format(PyExc_MemoryError,
+                             "Failed to allocate string in %s", name);
+            goto fail;
         }
 
-    next_step:
-        in1 += in1_stride;
-        in2 += in2_stride;
+        in += in_stride;
         out += out_stride;
     }
 
-    NpyString_release_allocator2(descr1, descr2);
+    string_output_release(&output);
+    if (inplace) {
+        NpyString_release_allocator(idescr);
+    }
+    else {
+        NpyString_release_allocator_readonly(idescr);
+    }
+    return 0;
+
+fail:
+    string_output_release(&output);
+    if (inplace) {
+        NpyString_release_allocator(idescr);
+    }
+    else {
+        NpyString_release_allocator_readonly(idescr);
+    }
+    return -1;
+}
+
+static int
+string_upper_strided_loop(PyArrayMethod_Context *context, char *const data[],
+                          npy_intp const dimensions[],
+                          npy_intp const strides[],
+                          NpyAuxData *NPY_UNUSED(auxdata))
+{
+    return string_case_loop(context, data, dimensions, strides, 1, "upper");
+}
+
+static int
+string_lower_strided_loop(PyArrayMethod_Context *context, char *const data[],
+                          npy_intp const dimensions[],
+                          npy_intp const strides[],
+                          NpyAuxData *NPY_UNUSED(auxdata))
+{
+    return string_case_loop(context, data, dimensions, strides, 0, "lower");
+}
+
+// Writes *s* with the first *count* occurrences of *old* replaced by *new*
+// to *ops*, or all of them if *count* is negative. Like str.replace, an
+// empty *old* matches between all code points.
+static int
+replace_string(string_output *output, npy_packed_static_string *ops,
+               const npy_static_string *s, const npy_static_string *old,
+               const npy_static_string *new, npy_int64 count)
+{
+    size_t max_count = count < 0 ? SIZE_MAX : (size_t)count;
+    size_t num_matches = 0;
+    if (old->size == 0) {
+        num_matches = utf8_num_codepoints(s->buf, s->size) + 1;
+    }
+    else {
+        const char *p = s->buf;
+        size_t remaining = s->size;
+        while (num_matches < max_count) {
+            npy_intp pos = string_search(p, remaining, old->buf, old->size);
+            if (pos < 0) {
+                break;
+            }
+            num_matches++;
+            p += pos + old->size;
+            remaining -= pos + old->size;
+        }
+    }
+    if (num_matches > max_count) {
+        num_matches = max_count;
+    }
+
+    if (num_matches == 0) {
+        return string_output_copy(output, ops, s->buf, s->size);
+    }
+
+    // the matches don't overlap, so this can't wrap around
+    size_t base_size = s->size - num_matches * old->size;
+    if (new->size > 0 && num_matches > (SIZE_MAX - base_size) / new->size) {
+        return -1;
+    }
+    size_t size = base_size + num_matches * new->size;
 
-    return 0;
+    char *buf = string_output_buffer(output, size, ops);
+    if (buf == NULL) {
+        return -1;
+    }
 
-fail:
-    NpyString_release_allocator2(descr1, descr2);
+    char *o = buf;
+    const char *p = s->buf;
+    const char *end = s->buf + s->size;
+    for (size_t i = 0; i < num_matches; i++) {
+        size_t skip = 0;
+        if (old->size == 0) {
+            // the code point after the insertion point, the last insertion
+            // is followed by the rest of the string
+            if (i > 0) {
+                skip = utf8_codepoint_offset(p, end - p, 1);
+            }
+        }
+        else {
+            skip = string_search(p, end - p, old->buf, old->size);
+        }
+        if (skip > 0) {
+            memcpy(o, p, skip);
+            o += skip;
+            p += skip;
+        }
+        if (new->size > 0) {
+            memcpy(o, new->buf, new->size);
+            o += new->size;
+        }
+        p += old->size;
+    }
+    if (end > p) {
+        memcpy(o, p, end - p);
+    }
 
-    return -1;
+    return string_output_finish(output, ops, buf, size);
 }
 
 static int
-string_less_equal_strided_loop(PyArrayMethod_Context *context,
-                               char *const data[], npy_intp const dimensions[],
-                               npy_intp const strides[],
-                               NpyAuxData *NPY_UNUSED(auxdata))
+string_replace_strided_loop(PyArrayMethod_Context *context,
+                            char *const data[], npy_intp const dimensions[],
+                            npy_intp const strides[],
+                            NpyAuxData *NPY_UNUSED(auxdata))
 {
     StringDTypeObject *descr1 = (StringDTypeObject *)context->descriptors[0];
     StringDTypeObject *descr2 = (StringDTypeObject *)context->descriptors[1];
-    int has_null = descr1->na_object != NULL;
+    StringDTypeObject *descr3 = (StringDTypeObject *)context->descriptors[2];
+    StringDTypeObject *odescr = (StringDTypeObject *)context->descriptors[4];
     int has_nan_na = descr1->has_nan_na;
-    int has_string_na = descr1->has_string_na;
-    const npy_static_string *default_string = &descr1->default_string;
     npy_intp N = dimensions[0];
     char *in1 = data[0];
     char *in2 = data[1];
-    npy_bool *out = (npy_bool *)data[2];
-    npy_intp in1_stride = strides[0];
-    npy_intp in2_stride = strides[1];
-    npy_intp out_stride = strides[2];
+    char *in3 = data[2];
+    char *in4 = data[3];
+    char *out = data[4];
 
     npy_string_allocator *allocator1 = NULL;
     npy_string_allocator *allocator2 = NULL;
-    NpyString_acquire_allocator2(descr1, descr2, &allocator1, &allocator2);
+    npy_string_allocator *allocator3 = NULL;
+    // the output descriptor is one of the input descriptors, so it is
+    // locked along with them
+    int inplace =
+            (odescr == descr1 || odescr == descr2 || odescr == descr3);
+    if (inplace) {
+        NpyString_acquire_allocator3(descr1, descr2, descr3, &allocator1,
+                                     &allocator2, &allocator3);
+    }
+    else {
+        NpyString_acquire_allocator_readonly3(descr1, descr2, descr3,
+                                              &allocator1, &allocator2,
+                                              &allocator3);
+    }
+    string_output output;
+    string_output_init(&output, odescr, inplace);
 
     while (N--) {
-        const npy_packed_static_string *ps1 = (npy_packed_static_string *)in1;
-        npy_static_string s1 = {0, NULL};
-        int s1_isnull = NpyString_load(allocator1, ps1, &s1);
-        const npy_packed_static_string *ps2 = (npy_packed_static_string *)in2;
-        npy_static_string s2 = {0, NULL};
-        int s2_isnull = NpyString_load(allocator2, ps2, &s2);
-        if (NPY_UNLIKELY(s1_isnull < 0 || s2_isnull < 0)) {
-            gil_error(PyExc_MemoryError,
-                      "Failed to load string in less equal");
+        npy_static_string s = {0, NULL};
+        npy_static_string old = {0, NULL};
+        npy_static_string new = {0, NULL};
+        int s_isnull = load_string_or_default(
+                allocator1, (npy_packed_static_string *)in1, descr1, &s);
+        int old_isnull = load_string_or_default(
+                allocator2, (npy_packed_static_string *)in2, descr2, &old);
+        int new_isnull = load_string_or_default(
+                allocator3, (npy_packed_static_string *)in3, descr3, &new);
+        if (s_isnull == -1 || old_isnull == -1 || new_isnull == -1) {
+            gil_error(PyExc_MemoryError, "Failed to load string in replace");
             goto fail;
         }
-        else if (NPY_UNLIKELY(s1_isnull || s2_isnull)) {
-            if (has_nan_na) {
-                // s1 or s2 is NA
-                *out = (npy_bool)0;
-                goto next_step;
-            }
-            else if (has_null && !has_string_na) {
-                gil_error(PyExc_TypeError,
-                          "'<=' not supported for null values that are not "
-                          "nan-like.");
+        npy_packed_static_string *ops = (npy_packed_static_string *)out;
+        if (NPY_UNLIKELY(s_isnull || old_isnull || new_isnull)) {
+            if (!has_nan_na) {
+                gil_error(PyExc_ValueError,
+                          "Cannot use replace with a null that is not a "
+                          "nan-like value");
                 goto fail;
             }
-            else {
-                if (s1_isnull) {
-                    s1 = *default_string;
-                }
-                if (s2_isnull) {
-                    s2 = *default_string;
-                }
+            if (string_output_null(&output, ops) < 0) {
+                gil_error(PyExc_MemoryError,
+                          "Failed to deallocate string in replace");
+                goto fail;
             }
         }
-        if (NpyString_cmp(&s1, &s2) <= 0) {
-            *out = (npy_bool)1;
-        }
-        else {
-            *out = (npy_bool)0;
+        else if (replace_string(&output, ops, &s, &old, &new,
+                                *(npy_int64 *)in4) < 0) {
+            gil_error(PyExc_MemoryError,
+                      "Failed to allocate string in replace");
+            goto fail;
         }
 
-    next_step:
-        in1 += in1_stride;
-        in2 += in2_stride;
-        out += out_stride;
+        in1 += strides[0];
+        in2 += strides[1];
+        in3 += strides[2];
+        in4 += strides[3];
+        out += strides[4];
     }
 
-    NpyString_release_allocator2(descr1, descr2);
-
+    string_output_release(&output);
+    if (inplace) {
+        NpyString_release_allocator3(descr1, descr2, descr3);
+    }
+    else {
+        NpyString_release_allocator_readonly3(descr1, descr2, descr3);
+    }
     return 0;
 
 fail:
-    NpyString_release_allocator2(descr1, descr2);
-
-    return -1;
-}
-
-static NPY_CASTING
-string_comparison_resolve_descriptors(
-        struct PyArrayMethodObject_tag *NPY_UNUSED(method),
-        PyArray_DTypeMeta *NPY_UNUSED(dtypes[]), PyArray_Descr *given_descrs[],
-        PyArray_Descr *loop_descrs[], npy_intp *NPY_UNUSED(view_offset))
-{
-    Py_INCREF(given_descrs[0]);
-    loop_descrs[0] = given_descrs[0];
-    Py_INCREF(given_descrs[1]);
-    loop_descrs[1] = given_descrs[1];
-
-    loop_descrs[2] = PyArray_DescrFromType(NPY_BOOL);  // cannot fail
-
-    return NPY_NO_CASTING;
-}
-
-static int
-string_isnan_strided_loop(PyArrayMethod_Context *context, char *const data[],
-                          npy_intp const dimensions[],
-                          npy_intp const strides[],
-                          NpyAuxData *NPY_UNUSED(auxdata))
-{
-    StringDTypeObject *descr = (StringDTypeObject *)context->descriptors[0];
-    int has_nan_na = descr->has_nan_na;
-
-    npy_intp N = dimensions[0];
-    char *in = data[0];
-    npy_bool *out = (npy_bool *)data[1];
-    npy_intp in_stride = strides[0];
-    npy_intp out_stride = strides[1];
-
-    while (N--) {
-        const npy_packed_static_string *s = (npy_packed_static_string *)in;
-        if (has_nan_na && NpyString_isnull(s)) {
-            *out = (npy_bool)1;
-        }
-        else {
-            *out = (npy_bool)0;
-        }
-
-        in += in_stride;
-        out += out_stride;
+    string_output_release(&output);
+    if (inplace) {
+        NpyString_release_allocator3(descr1, descr2, descr3);
     }
-
-    return 0;
-}
-
-static NPY_CASTING
-string_isnan_resolve_descriptors(
-        struct PyArrayMethodObject_tag *NPY_UNUSED(method),
-        PyArray_DTypeMeta *NPY_UNUSED(dtypes[]), PyArray_Descr *given_descrs[],
-        PyArray_Descr *loop_descrs[], npy_intp *NPY_UNUSED(view_offset))
-{
-    Py_INCREF(given_descrs[0]);
-    loop_descrs[0] = given_descrs[0];
-    loop_descrs[1] = PyArray_DescrFromType(NPY_BOOL);  // cannot fail
-
-    return NPY_NO_CASTING;
+    else {
+        NpyString_release_allocator_readonly3(descr1, descr2, descr3);
+    }
+    return -1;
 }
 
 /*
@@ -1155,13 +2735,62 @@ string_multiply_promoter(PyObject *ufunc_obj, PyArray_DTypeMeta *op_dtypes[],
     return 0;
 }
 
+// Promotes the first *num_strings* inputs to StringDType and the other
+// inputs, the indices or counts, to Int64
+static int
+string_int_promoter(PyUFuncObject *ufunc, PyArray_DTypeMeta *op_dtypes[],
+                    PyArray_DTypeMeta *signature[],
+                    PyArray_DTypeMeta *new_op_dtypes[], int num_strings)
+{
+    for (int i = 0; i < ufunc->nin; i++) {
+        PyArray_DTypeMeta *tmp = NULL;
+        if (signature[i]) {
+            tmp = signature[i];
+        }
+        else if (i < num_strings) {
+            tmp = (PyArray_DTypeMeta *)&StringDType;
+        }
+        else {
+            tmp = &PyArray_Int64DType;
+        }
+        Py_INCREF(tmp);
+        new_op_dtypes[i] = tmp;
+    }
+    /* don't touch output dtypes */
+    for (int i = ufunc->nin; i < ufunc->nargs; i++) {
+        Py_XINCREF(op_dtypes[i]);
+        new_op_dtypes[i] = op_dtypes[i];
+    }
+    return 0;
+}
+
+static int
+string_findlike_promoter(PyObject *ufunc, PyArray_DTypeMeta *op_dtypes[],
+                         PyArray_DTypeMeta *signature[],
+                         PyArray_DTypeMeta *new_op_dtypes[])
+{
+    return string_int_promoter((PyUFuncObject *)ufunc, op_dtypes, signature,
+                               new_op_dtypes, 2);
+}
+
+static int
+string_replace_promoter(PyObject *ufunc, PyArray_DTypeMeta *op_dtypes[],
+                        PyArray_DTypeMeta *signature[],
+                        PyArray_DTypeMeta *new_op_dtypes[])
+{
+    return string_int_promoter((PyUFuncObject *)ufunc, op_dtypes, signature,
+                               new_op_dtypes, 3);
+}
+
 // Register a ufunc.
 //
 // Pass NULL for resolve_func to use the default_resolve_descriptors.
 int
 init_ufunc(PyObject *numpy, const char *ufunc_name, PyArray_DTypeMeta **dtypes,
            resolve_descriptors_function *resolve_func,
-           PyArrayMethod_StridedLoop *loop_func, int nin, int nout,
+           PyArrayMethod_StridedLoop *loop_func,
+           get_loop_function *get_loop_func,
+           get_reduction_initial_function *initial_func, int nin, int nout,
            NPY_CASTING casting, NPY_ARRAYMETHOD_FLAGS flags)
 {
     PyObject *ufunc = PyObject_GetAttrString(numpy, ufunc_name);
@@ -1183,21 +2812,33 @@ init_ufunc(PyObject *numpy, const char *ufunc_name, PyArray_DTypeMeta **dtypes,
             .slots = NULL,
     };
 
-    PyType_Slot resolve_slots[] = {
-            {NPY_METH_resolve_descriptors, resolve_func},
-            {NPY_METH_strided_loop, loop_func},
-            {0, NULL}};
-
-    PyType_Slot strided_slots[] = {{NPY_METH_strided_loop, loop_func},
-                                   {0, NULL}};
-
-    if (resolve_func == NULL) {
-        spec.slots = strided_slots;
+    // the optional slots go at the end so the unused ones can be left out
+    PyType_Slot slots[] = {{NPY_METH_strided_loop, loop_func},
+                           {0, NULL},
+                           {0, NULL},
+                           {0, NULL},
+                           {0, NULL}};
+    int num_slots = 1;
+
+    if (resolve_func != NULL) {
+        slots[num_slots].slot = NPY_METH_resolve_descriptors;
+        slots[num_slots].pfunc = resolve_func;
+        num_slots++;
     }
-    else {
-        spec.slots = resolve_slots;
+    // get_loop picks specialized versions of the strided loop
+    if (get_loop_func != NULL) {
+        slots[num_slots].slot = _NPY_METH_get_loop;
+        slots[num_slots].pfunc = get_loop_func;
+        num_slots++;
+    }
+    if (initial_func != NULL) {
+        slots[num_slots].slot = NPY_METH_get_reduction_initial;
+        slots[num_slots].pfunc = initial_func;
+        num_slots++;
     }
 
+    spec.slots = slots;
+
     if (PyUFunc_AddLoopFromSpec(ufunc, &spec) < 0) {
         Py_DECREF(ufunc);
         return -1;
@@ -1207,10 +2848,12 @@ init_ufunc(PyObject *numpy, const char *ufunc_name, PyArray_DTypeMeta **dtypes,
     return 0;
 }
 
-int
-add_promoter(PyObject *numpy, const char *ufunc_name,
-             PyArray_DTypeMeta *ldtype, PyArray_DTypeMeta *rdtype,
-             PyArray_DTypeMeta *edtype, promoter_function *promoter_impl)
+// Like add_promoter, for a ufunc with *nargs* operands. NULL entries of
+// *dtypes* match any DType.
+static int
+add_promoter_dtypes(PyObject *numpy, const char *ufunc_name,
+                    PyArray_DTypeMeta **dtypes, int nargs,
+                    promoter_function *promoter_impl)
 {
     PyObject *ufunc = PyObject_GetAttrString((PyObject *)numpy, ufunc_name);
 
@@ -1218,13 +2861,19 @@ add_promoter(PyObject *numpy, const char *ufunc_name,
         return -1;
     }
 
-    PyObject *DType_tuple = PyTuple_Pack(3, ldtype, rdtype, edtype);
+    PyObject *DType_tuple = PyTuple_New(nargs);
 
     if (DType_tuple == NULL) {
         Py_DECREF(ufunc);
         return -1;
     }
 
+    for (int i = 0; i < nargs; i++) {
+        PyObject *item = dtypes[i] ? (PyObject *)dtypes[i] : Py_None;
+        Py_INCREF(item);
+        PyTuple_SET_ITEM(DType_tuple, i, item);
+    }
+
     PyObject *promoter_capsule = PyCapsule_New((void *)promoter_impl,
                                                "numpy._ufunc_promoter", NULL);
 
@@ -1248,6 +2897,16 @@ add_promoter(PyObject *numpy, const char *ufunc_name,
     return 0;
 }
 
+int
+add_promoter(PyObject *numpy, const char *ufunc_name,
+             PyArray_DTypeMeta *ldtype, PyArray_DTypeMeta *rdtype,
+             PyArray_DTypeMeta *edtype, promoter_function *promoter_impl)
+{
+    PyArray_DTypeMeta *dtypes[] = {ldtype, rdtype, edtype};
+
+    return add_promoter_dtypes(numpy, ufunc_name, dtypes, 3, promoter_impl);
+}
+
 #define INIT_MULTIPLY(typename, shortname)                                 \
     PyArray_DTypeMeta *multiply_right_##shortname##_types[] = {            \
             (PyArray_DTypeMeta *)&StringDType, &PyArray_##typename##DType, \
@@ -1255,8 +2914,9 @@ add_promoter(PyObject *numpy, const char *ufunc_name,
                                                                            \
     if (init_ufunc(numpy, "multiply", multiply_right_##shortname##_types,  \
                    &multiply_resolve_descriptors,                          \
-                   &multiply_right_##shortname##_strided_loop, 2, 1,       \
-                   NPY_NO_CASTING, 0) < 0) {                               \
+                   &multiply_right_##shortname##_strided_loop, NULL, NULL, \
+                   2, 1, NPY_NO_CASTING,                                   \
+                   NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {                \
         goto error;                                                        \
     }                                                                      \
                                                                            \
@@ -1266,11 +2926,163 @@ add_promoter(PyObject *numpy, const char *ufunc_name,
                                                                            \
     if (init_ufunc(numpy, "multiply", multiply_left_##shortname##_types,   \
                    &multiply_resolve_descriptors,                          \
-                   &multiply_left_##shortname##_strided_loop, 2, 1,        \
-                   NPY_NO_CASTING, 0) < 0) {                               \
+                   &multiply_left_##shortname##_strided_loop, NULL, NULL,  \
+                   2, 1, NPY_NO_CASTING,                                   \
+                   NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {                \
         goto error;                                                        \
     }
 
+// Adds loops to the ufuncs NumPy 2 uses to implement np.strings and
+// np.char. They live in numpy._core.umath and older versions of NumPy
+// don't have them, in which case np.char goes through object arrays.
+static int
+init_string_ufuncs(void)
+{
+    PyObject *umath = PyImport_ImportModule("numpy._core.umath");
+    if (umath == NULL) {
+        if (PyErr_ExceptionMatches(PyExc_ImportError)) {
+            PyErr_Clear();
+            return 0;
+        }
+        return -1;
+    }
+
+    PyArray_DTypeMeta *str_len_dtypes[] = {(PyArray_DTypeMeta *)&StringDType,
+                                           &PyArray_Int64DType};
+
+    if (PyObject_HasAttrString(umath, "str_len") &&
+        init_ufunc(umath, "str_len", str_len_dtypes,
+                   &str_len_resolve_descriptors, &string_str_len_strided_loop,
+                   NULL, NULL, 1, 1, NPY_NO_CASTING,
+                   NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
+        goto error;
+    }
+
+    static char *is_ufunc_names[3] = {"isalpha", "isdigit", "isspace"};
+
+    static PyArrayMethod_StridedLoop *is_loops[3] = {
+            &string_isalpha_strided_loop,
+            &string_isdigit_strided_loop,
+            &string_isspace_strided_loop,
+    };
+
+    PyArray_DTypeMeta *is_dtypes[] = {(PyArray_DTypeMeta *)&StringDType,
+                                      &PyArray_BoolDType};
+
+    for (int i = 0; i < 3; i++) {
+        if (PyObject_HasAttrString(umath, is_ufunc_names[i]) &&
+            init_ufunc(umath, is_ufunc_names[i], is_dtypes,
+                       &string_is_resolve_descriptors, is_loops[i], NULL,
+                       NULL, 1, 1, NPY_NO_CASTING,
+                       NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
+            goto error;
+        }
+    }
+
+    static char *findlike_ufunc_names[7] = {
+            "find",  "rfind",      "index",    "rindex",
+            "count", "startswith", "endswith",
+    };
+
+    static PyArrayMethod_StridedLoop *findlike_loops[7] = {
+            &string_find_strided_loop,       &string_rfind_strided_loop,
+            &string_index_strided_loop,      &string_rindex_strided_loop,
+            &string_count_strided_loop,      &string_startswith_strided_loop,
+            &string_endswith_strided_loop,
+    };
+
+    PyArray_DTypeMeta *findlike_dtypes[] = {
+            (PyArray_DTypeMeta *)&StringDType,
+            (PyArray_DTypeMeta *)&StringDType, &PyArray_Int64DType,
+            &PyArray_Int64DType, &PyArray_Int64DType};
+
+    PyArray_DTypeMeta *startswith_endswith_dtypes[] = {
+            (PyArray_DTypeMeta *)&StringDType,
+            (PyArray_DTypeMeta *)&StringDType, &PyArray_Int64DType,
+            &PyArray_Int64DType, &PyArray_BoolDType};
+
+    // the substring can be a unicode array, the indices python integers
+    PyArray_DTypeMeta *findlike_promoter_dtypes[2][5] = {
+            {(PyArray_DTypeMeta *)&StringDType, NULL, NULL, NULL, NULL},
+            {&PyArray_UnicodeDType, (PyArray_DTypeMeta *)&StringDType, NULL,
+             NULL, NULL},
+    };
+
+    for (int i = 0; i < 7; i++) {
+        if (!PyObject_HasAttrString(umath, findlike_ufunc_names[i])) {
+            continue;
+        }
+        int is_bool = i >= 5;
+        if (init_ufunc(umath, findlike_ufunc_names[i],
+                       is_bool ? startswith_endswith_dtypes : findlike_dtypes,
+                       is_bool ? &startswith_endswith_resolve_descriptors
+                               : &findlike_resolve_descriptors,
+                       findlike_loops[i], NULL, NULL, 4, 1, NPY_NO_CASTING,
+                       NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
+            goto error;
+        }
+        for (int j = 0; j < 2; j++) {
+            if (add_promoter_dtypes(umath, findlike_ufunc_names[i],
+                                    findlike_promoter_dtypes[j], 5,
+                                    &string_findlike_promoter) < 0) {
+                goto error;
+            }
+        }
+    }
+
+    static char *strip_ufunc_names[6] = {
+            "_lstrip_whitespace", "_rstrip_whitespace", "_strip_whitespace",
+            "_lstrip_chars",      "_rstrip_chars",      "_strip_chars",
+    };
+
+    static PyArrayMethod_StridedLoop *strip_loops[6] = {
+            &string_lstrip_whitespace_strided_loop,
+            &string_rstrip_whitespace_strided_loop,
+            &string_strip_whitespace_strided_loop,
+            &string_lstrip_chars_strided_loop,
+            &string_rstrip_chars_strided_loop,
+            &string_strip_chars_strided_loop,
+    };
+
+    PyArray_DTypeMeta *strip_dtypes[] = {(PyArray_DTypeMeta *)&StringDType,
+                                         (PyArray_DTypeMeta *)&StringDType,
+                                         (PyArray_DTypeMeta *)&StringDType};
+
+    PyArray_DTypeMeta *strip_promoter_dtypes[2][3] = {
+            {(PyArray_DTypeMeta *)&StringDType, &PyArray_UnicodeDType, NULL},
+            {&PyArray_UnicodeDType, (PyArray_DTypeMeta *)&StringDType, NULL},
+    };
+
+    for (int i = 0; i < 6; i++) {
+        if (!PyObject_HasAttrString(umath, strip_ufunc_names[i])) {
+            continue;
+        }
+        int has_chars = i >= 3;
+        if (init_ufunc(umath, strip_ufunc_names[i], strip_dtypes,
+                       has_chars ? &strip_chars_resolve_descriptors
+                                 : &unary_string_resolve_descriptors,
+                       strip_loops[i], NULL, NULL, 1 + has_chars, 1,
+                       NPY_NO_CASTING,
+                       NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
+            goto error;
+        }
+        for (int j = 0; has_chars && j < 2; j++) {
+            if (add_promoter_dtypes(umath, strip_ufunc_names[i],
+                                    strip_promoter_dtypes[j], 3,
+                                    &string_unicode_promoter) < 0) {
+                goto error;
+            }
+        }
+    }
+
+    Py_DECREF(umath);
+    return 0;
+
+error:
+    Py_DECREF(umath);
+    return -1;
+}
+
 int
 init_ufuncs(void)
 {
@@ -1289,6 +3101,12 @@ init_ufuncs(void)
             &string_less_strided_loop,    &string_less_equal_strided_loop,
     };
 
+    static get_loop_function *get_loops[6] = {
+            &string_equal_get_loop,   &string_not_equal_get_loop,
+            &string_greater_get_loop, &string_greater_equal_get_loop,
+            &string_less_get_loop,    &string_less_equal_get_loop,
+    };
+
     PyArray_DTypeMeta *comparison_dtypes[] = {
             (PyArray_DTypeMeta *)&StringDType,
             (PyArray_DTypeMeta *)&StringDType, &PyArray_BoolDType};
@@ -1296,7 +3114,8 @@ init_ufuncs(void)
     for (int i = 0; i < 6; i++) {
         if (init_ufunc(numpy, comparison_ufunc_names[i], comparison_dtypes,
                        &string_comparison_resolve_descriptors,
-                       strided_loops[i], 2, 1, NPY_NO_CASTING, 0) < 0) {
+                       strided_loops[i], get_loops[i], NULL, 2, 1,
+                       NPY_NO_CASTING, NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
             goto error;
         }
 
@@ -1334,7 +3153,9 @@ init_ufuncs(void)
 
     if (init_ufunc(numpy, "isnan", isnan_dtypes,
                    &string_isnan_resolve_descriptors,
-                   &string_isnan_strided_loop, 1, 1, NPY_NO_CASTING, 0) < 0) {
+                   &string_isnan_strided_loop, &string_isnan_get_loop, NULL,
+                   1, 1, NPY_NO_CASTING,
+                   NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
         goto error;
     }
 
@@ -1345,17 +3166,21 @@ init_ufuncs(void)
     };
 
     if (init_ufunc(numpy, "maximum", binary_dtypes, binary_resolve_descriptors,
-                   &maximum_strided_loop, 2, 1, NPY_NO_CASTING, 0) < 0) {
+                   &maximum_strided_loop, &maximum_get_loop, NULL, 2, 1,
+                   NPY_NO_CASTING, NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
         goto error;
     }
 
     if (init_ufunc(numpy, "minimum", binary_dtypes, binary_resolve_descriptors,
-                   &minimum_strided_loop, 2, 1, NPY_NO_CASTING, 0) < 0) {
+                   &minimum_strided_loop, &minimum_get_loop, NULL, 2, 1,
+                   NPY_NO_CASTING, NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
         goto error;
     }
 
     if (init_ufunc(numpy, "add", binary_dtypes, binary_resolve_descriptors,
-                   &add_strided_loop, 2, 1, NPY_NO_CASTING, 0) < 0) {
+                   &add_strided_loop, &add_get_loop,
+                   &add_get_reduction_initial, 2, 1, NPY_NO_CASTING,
+                   NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
         goto error;
     }
 
@@ -1398,6 +3223,10 @@ init_ufuncs(void)
         goto error;
     }
 
+    if (init_string_ufuncs() < 0) {
+        goto error;
+    }
+
     Py_DECREF(numpy);
     return 0;
 
@@ -1405,3 +3234,58 @@ error:
     Py_DECREF(numpy);
     return -1;
 }
+
+int
+init_module_ufuncs(PyObject *module)
+{
+    PyArray_DTypeMeta *hash_dtypes[] = {(PyArray_DTypeMeta *)&StringDType,
+                                        &PyArray_UInt64DType};
+
+    if (init_ufunc(module, "string_hash", hash_dtypes,
+                   &string_hash_resolve_descriptors, &string_hash_strided_loop,
+                   NULL, NULL, 1, 1, NPY_NO_CASTING,
+                   NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
+        return -1;
+    }
+
+    PyArray_DTypeMeta *case_dtypes[] = {(PyArray_DTypeMeta *)&StringDType,
+                                        (PyArray_DTypeMeta *)&StringDType};
+
+    // strings that aren't ASCII go through the str methods
+    if (init_ufunc(module, "upper", case_dtypes,
+                   &unary_string_resolve_descriptors,
+                   &string_upper_strided_loop, NULL, NULL, 1, 1,
+                   NPY_NO_CASTING,
+                   NPY_METH_NO_FLOATINGPOINT_ERRORS |
+                           NPY_METH_REQUIRES_PYAPI) < 0) {
+        return -1;
+    }
+
+    if (init_ufunc(module, "lower", case_dtypes,
+                   &unary_string_resolve_descriptors,
+                   &string_lower_strided_loop, NULL, NULL, 1, 1,
+                   NPY_NO_CASTING,
+                   NPY_METH_NO_FLOATINGPOINT_ERRORS |
+                           NPY_METH_REQUIRES_PYAPI) < 0) {
+        return -1;
+    }
+
+    PyArray_DTypeMeta *replace_dtypes[] = {
+            (PyArray_DTypeMeta *)&StringDType,
+            (PyArray_DTypeMeta *)&StringDType,
+            (PyArray_DTypeMeta *)&StringDType, &PyArray_Int64DType,
+            (PyArray_DTypeMeta *)&StringDType};
+
+    if (init_ufunc(module, "replace", replace_dtypes,
+                   &replace_resolve_descriptors, &string_replace_strided_loop,
+                   NULL, NULL, 4, 1, NPY_NO_CASTING,
+                   NPY_METH_NO_FLOATINGPOINT_ERRORS) < 0) {
+        return -1;
+    }
+
+    PyArray_DTypeMeta *replace_promoter_dtypes[] = {
+            (PyArray_DTypeMeta *)&StringDType, NULL, NULL, NULL, NULL};
+
+    return add_promoter_dtypes(module, "replace", replace_promoter_dtypes, 5,
+                               &string_replace_promoter);
+}
@@ -4,4 +4,9 @@
 int
 init_ufuncs(void);
 
+// Adds the StringDType loops to the ufuncs defined by *module*: hash, upper,
+// lower and replace
+int
+init_module_ufuncs(PyObject *module);
+
 #endif /*_NPY_UFUNC_H */
@@ -0,0 +1,454 @@
+#include <Python.h>
+
+#include "unique.h"
+
+#include "dtype.h"
+#include "hash_utils.h"
+#include "static_string.h"
+
+// A distinct string found in the input array
+typedef struct {
+    npy_static_string str;
+    npy_uint64 hash;
+    // 1 for the group of null strings that are not replaced by the default
+    // string, which sorts after all of the other groups
+    int is_null;
+    // flat index and packed string of the first occurrence
+    npy_intp first;
+    const char *first_ptr;
+    npy_intp count;
+    // position of the group before the groups are sorted
+    npy_intp id;
+} unique_group;
+
+// An open addressing hash table mapping strings to groups. Empty slots
+// hold -1.
+typedef struct {
+    unique_group *groups;
+    npy_intp num_groups;
+    npy_intp groups_capacity;
+    npy_intp *slots;
+    npy_intp num_slots;
+} unique_table;
+
+#define UNIQUE_TABLE_INITIAL_SLOTS 64
+
+static int
+table_init(unique_table *table)
+{
+    table->groups = PyMem_RawMalloc(UNIQUE_TABLE_INITIAL_SLOTS / 2 *
+                                    sizeof(unique_group));
+    table->num_groups = 0;
+    table->groups_capacity = UNIQUE_TABLE_INITIAL_SLOTS / 2;
+    table->slots =
+            PyMem_RawMalloc(UNIQUE_TABLE_INITIAL_SLOTS * sizeof(npy_intp));
+    table->num_slots = UNIQUE_TABLE_INITIAL_SLOTS;
+    if (table->groups == NULL || table->slots == NULL) {
+        return -1;
+    }
+    for (npy_intp i = 0; i < table->num_slots; i++) {
+        table->slots[i] = -1;
+    }
+    return 0;
+}
+
+static void
+table_free(unique_table *table)
+{
+    PyMem_RawFree(table->groups);
+    PyMem_RawFree(table->slots);
+}
+
+// Doubles the number of slots, keeping the table at most half full
+static int
+table_grow(unique_table *table)
+{
+    npy_intp num_slots = table->num_slots * 2;
+    npy_intp *slots = PyMem_RawMalloc(num_slots * sizeof(npy_intp));
+    unique_group *groups = PyMem_RawRealloc(
+            table->groups, num_slots / 2 * sizeof(unique_group));
+    if (slots == NULL || groups == NULL) {
+        PyMem_RawFree(slots);
+        if (groups != NULL) {
+            table->groups = groups;
+        }
+        return -1;
+    }
+    for (npy_intp i = 0; i < num_slots; i++) {
+        slots[i] = -1;
+    }
+    npy_uint64 mask = (npy_uint64)num_slots - 1;
+    for (npy_intp g = 0; g < table->num_groups; g++) {
+        npy_uint64 i = groups[g].hash & mask;
+        while (slots[i] != -1) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = g;
+    }
+    PyMem_RawFree(table->slots);
+    table->slots = slots;
+    table->num_slots = num_slots;
+    table->groups = groups;
+    table->groups_capacity = num_slots / 2;
+    return 0;
+}
+
+static npy_intp
+table_new_group(unique_table *table, const npy_static_string *s,
+                npy_uint64 hash, int is_null, npy_intp index, const char *ptr)
+{
+    if (table->num_groups == table->groups_capacity &&
+        table_grow(table) < 0) {
+        return -1;
+    }
+    npy_intp g = table->num_groups++;
+    unique_group *group = &table->groups[g];
+    group->str = *s;
+    group->hash = hash;
+    group->is_null = is_null;
+    group->first = index;
+    group->first_ptr = ptr;
+    group->count = 0;
+    group->id = g;
+    return g;
+}
+
+// Returns the group holding the string *s*, adding a new group for it if it
+// has not been seen before. Returns -1 if memory allocation fails.
+static npy_intp
+table_find_or_add(unique_table *table, const npy_static_string *s,
+                  npy_uint64 hash, npy_intp index, const char *ptr)
+{
+    npy_uint64 mask = (npy_uint64)table->num_slots - 1;
+    npy_uint64 i = hash & mask;
+    while (table->slots[i] != -1) {
+        unique_group *group = &table->groups[table->slots[i]];
+        if (group->hash == hash && !group->is_null &&
+            NpyString_eq(&group->str, s)) {
+            return table->slots[i];
+        }
+        i = (i + 1) & mask;
+    }
+    // the table never fills up, since it grows when it is half full
+    npy_intp num_slots = table->num_slots;
+    npy_intp g = table_new_group(table, s, hash, 0, index, ptr);
+    if (g < 0) {
+        return -1;
+    }
+    if (table->num_slots != num_slots) {
+        // the slots were rehashed, so find a new empty slot
+        mask = (npy_uint64)table->num_slots - 1;
+        i = hash & mask;
+        while (table->slots[i] != -1) {
+            i = (i + 1) & mask;
+        }
+    }
+    table->slots[i] = g;
+    return g;
+}
+
+static int
+group_cmp(const void *a, const void *b)
+{
+    const unique_group *ga = (const unique_group *)a;
+    const unique_group *gb = (const unique_group *)b;
+    if (ga->is_null || gb->is_null) {
+        return ga->is_null - gb->is_null;
+    }
+    return NpyString_cmp(&ga->str, &gb->str);
+}
+
+PyObject *
+unique(PyObject *NPY_UNUSED(self), PyObject *args, PyObject *kwds)
+{
+    static char *kwargs_strs[] = {"arr", "return_index", "return_inverse",
+                                  "return_counts", NULL};
+    PyObject *obj = NULL;
+    int return_index = 0;
+    int return_inverse = 0;
+    int return_counts = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|ppp:unique", kwargs_strs,
+                                     &obj, &return_index, &return_inverse,
+                                     &return_counts)) {
+        return NULL;
+    }
+
+    if (!PyArray_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "can only be called with ndarray object");
+        return NULL;
+    }
+
+    PyArrayObject *arr = (PyArrayObject *)obj;
+
+    if (NPY_DTYPE(PyArray_DESCR(arr)) != (PyArray_DTypeMeta *)&StringDType) {
+        PyErr_SetString(PyExc_TypeError,
+                        "can only be called with a StringDType array");
+        return NULL;
+    }
+
+    StringDTypeObject *descr = (StringDTypeObject *)PyArray_DESCR(arr);
+    npy_intp elsize = descr->base.elsize;
+    int has_null = descr->na_object != NULL;
+    int has_string_na = descr->has_string_na;
+
+    unique_table table = {NULL, 0, 0, NULL, 0};
+    NpyIter *iter = NULL;
+    PyArrayObject *inverse = NULL;
+    npy_intp *ranks = NULL;
+    PyObject *uniques = NULL;
+    PyObject *index = NULL;
+    PyObject *counts = NULL;
+    PyObject *ret = NULL;
+    StringDTypeObject *out_descr = NULL;
+    // packed copies of the unique strings, allocated by out_descr
+    char *staged = NULL;
+    npy_intp num_staged = 0;
+
+    if (table_init(&table) < 0) {
+        PyErr_NoMemory();
+        goto finish;
+    }
+
+    // Nothing else can use this instance yet, so no other thread can get
+    // in the way of copying the unique strings into it. It is only used by
+    // the output array once that has been created.
+    out_descr = (StringDTypeObject *)new_stringdtype_instance(
+            descr->na_object, descr->coerce, descr->backend);
+    if (out_descr == NULL) {
+        goto finish;
+    }
+
+    if (return_inverse) {
+        inverse = (PyArrayObject *)PyArray_SimpleNew(
+                PyArray_NDIM(arr), PyArray_DIMS(arr), NPY_INTP);
+        if (inverse == NULL) {
+            goto finish;
+        }
+    }
+
+    // C order, so the indices match those of the flattened array
+    iter = NpyIter_New(arr,
+                       NPY_ITER_READONLY | NPY_ITER_EXTERNAL_LOOP |
+                               NPY_ITER_REFS_OK | NPY_ITER_ZEROSIZE_OK,
+                       NPY_CORDER, NPY_NO_CASTING, NULL);
+    if (iter == NULL) {
+        goto finish;
+    }
+
+    NpyIter_IterNextFunc *iternext = NpyIter_GetIterNext(iter, NULL);
+    if (iternext == NULL) {
+        goto finish;
+    }
+
+    char **dataptr = NpyIter_GetDataPtrArray(iter);
+    npy_intp *strideptr = NpyIter_GetInnerStrideArray(iter);
+    npy_intp *innersizeptr = NpyIter_GetInnerLoopSizePtr(iter);
+    npy_intp *inverse_data =
+            inverse != NULL ? (npy_intp *)PyArray_DATA(inverse) : NULL;
+    npy_intp null_group = -1;
+    npy_intp num = 0;
+    int err_is_memory = 0;
+
+    NPY_BEGIN_THREADS_DEF;
+    NPY_BEGIN_THREADS;
+
+    // The string views stored in the table stay valid until the allocator
+    // is released, so the unique strings are copied out before that.
+    npy_string_allocator *allocator =
+            NpyString_acquire_allocator_readonly(descr);
+
+    if (NpyIter_GetIterSize(iter) > 0) {
+        do {
+            char *in = dataptr[0];
+            npy_intp stride = *strideptr;
+            npy_intp count = *innersizeptr;
+
+            while (count-- && !err_is_memory) {
+                const npy_packed_static_string *ps =
+                        (npy_packed_static_string *)in;
+                npy_static_string s = {0, NULL};
+                int is_null = NpyString_load(allocator, ps, &s);
+                npy_intp g = -1;
+                if (is_null == -1) {
+                    err_is_memory = 1;
+                    break;
+                }
+                else if (is_null && has_null && !has_string_na) {
+                    if (null_group == -1) {
+                        null_group =
+                                table_new_group(&table, &s, 0, 1, num, in);
+                    }
+                    g = null_group;
+                }
+                else {
+                    if (is_null) {
+                        s = descr->default_string;
+                    }
+                    g = table_find_or_add(&table, &s, xxh64(s.buf, s.size, 0),
+                                          num, in);
+                }
+                if (g < 0) {
+                    err_is_memory = 1;
+                    break;
+                }
+                table.groups[g].count++;
+                if (inverse_data != NULL) {
+                    inverse_data[num] = g;
+                }
+                num++;
+                in += stride;
+            }
+        } while (!err_is_memory && iternext(iter));
+    }
+
+    if (!err_is_memory) {
+        qsort(table.groups, table.num_groups, sizeof(unique_group),
+              &group_cmp);
+        ranks = PyMem_RawMalloc((table.num_groups + 1) * sizeof(npy_intp));
+        if (ranks == NULL) {
+            err_is_memory = 1;
+        }
+        else {
+            for (npy_intp i = 0; i < table.num_groups; i++) {
+                ranks[table.groups[i].id] = i;
+            }
+            for (npy_intp i = 0; i < num && inverse_data != NULL; i++) {
+                inverse_data[i] = ranks[inverse_data[i]];
+            }
+        }
+    }
+
+    if (!err_is_memory) {
+        // zeroed packed strings are empty strings, which are safe to free
+        staged = PyMem_RawCalloc(table.num_groups + 1, elsize);
+        if (staged == NULL) {
+            err_is_memory = 1;
+        }
+    }
+
+    if (!err_is_memory) {
+        npy_string_allocator *out_allocator =
+                NpyString_acquire_allocator(out_descr);
+        for (; num_staged < table.num_groups; num_staged++) {
+            unique_group *group = &table.groups[num_staged];
+            if (NpyString_dup(
+                        (const npy_packed_static_string *)group->first_ptr,
+                        (npy_packed_static_string *)(staged +
+                                                     num_staged * elsize),
+                        allocator, out_allocator) < 0) {
+                err_is_memory = 1;
+                break;
+            }
+        }
+        NpyString_release_allocator(out_descr);
+    }
+
+    NpyString_release_allocator_readonly(descr);
+
+    NPY_END_THREADS;
+
+    if (err_is_memory) {
+        PyErr_SetString(PyExc_MemoryError,
+                        "Failed to allocate memory in unique");
+        goto finish;
+    }
+
+    npy_intp num_groups = table.num_groups;
+
+    // keeps a reference to out_descr, so the staged strings can still be
+    // freed if creating the array fails
+    Py_INCREF(out_descr);
+    uniques = PyArray_NewFromDescr(&PyArray_Type, (PyArray_Descr *)out_descr,
+                                   1, &num_groups, NULL, NULL, 0, NULL);
+    if (uniques == NULL) {
+        goto finish;
+    }
+    // out_descr has never been used by an array, so the array uses it
+    // instead of making a new instance
+    if (PyArray_DESCR((PyArrayObject *)uniques) !=
+        (PyArray_Descr *)out_descr) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "unique output array has an unexpected descriptor");
+        goto finish;
+    }
+    if (return_index) {
+        index = PyArray_SimpleNew(1, &num_groups, NPY_INTP);
+        if (index == NULL) {
+            goto finish;
+        }
+    }
+    if (return_counts) {
+        counts = PyArray_SimpleNew(1, &num_groups, NPY_INTP);
+        if (counts == NULL) {
+            goto finish;
+        }
+    }
+
+    // the strings now belong to the output array
+    memcpy(PyArray_BYTES((PyArrayObject *)uniques), staged,
+           num_groups * elsize);
+    num_staged = 0;
+
+    for (npy_intp i = 0; i < num_groups; i++) {
+        unique_group *group = &table.groups[i];
+        if (index != NULL) {
+            ((npy_intp *)PyArray_DATA((PyArrayObject *)index))[i] =
+                    group->first;
+        }
+        if (counts != NULL) {
+            ((npy_intp *)PyArray_DATA((PyArrayObject *)counts))[i] =
+                    group->count;
+        }
+    }
+
+    if (!return_index && !return_inverse && !return_counts) {
+        Py_INCREF(uniques);
+        ret = uniques;
+        goto finish;
+    }
+
+    ret = PyTuple_New(1 + return_index + return_inverse + return_counts);
+    if (ret == NULL) {
+        goto finish;
+    }
+    Py_ssize_t pos = 0;
+    Py_INCREF(uniques);
+    PyTuple_SET_ITEM(ret, pos++, uniques);
+    if (return_index) {
+        Py_INCREF(index);
+        PyTuple_SET_ITEM(ret, pos++, index);
+    }
+    if (return_inverse) {
+        Py_INCREF(inverse);
+        PyTuple_SET_ITEM(ret, pos++, (PyObject *)inverse);
+    }
+    if (return_counts) {
+        Py_INCREF(counts);
+        PyTuple_SET_ITEM(ret, pos++, counts);
+    }
+
+finish:
+    if (num_staged > 0) {
+        npy_string_allocator *out_allocator =
+                NpyString_acquire_allocator(out_descr);
+        for (npy_intp i = 0; i < num_staged; i++) {
+            NpyString_free((npy_packed_static_string *)(staged + i * elsize),
+                           out_allocator);
+        }
+        NpyString_release_allocator(out_descr);
+    }
+    PyMem_RawFree(staged);
+    Py_XDECREF(out_descr);
+    table_free(&table);
+    PyMem_RawFree(ranks);
+    if (iter != NULL) {
+        NpyIter_Deallocate(iter);
+    }
+    Py_XDECREF(inverse);
+    Py_XDECREF(uniques);
+    Py_XDECREF(index);
+    Py_XDECREF(counts);
+    return ret;
+}
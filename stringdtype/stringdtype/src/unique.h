@@ -0,0 +1,10 @@
+#ifndef _NPY_UNIQUE_H
+#define _NPY_UNIQUE_H
+
+#include <Python.h>
+
+// Find the unique elements of a StringDType array using a hash table
+PyObject *
+unique(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif /*_NPY_UNIQUE_H */
@@ -0,0 +1,299 @@
+#include "utf8_utils.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define ASCII_WORD_MASK 0x8080808080808080ULL
+
+// number of code points converted at once when a run of text is ASCII
+#define ASCII_BLOCK_SIZE 8
+
+int
+utf8_is_valid(const char *buf, size_t len)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    size_t i = 0;
+
+    while (i < len) {
+        // skip over runs of ASCII text a word at a time
+        if (i + sizeof(uint64_t) <= len) {
+            uint64_t word;
+            memcpy(&word, s + i, sizeof(uint64_t));
+            if (!(word & ASCII_WORD_MASK)) {
+                i += sizeof(uint64_t);
+                continue;
+            }
+        }
+        unsigned char c = s[i];
+        if (c < 0x80) {
+            i += 1;
+            continue;
+        }
+        size_t num_continuation;
+        // bounds on the first continuation byte, which rule out overlong
+        // encodings, surrogates, and code points beyond U+10FFFF
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (c < 0xC2) {
+            // unexpected continuation byte or overlong two byte sequence
+            return 0;
+        }
+        else if (c < 0xE0) {
+            num_continuation = 1;
+        }
+        else if (c < 0xF0) {
+            num_continuation = 2;
+            if (c == 0xE0) {
+                lo = 0xA0;
+            }
+            else if (c == 0xED) {
+                hi = 0x9F;
+            }
+        }
+        else if (c < 0xF5) {
+            num_continuation = 3;
+            if (c == 0xF0) {
+                lo = 0x90;
+            }
+            else if (c == 0xF4) {
+                hi = 0x8F;
+            }
+        }
+        else {
+            return 0;
+        }
+        if (len - i <= num_continuation) {
+            return 0;
+        }
+        if (s[i + 1] < lo || s[i + 1] > hi) {
+            return 0;
+        }
+        for (size_t j = 2; j <= num_continuation; j++) {
+            if ((s[i + j] & 0xC0) != 0x80) {
+                return 0;
+            }
+        }
+        i += num_continuation + 1;
+    }
+
+    return 1;
+}
+
+int
+ucs4_utf8_size(const uint32_t *codepoints, size_t max_length,
+               size_t *num_codepoints, size_t *utf8_bytes)
+{
+    size_t len = max_length;
+    while (len > 0 && codepoints[len - 1] == 0) {
+        len--;
+    }
+
+    // no branches in the loop body, so the compiler can vectorize it
+    size_t num_bytes = len;
+    uint32_t invalid = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint32_t code = codepoints[i];
+        num_bytes += (code > 0x7F) + (code > 0x7FF) + (code > 0xFFFF);
+        invalid |= (code - 0xD800 < 0x800) | (code > 0x10FFFF);
+    }
+    if (invalid) {
+        return -1;
+    }
+
+    *num_codepoints = len;
+    *utf8_bytes = num_bytes;
+    return 0;
+}
+
+size_t
+ucs4_to_utf8(const uint32_t *codepoints, size_t num_codepoints, char *buf)
+{
+    unsigned char *out = (unsigned char *)buf;
+    size_t i = 0;
+
+    while (i < num_codepoints) {
+        if (num_codepoints - i >= ASCII_BLOCK_SIZE) {
+            uint32_t any = 0;
+            for (size_t j = 0; j < ASCII_BLOCK_SIZE; j++) {
+                any |= codepoints[i + j];
+            }
+            if (any <= 0x7F) {
+                for (size_t j = 0; j < ASCII_BLOCK_SIZE; j++) {
+                    out[j] = (unsigned char)codepoints[i + j];
+                }
+                out += ASCII_BLOCK_SIZE;
+                i += ASCII_BLOCK_SIZE;
+                continue;
+            }
+        }
+        uint32_t code = codepoints[i++];
+        if (code <= 0x7F) {
+            // 0zzzzzzz -> 0zzzzzzz
+            *out++ = (unsigned char)code;
+        }
+        else if (code <= 0x7FF) {
+            // 00000yyy yyzzzzzz -> 110yyyyy 10zzzzzz
+            *out++ = (unsigned char)(0xC0 | (code >> 6));
+            *out++ = (unsigned char)(0x80 | (code & 0x3F));
+        }
+        else if (code <= 0xFFFF) {
+            // xxxxyyyy yyzzzzzz -> 1110xxxx 10yyyyyy 10zzzzzz
+            *out++ = (unsigned char)(0xE0 | (code >> 12));
+            *out++ = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+            *out++ = (unsigned char)(0x80 | (code & 0x3F));
+        }
+        else {
+            // 000wwwxx xxxxyyyy yyzzzzzz
+            // -> 11110www 10xxxxxx 10yyyyyy 10zzzzzz
+            *out++ = (unsigned char)(0xF0 | (code >> 18));
+            *out++ = (unsigned char)(0x80 | ((code >> 12) & 0x3F));
+            *out++ = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+            *out++ = (unsigned char)(0x80 | (code & 0x3F));
+        }
+    }
+
+    return (size_t)(out - (unsigned char *)buf);
+}
+
+size_t
+utf8_to_ucs4(const char *buf, size_t len, uint32_t *codepoints,
+             size_t max_codepoints)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    const unsigned char *end = s + len;
+    size_t n = 0;
+
+    while (s < end && n < max_codepoints) {
+        if ((size_t)(end - s) >= sizeof(uint64_t) &&
+            max_codepoints - n >= sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, s, sizeof(uint64_t));
+            if (!(word & ASCII_WORD_MASK)) {
+                for (size_t j = 0; j < sizeof(uint64_t); j++) {
+                    codepoints[n + j] = s[j];
+                }
+                s += sizeof(uint64_t);
+                n += sizeof(uint64_t);
+                continue;
+            }
+        }
+        unsigned char c = s[0];
+        if (c <= 0x7F) {
+            codepoints[n] = c;
+            s += 1;
+        }
+        else if (c <= 0xDF) {
+            codepoints[n] = ((uint32_t)(c & 0x1F) << 6) | (s[1] & 0x3F);
+            s += 2;
+        }
+        else if (c <= 0xEF) {
+            codepoints[n] = ((uint32_t)(c & 0x0F) << 12) |
+                            ((uint32_t)(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+            s += 3;
+        }
+        else {
+            codepoints[n] = ((uint32_t)(c & 0x07) << 18) |
+                            ((uint32_t)(s[1] & 0x3F) << 12) |
+                            ((uint32_t)(s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+            s += 4;
+        }
+        n++;
+    }
+
+    return n;
+}
+
+int
+utf8_is_ascii(const char *buf, size_t len)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    size_t i = 0;
+    uint64_t any = 0;
+
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, s + i, sizeof(uint64_t));
+        any |= word;
+    }
+    for (; i < len; i++) {
+        any |= s[i];
+    }
+
+    return !(any & ASCII_WORD_MASK);
+}
+
+size_t
+utf8_num_codepoints(const char *buf, size_t len)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    size_t num_codepoints = len;
+    size_t i = 0;
+
+    // every byte except the continuation bytes, 10xxxxxx, starts a code
+    // point, so count the continuation bytes a word at a time
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, s + i, sizeof(uint64_t));
+        uint64_t continuation = word & ~(word << 1) & ASCII_WORD_MASK;
+        // sums up the high bits of the bytes into the top byte
+        num_codepoints -=
+                (size_t)(((continuation >> 7) * 0x0101010101010101ULL) >> 56);
+    }
+    for (; i < len; i++) {
+        num_codepoints -= (s[i] & 0xC0) == 0x80;
+    }
+
+    return num_codepoints;
+}
+
+size_t
+utf8_codepoint_offset(const char *buf, size_t len, size_t index)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    size_t offset = 0;
+
+    while (index > 0 && offset < len) {
+        unsigned char c = s[offset];
+        offset += 1 + (c >= 0xC0) + (c >= 0xE0) + (c >= 0xF0);
+        index--;
+    }
+
+    return offset;
+}
+
+size_t
+utf8_decode(const char *buf, uint32_t *codepoint)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    unsigned char c = s[0];
+
+    if (c <= 0x7F) {
+        *codepoint = c;
+        return 1;
+    }
+    else if (c <= 0xDF) {
+        *codepoint = ((uint32_t)(c & 0x1F) << 6) | (s[1] & 0x3F);
+        return 2;
+    }
+    else if (c <= 0xEF) {
+        *codepoint = ((uint32_t)(c & 0x0F) << 12) |
+                     ((uint32_t)(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+        return 3;
+    }
+    *codepoint = ((uint32_t)(c & 0x07) << 18) |
+                 ((uint32_t)(s[1] & 0x3F) << 12) |
+                 ((uint32_t)(s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+    return 4;
+}
+
+size_t
+utf8_last_codepoint_size(const char *buf, size_t len)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    size_t size = 1;
+
+    while (size < len && (s[len - size] & 0xC0) == 0x80) {
+        size++;
+    }
+
+    return size;
+}
@@ -0,0 +1,60 @@
+#ifndef _NPY_UTF8_UTILS_H
+#define _NPY_UTF8_UTILS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns 1 if the first *len* bytes of *buf* are valid UTF-8 and 0
+// otherwise. Overlong encodings, surrogates, and code points beyond U+10FFFF
+// are invalid.
+int
+utf8_is_valid(const char *buf, size_t len);
+
+// Finds the number of code points in the first *max_length* entries of
+// *codepoints* that are not trailing null code points, *num_codepoints*,
+// and the number of bytes needed to encode them in UTF-8, *utf8_bytes*.
+// Returns 0 on success and -1 if any of the code points is a surrogate or
+// is beyond U+10FFFF.
+int
+ucs4_utf8_size(const uint32_t *codepoints, size_t max_length,
+               size_t *num_codepoints, size_t *utf8_bytes);
+
+// Encodes the first *num_codepoints* entries of *codepoints*, which must
+// have been checked with ucs4_utf8_size, as UTF-8 in *buf*. Returns the
+// number of bytes written.
+size_t
+ucs4_to_utf8(const uint32_t *codepoints, size_t num_codepoints, char *buf);
+
+// Decodes the first *len* bytes of *buf*, which must be valid UTF-8, into
+// *codepoints*, stopping after *max_codepoints* code points. Returns the
+// number of code points written.
+size_t
+utf8_to_ucs4(const char *buf, size_t len, uint32_t *codepoints,
+             size_t max_codepoints);
+
+// Returns 1 if the first *len* bytes of *buf* are all ASCII and 0 otherwise
+int
+utf8_is_ascii(const char *buf, size_t len);
+
+// Returns the number of code points in the first *len* bytes of *buf*,
+// which must be valid UTF-8.
+size_t
+utf8_num_codepoints(const char *buf, size_t len);
+
+// Returns the byte offset of the code point at *index* in the first *len*
+// bytes of *buf*, which must be valid UTF-8, or *len* if there are not that
+// many code points.
+size_t
+utf8_codepoint_offset(const char *buf, size_t len, size_t index);
+
+// Decodes the code point that starts at *buf*, which must be valid UTF-8,
+// into *codepoint*. Returns the number of bytes it takes up.
+size_t
+utf8_decode(const char *buf, uint32_t *codepoint);
+
+// Returns the number of bytes taken up by the last code point in the first
+// *len* bytes of *buf*, which must be valid UTF-8 and not empty.
+size_t
+utf8_last_codepoint_size(const char *buf, size_t len);
+
+#endif /*_NPY_UTF8_UTILS_H */
@@ -23,14 +23,14 @@ def unicode_array():
 
 
 UNARY_FUNCTIONS = [
-    # "str_len",
+    "str_len",
     "capitalize",
     "expandtabs",
     "isalnum",
-    # "isalpha",
-    # "isdigit",
+    "isalpha",
+    "isdigit",
     "islower",
-    # "isspace",
+    "isspace",
     "istitle",
     "isupper",
     "lower",
@@ -59,21 +59,21 @@ BINARY_FUNCTIONS = [
     ("multiply", (None, 2)),
     ("mod", ("format: %s", None)),
     ("center", (None, 25)),
-    # ("count", (None, "A")),
+    ("count", (None, "A")),
     ("encode", (None, "UTF-8")),
-    # ("endswith", (None, "lo")),
-    # ("find", (None, "A")),
+    ("endswith", (None, "lo")),
+    ("find", (None, "A")),
     ("index", (None, "e")),
     ("join", ("-", None)),
     ("ljust", (None, 12)),
     ("partition", (None, "A")),
     ("replace", (None, "A", "B")),
-    # ("rfind", (None, "A")),
+    ("rfind", (None, "A")),
     ("rindex", (None, "e")),
     ("rjust", (None, 12)),
     ("rpartition", (None, "A")),
     ("split", (None, "A")),
-    # ("startswith", (None, "A")),
+    ("startswith", (None, "A")),
     ("zfill", (None, 12)),
 ]
 
@@ -124,3 +124,25 @@ def test_strip(string_array, unicode_array):
         np.char.strip(rjs),
         np.char.strip(rju).astype(StringDType()),
     )
+
+
+@pytest.mark.parametrize("function_name", ["find", "rfind", "count"])
+@pytest.mark.parametrize("sub", ["", "e", "☃€", "😊"])
+@pytest.mark.parametrize("start, end", [(0, None), (3, 40), (-20, -2), (5, 2)])
+def test_find_indices(
+    string_array, unicode_array, function_name, sub, start, end
+):
+    func = getattr(np.char, function_name)
+    assert_array_equal(
+        func(string_array, sub, start, end),
+        func(unicode_array, sub, start, end),
+    )
+
+
+@pytest.mark.parametrize("chars", ["", "he", "😊 ", "A\n"])
+def test_strip_chars(string_array, unicode_array, chars):
+    for func in [np.char.strip, np.char.lstrip, np.char.rstrip]:
+        assert_array_equal(
+            func(string_array, chars),
+            func(unicode_array, chars).astype(StringDType()),
+        )
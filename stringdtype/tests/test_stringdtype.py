@@ -1,8 +1,11 @@
+import bisect
 import concurrent.futures
+import operator
 import os
 import pickle
 import string
 import tempfile
+import threading
 
 import numpy as np
 
@@ -12,7 +15,33 @@ except ImportError:
     pd_NA = None
 import pytest
 
-from stringdtype import StringDType, StringScalar, _memory_usage
+from stringdtype import (
+    StringDType,
+    StringScalar,
+    _main,
+    _memory_usage,
+    compact,
+    from_arrow_buffers,
+    from_sequence,
+)
+from stringdtype import (
+    lower,
+    replace,
+    searchsorted,
+    string_hash,
+    to_arrow_buffers,
+    unique,
+    upper,
+)
+
+# the debug allocator is only built with the debug_allocator meson option
+_set_debug_allocation_limit = getattr(
+    _main, "_set_debug_allocation_limit", None
+)
+requires_debug_allocator = pytest.mark.skipif(
+    _set_debug_allocation_limit is None,
+    reason="built without the debug allocator",
+)
 
 
 @pytest.fixture
@@ -210,6 +239,32 @@ def test_unicode_casts(dtype, strings):
     )
 
 
+def test_unicode_transcoding(dtype):
+    # long enough for the ASCII fast paths, with non-ASCII characters at
+    # every position of a block
+    strings = ["abcdefghij" * 5, "", "x" * 7]
+    for i in range(17):
+        for c in ["é", "☃", "😊"]:
+            strings.append("a" * i + c + "b" * (20 - i))
+    arr = np.array(strings, dtype=dtype)
+    uarr = np.array(strings, dtype="U50")
+    np.testing.assert_array_equal(arr.astype("U50"), uarr)
+    np.testing.assert_array_equal(uarr.astype(dtype), arr)
+    np.testing.assert_array_equal(
+        arr.astype("U9"), np.array([s[:9] for s in strings], dtype="U9")
+    )
+
+    # the output is padded with nulls
+    out = np.full(len(strings), "z" * 50, dtype="U50")
+    out[:] = arr
+    np.testing.assert_array_equal(out, uarr)
+
+    for code in [0xD800, 0xDFFF, 0x110000]:
+        bad = np.array([97, code, 98], dtype=np.uint32).view("U3")
+        with pytest.raises(TypeError, match="Invalid unicode code point"):
+            bad.astype(dtype)
+
+
 def test_additional_unicode_cast(random_string_list, dtype):
     arr = np.array(random_string_list, dtype=dtype)
     np.testing.assert_array_equal(arr, arr.astype(dtype))
@@ -218,6 +273,50 @@ def test_additional_unicode_cast(random_string_list, dtype):
     )
 
 
+def test_object_cast(dtype, string_list):
+    strings = string_list + ["", "☃"]
+    if hasattr(dtype, "na_object"):
+        strings = strings + [dtype.na_object]
+    arr = np.array(strings, dtype=dtype)
+    res = arr.astype(object)
+    assert res.dtype == object
+    assert res.tolist() == arr.tolist()
+    if hasattr(dtype, "na_object"):
+        assert res[-1] is dtype.na_object
+
+    # repeated strings share a single object
+    arr = np.array(["abc", "d" * 20, "☃"] * 1000, dtype=dtype)
+    res = arr.astype(object)
+    assert res.tolist() == arr.tolist()
+    assert res[0] is res[3] and res[1] is res[4]
+
+    # mostly unique strings, including strided views
+    strings = [str(i) * (i % 5) for i in range(10000)]
+    arr = np.array(strings, dtype=dtype)
+    assert arr.astype(object).tolist() == strings
+    assert arr[::-3].astype(object).tolist() == strings[::-3]
+
+
+def test_object_cast_runs_finalizers_unlocked():
+    # dropping the objects the output held before can run python code that
+    # writes to the array being cast
+    arr = np.array(["a" * 20, "b" * 20, "c" * 20], dtype=StringDType())
+
+    class Writer:
+        def __del__(self):
+            arr[2] = "written by a finalizer"
+
+    out = np.array([Writer(), Writer(), Writer()], dtype=object)
+    out[...] = arr
+    assert out.tolist() == ["a" * 20, "b" * 20, "c" * 20]
+    assert arr[2] == "written by a finalizer"
+
+    # strings bigger than the blocks they are copied out in
+    strings = ["x" * 100000, "y" * 200000, "z"]
+    arr = np.array(strings, dtype=StringDType())
+    assert arr.astype(object).tolist() == strings
+
+
 def test_insert_scalar(dtype, string_list):
     """Test that inserting a scalar works."""
     arr = np.array(string_list, dtype=dtype)
@@ -281,6 +380,71 @@ def test_comparisons(string_list, dtype, op, o_dtype):
     np.testing.assert_array_equal(res, orres)
 
 
+@pytest.mark.parametrize("op", comparison_operators)
+def test_comparisons_embedded_null(op):
+    strings = ["a\0b", "a\0c", "a", "a\0", "x" * 20 + "\0a", "x" * 20]
+    pairs = [(s1, s2) for s1 in strings for s2 in strings]
+    arr1 = np.array([p[0] for p in pairs], dtype=StringDType())
+    arr2 = np.array([p[1] for p in pairs], dtype=StringDType())
+    pyop = {
+        np.equal: operator.eq,
+        np.not_equal: operator.ne,
+        np.greater: operator.gt,
+        np.greater_equal: operator.ge,
+        np.less: operator.lt,
+        np.less_equal: operator.le,
+    }[op]
+    expected = [pyop(s1, s2) for s1, s2 in pairs]
+    np.testing.assert_array_equal(op(arr1, arr2), expected)
+
+
+@pytest.mark.parametrize("op", comparison_operators)
+def test_comparisons_scalar_operand(dtype, string_list, op):
+    if hasattr(dtype, "na_object"):
+        string_list = string_list + [dtype.na_object]
+    arr = np.array(string_list, dtype=dtype)
+    for value in string_list:
+        scalar = np.array(value, dtype=dtype)
+        full = np.array([value] * len(arr), dtype=dtype)
+        for args, full_args in [
+            ((arr, scalar), (arr, full)),
+            ((scalar, arr), (full, arr)),
+        ]:
+            try:
+                expected = op(*full_args)
+            except TypeError:
+                with pytest.raises(TypeError):
+                    op(*args)
+                continue
+            np.testing.assert_array_equal(op(*args), expected)
+
+
+@pytest.mark.parametrize("op", comparison_operators)
+def test_comparisons_null_scalar_without_na_object(op):
+    # NaT casts to a null string even if the dtype has no na_object,
+    # comparisons treat such nulls as the default string
+    nat = np.datetime64("NaT")
+    scalar = np.array([nat]).astype(StringDType())
+    full = np.array([nat] * 3).astype(StringDType())
+    arr = np.array(["abc", "", "x"], dtype=StringDType())
+    empty = np.array([""] * 3, dtype=StringDType())
+    for args, full_args, empty_args in [
+        ((arr, scalar), (arr, full), (arr, empty)),
+        ((scalar, arr), (full, arr), (empty, arr)),
+    ]:
+        expected = op(*empty_args)
+        np.testing.assert_array_equal(op(*full_args), expected)
+        np.testing.assert_array_equal(op(*args), expected)
+
+
+def test_equality_with_none_na():
+    dtype = StringDType(na_object=None)
+    arr1 = np.array([None, None, "", "x"], dtype=dtype)
+    arr2 = np.array(["", None, None, "x"], dtype=dtype)
+    np.testing.assert_array_equal(arr1 == arr2, [False, True, False, True])
+    np.testing.assert_array_equal(arr1 != arr2, [True, False, True, False])
+
+
 def test_isnan(dtype, string_list):
     if not hasattr(dtype, "na_object"):
         pytest.skip("no na support")
@@ -303,16 +467,406 @@ def test_isnan(dtype, string_list):
 
 def test_memory_usage(dtype):
     sarr = np.array(["abcdefghijklmnopqrstuvqxyz", "def", "ghi"], dtype=dtype)
-    # 26 bytes for the long string buffer in string_list
-    # plus enough bytes for the size_t length
-    # plus enough bytes for the pointer in the array buffer
-    assert _memory_usage(sarr) == (2 * np.dtype(np.uintp).itemsize) * 3 + 26
+    usage = _memory_usage(sarr, detailed=True)
+    # enough bytes for the packed strings in the array buffer
+    assert usage["packed"] == (2 * np.dtype(np.uintp).itemsize) * 3
+    # 26 bytes for the long string buffer plus a one byte size prefix, the
+    # short strings are stored in the packed strings
+    assert usage["arena_live"] == 26
+    assert usage["arena_prefix"] == 1
+    assert usage["arena_dead"] == 0
+    assert usage["heap"] == 0
+    assert usage["arena_capacity"] == (
+        usage["arena_live"] + usage["arena_prefix"] + usage["arena_unused"]
+    )
+    assert _memory_usage(sarr) == (
+        usage["packed"] + usage["arena_capacity"] + usage["heap"]
+    )
+
+    # a shorter string reuses the existing allocation
+    sarr[0] = "y" * 20
+    usage = _memory_usage(sarr, detailed=True)
+    assert usage["arena_live"] == 26
+    assert usage["arena_dead"] == 0
+
+    # a longer string frees it and is appended to the arena
+    sarr[0] = "z" * 100
+    usage = _memory_usage(sarr, detailed=True)
+    assert usage["arena_live"] == 100
+    assert usage["arena_dead"] == 27
+    assert usage["heap"] == 0
+    compact(sarr)
+    usage = _memory_usage(sarr, detailed=True)
+    assert usage["arena_live"] == 100
+    assert usage["arena_dead"] == 0
+    assert usage["heap"] == 0
+
     with pytest.raises(TypeError):
         _memory_usage("hello")
     with pytest.raises(TypeError):
         _memory_usage(np.array([1, 2, 3]))
 
 
+def test_compact(dtype, string_list):
+    arr = np.array(string_list * 4, dtype=dtype)
+    # nothing has been freed yet
+    assert not compact(arr)
+    # overwrite entries with longer strings, which have to be stored
+    # elsewhere, leaving dead bytes in the arena
+    arr[::2] = [s + "-longer" for s in arr[::2]]
+    arr[1::4] = "short"
+    expected = arr.copy()
+    with pytest.raises(ValueError):
+        compact(arr[::2])
+    assert not compact(arr, threshold=1.0)
+    assert compact(arr)
+    np.testing.assert_array_equal(arr, expected)
+    assert not compact(arr)
+    # compacted arrays can still be mutated
+    arr[::3] = [s + "abc" * 20 for s in arr[::3]]
+    expected[::3] = [s + "abc" * 20 for s in expected[::3]]
+    np.testing.assert_array_equal(arr, expected)
+    assert compact(arr, threshold=0.01)
+    np.testing.assert_array_equal(arr, expected)
+    with pytest.raises(TypeError):
+        compact(np.array([1, 2, 3]))
+
+
+@requires_debug_allocator
+def test_compact_allocation_failure():
+    arr = np.array(
+        [str(i) * 100 for i in range(1000)],
+        dtype=StringDType(allocator="debug"),
+    )
+    arr[::2] = "short"
+    expected = arr.copy()
+    # the compacted arena can't be allocated in one go, so it grows until
+    # an allocation fails after some of the strings have been moved
+    _set_debug_allocation_limit(4096)
+    try:
+        with pytest.raises(MemoryError):
+            compact(arr)
+    finally:
+        _set_debug_allocation_limit(0)
+    # the strings that weren't moved are still in the old arena
+    np.testing.assert_array_equal(arr, expected)
+    arr[1::4] = "another string that is stored in the arena"
+    expected[1::4] = "another string that is stored in the arena"
+    assert compact(arr)
+    np.testing.assert_array_equal(arr, expected)
+    assert _memory_usage(arr, detailed=True)["arena_dead"] == 0
+
+
+def test_from_arrow_buffers(dtype):
+    strings = ["hello", "", "a" * 30, "A¢☃€ 😊" * 50, "world"]
+    encoded = [s.encode() for s in strings]
+    data = b"".join(encoded)
+    offsets = np.cumsum([0] + [len(e) for e in encoded])
+
+    expected = np.array(strings, dtype=dtype)
+    for offsets_type in [np.int32, np.int64]:
+        arr = from_arrow_buffers(
+            data, offsets.astype(offsets_type), dtype=dtype
+        )
+        assert arr.dtype == dtype
+        np.testing.assert_array_equal(arr, expected)
+
+    arr = from_arrow_buffers(np.frombuffer(data, dtype=np.uint8), offsets)
+    assert arr.dtype == StringDType()
+    np.testing.assert_array_equal(arr, expected)
+
+    assert from_arrow_buffers(b"", [0]).shape == (0,)
+
+    validity = np.packbits([1, 0, 1, 1, 0], bitorder="little")
+    if hasattr(dtype, "na_object"):
+        arr = from_arrow_buffers(data, offsets, validity, dtype=dtype)
+        assert arr[1] is dtype.na_object
+        assert arr[4] is dtype.na_object
+        np.testing.assert_array_equal(arr[[0, 2, 3]], expected[[0, 2, 3]])
+    else:
+        with pytest.raises(ValueError):
+            from_arrow_buffers(data, offsets, validity, dtype=dtype)
+
+    with pytest.raises(ValueError):
+        from_arrow_buffers(b"a\xffb", [0, 1, 3], dtype=dtype)
+    with pytest.raises(ValueError):
+        from_arrow_buffers(data, [0, 3, 2], dtype=dtype)
+    with pytest.raises(ValueError):
+        from_arrow_buffers(data, [0, len(data) + 1], dtype=dtype)
+    with pytest.raises(ValueError):
+        from_arrow_buffers(data, offsets, validity[:0], dtype=dtype)
+    with pytest.raises(TypeError):
+        from_arrow_buffers(data, offsets, dtype=np.dtype("U"))
+
+
+def test_to_arrow_buffers(dtype, string_list):
+    arr = np.array(string_list, dtype=dtype)
+    offsets, data, validity = to_arrow_buffers(arr)
+    assert offsets.dtype == np.int64
+    assert data.dtype == np.uint8
+    assert validity is None
+    encoded = [s.encode() for s in string_list]
+    assert data.tobytes() == b"".join(encoded)
+    np.testing.assert_array_equal(
+        offsets, np.cumsum([0] + [len(e) for e in encoded])
+    )
+    np.testing.assert_array_equal(
+        from_arrow_buffers(data, offsets, dtype=dtype), arr
+    )
+
+    # multidimensional and non-contiguous arrays are flattened in C order
+    arr2d = np.array(string_list * 2, dtype=dtype).reshape(2, -1)[:, ::2]
+    offsets, data, validity = to_arrow_buffers(arr2d)
+    np.testing.assert_array_equal(
+        from_arrow_buffers(data, offsets, dtype=dtype), arr2d.ravel()
+    )
+
+    offsets, data, validity = to_arrow_buffers(np.array([], dtype=dtype))
+    assert offsets.tolist() == [0]
+    assert data.size == 0
+    assert validity is None
+
+    if hasattr(dtype, "na_object"):
+        arr = np.array(
+            [dtype.na_object] + string_list + [dtype.na_object], dtype=dtype
+        )
+        offsets, data, validity = to_arrow_buffers(arr)
+        assert data.tobytes() == b"".join(encoded)
+        expected = [0] + [1] * len(string_list) + [0]
+        np.testing.assert_array_equal(
+            np.unpackbits(validity, bitorder="little")[: arr.size], expected
+        )
+        res = from_arrow_buffers(data, offsets, validity, dtype=dtype)
+        assert res[0] is dtype.na_object
+        assert res[-1] is dtype.na_object
+        np.testing.assert_array_equal(res[1:-1], arr[1:-1])
+
+    with pytest.raises(TypeError):
+        to_arrow_buffers(np.array(["a"]))
+
+
+def test_threaded_to_arrow_buffers_with_writers():
+    # the allocator is released between the two passes, so writers that
+    # don't need the GIL can change the array in between, and every export
+    # must still be a consistent snapshot
+    dtype = StringDType()
+    strings = ["x" * (i % 40) for i in range(10000)]
+    arr = np.array(strings + [""] * 8, dtype=dtype)
+    tail = arr[len(strings) :]
+    values = ["", "ab", "y" * 15, "z" * 50]
+    sources = [np.array([v] * 8, dtype=dtype) for v in values]
+    added = [v + v for v in values]
+
+    def work(i):
+        if i % 2:
+            for _ in range(20):
+                offsets, data, validity = to_arrow_buffers(arr)
+                res = from_arrow_buffers(data, offsets, dtype=dtype).tolist()
+                assert res[: len(strings)] == strings
+                assert all(v in added for v in res[len(strings) :])
+        else:
+            for j in range(2000):
+                np.add(
+                    sources[j % len(values)],
+                    sources[j % len(values)],
+                    out=tail,
+                )
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=8) as tpe:
+        futures = [tpe.submit(work, i) for i in range(16)]
+
+        for f in futures:
+            f.result()
+
+
+def test_from_sequence(dtype, string_list):
+    strings = string_list + ["", "☃"]
+    expected = np.array(strings, dtype=dtype)
+    for seq in (strings, tuple(strings)):
+        arr = from_sequence(seq, dtype=dtype)
+        assert arr.dtype == dtype
+        np.testing.assert_array_equal(arr, expected)
+    assert from_sequence([], dtype=dtype).shape == (0,)
+    assert from_sequence(["a"]).dtype == StringDType()
+
+    if hasattr(dtype, "na_object"):
+        arr = from_sequence(strings + [dtype.na_object], dtype=dtype)
+        np.testing.assert_array_equal(arr[:-1], expected)
+        assert arr[-1] is dtype.na_object
+
+    # anything that isn't an exact list or tuple of str is handled by
+    # numpy.array
+    nested = [["a", "b"], ["c", "d"]]
+    np.testing.assert_array_equal(
+        from_sequence(nested, dtype=dtype), np.array(nested, dtype=dtype)
+    )
+    if dtype.coerce:
+        assert from_sequence(["a", 1], dtype=dtype).tolist() == ["a", "1"]
+    else:
+        with pytest.raises(ValueError):
+            from_sequence(["a", 1], dtype=dtype)
+
+    with pytest.raises(UnicodeEncodeError):
+        from_sequence(["a", "\ud800"], dtype=dtype)
+    with pytest.raises(TypeError):
+        from_sequence(["a"], dtype=np.dtype("U1"))
+
+
+def test_arrow_roundtrip(string_list):
+    pa = pytest.importorskip("pyarrow")
+    dtype = StringDType(na_object=None)
+    arr = np.array(string_list + [None], dtype=dtype)
+    offsets, data, validity = to_arrow_buffers(arr)
+    buffers = [
+        None if validity is None else pa.py_buffer(validity),
+        pa.py_buffer(offsets),
+        pa.py_buffer(data),
+    ]
+    pa_arr = pa.Array.from_buffers(pa.large_string(), arr.size, buffers)
+    assert pa_arr.to_pylist() == string_list + [None]
+    validity, offsets, data = pa_arr.buffers()
+    res = from_arrow_buffers(
+        data, np.frombuffer(offsets, dtype=np.int64), validity, dtype=dtype
+    )
+    np.testing.assert_array_equal(res[:-1], arr[:-1])
+    assert res[-1] is None
+
+
+def test_hash(dtype, string_list):
+    # reference values for XXH64 with a seed of zero
+    arr = np.array(
+        ["", "a", "abc", "Nobody inspects the spammish repetition"],
+        dtype=dtype,
+    )
+    res = string_hash(arr)
+    assert res.dtype == np.uint64
+    assert res.tolist() == [
+        0xEF46DB3751D8E999,
+        0xD24EC4F1A98C6E5B,
+        0x44BC2CF5AD770999,
+        0xFBCEA83C8A378BF1,
+    ]
+
+    arr = np.array(string_list * 2, dtype=dtype)
+    res = string_hash(arr)
+    n = len(string_list)
+    np.testing.assert_array_equal(res[:n], res[n:])
+    np.testing.assert_array_equal(string_hash(arr[::2]), res[::2])
+    assert len(set(res[:n].tolist())) == n
+
+    nan_dtype = StringDType(na_object=np.nan)
+    arr = np.array(["a", np.nan, np.nan], dtype=nan_dtype)
+    assert string_hash(arr).tolist()[1:] == [0, 0]
+
+
+def test_unique(dtype, string_list):
+    arr = np.array(string_list * 2, dtype=dtype).reshape(2, -1)[:, ::-1]
+    res = unique(
+        arr, return_index=True, return_inverse=True, return_counts=True
+    )
+    expected = np.unique(
+        arr, return_index=True, return_inverse=True, return_counts=True
+    )
+    assert res[0].dtype == arr.dtype
+    for r, e in zip(res, expected):
+        np.testing.assert_array_equal(r, e)
+    np.testing.assert_array_equal(unique(arr), expected[0])
+
+    # enough unique strings for the hash table to grow
+    strings = [str(i % 1000) * (i % 7) for i in range(10000)]
+    arr = np.array(strings, dtype=dtype)
+    res = unique(arr, return_counts=True)
+    expected = np.unique(np.array(strings), return_counts=True)
+    assert res[0].tolist() == expected[0].tolist()
+    np.testing.assert_array_equal(res[1], expected[1])
+
+    assert unique(np.array([], dtype=dtype)).tolist() == []
+
+
+def test_unique_nulls():
+    dtype = StringDType(na_object=np.nan)
+    arr = np.array(["b", np.nan, "a", np.nan, "b"], dtype=dtype)
+    res, inverse, counts = unique(arr, return_inverse=True, return_counts=True)
+    assert res.tolist()[:2] == ["a", "b"] and np.isnan(res[2])
+    np.testing.assert_array_equal(inverse, [1, 2, 0, 2, 1])
+    np.testing.assert_array_equal(counts, [1, 2, 2])
+
+    with pytest.raises(TypeError):
+        unique(np.array(["a", "b"]))
+
+
+@pytest.mark.parametrize(
+    "old, new, count",
+    [
+        ("a", "X", -1),
+        ("b", "YZ", 2),
+        ("", "-", -1),
+        ("", "-", 3),
+        ("☃", "", 1),
+    ],
+)
+def test_replace(dtype, string_list, old, new, count):
+    arr = np.array(string_list, dtype=dtype)
+    expected = [s.replace(old, new, count) for s in string_list]
+    assert replace(arr, old, new, count).tolist() == expected
+    replace(arr, old, new, count, out=arr)
+    assert arr.tolist() == expected
+
+
+def test_upper_lower(dtype, string_list):
+    strings = string_list + ["straße", "ǅ"]
+    arr = np.array(strings, dtype=dtype)
+    assert upper(arr).tolist() == [s.upper() for s in strings]
+    assert lower(arr).tolist() == [s.lower() for s in strings]
+    upper(arr, out=arr)
+    assert arr.tolist() == [s.upper() for s in strings]
+
+
+def test_threaded_upper_lower_with_writers():
+    # strings that aren't ASCII go through str.upper and str.lower with the
+    # allocator unlocked while other threads write to the same array
+    strings = ["straße", "ǅ", "ascii"] * 300
+    arr = np.array(strings + ["x"] * 8, dtype=StringDType())
+    data = arr[: len(strings)]
+    tail = arr[len(strings) :]
+    expected = [s.upper() for s in strings]
+
+    def work(i):
+        if i % 2:
+            for _ in range(10):
+                assert upper(data).tolist() == expected
+        else:
+            for j in range(1000):
+                tail[j % 8] = "ǅ" * (j % 20)
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=8) as tpe:
+        futures = [tpe.submit(work, i) for i in range(16)]
+
+        for f in futures:
+            f.result()
+    lower(tail, out=tail)
+    assert all(s == "ǆ" * len(s) for s in tail.tolist())
+
+
+def test_string_functions_nulls():
+    dtype = StringDType(na_object=np.nan)
+    arr = np.array([" a ", np.nan, "b1"], dtype=dtype)
+    res = np.char.strip(arr)
+    assert res[0] == "a" and np.isnan(res[1]) and res[2] == "b1"
+    assert np.isnan(upper(arr)[1])
+    assert np.isnan(replace(arr, "a", "c", -1)[1])
+    assert np.char.isalpha(arr).tolist() == [False, False, False]
+    with pytest.raises(ValueError):
+        np.char.str_len(arr)
+    with pytest.raises(ValueError):
+        np.char.find(arr, "a")
+
+    dtype = StringDType(na_object="unknown")
+    arr = np.array(["abc", "unknown"], dtype=dtype)
+    assert np.char.str_len(arr).tolist() == [3, 7]
+    assert np.char.find(arr, "n").tolist() == [-1, 1]
+
+
 def _pickle_load(filename):
     with open(filename, "rb") as f:
         res = pickle.load(f)
@@ -400,6 +954,87 @@ def test_sort(dtype, strings):
     test_sort(strings, arr_sorted)
 
 
+@pytest.mark.parametrize("kind", ["quicksort", "stable"])
+def test_sort_large(dtype, kind):
+    rng = np.random.default_rng(42)
+    # shared prefixes longer than a chunk, embedded and trailing NUL
+    # bytes, duplicates, and empty strings
+    pieces = ["", "a", "\0", "ab", "☃", "shared_prefix_", "😊"]
+    strings = [
+        "".join(rng.choice(pieces, size=rng.integers(0, 6)))
+        for _ in range(5000)
+    ]
+    arr = np.array(strings, dtype=dtype)
+    expected = sorted(strings)
+    assert np.sort(arr, kind=kind).tolist() == expected
+    assert arr[np.argsort(arr, kind=kind)].tolist() == expected
+
+
+@pytest.mark.parametrize("kind", ["quicksort", "stable"])
+def test_sort_long_shared_prefix(dtype, kind):
+    # the shared prefix spans many chunks, which must not use up the
+    # partitioning limit and fall back to a heap sort
+    rng = np.random.default_rng(7)
+    suffixes = rng.choice(list("abc\0"), size=(20000, 4))
+    strings = [
+        "p" * 430 + "".join(s[: i % 5]) for i, s in enumerate(suffixes)
+    ]
+    arr = np.array(strings, dtype=dtype)
+    expected = sorted(strings)
+    assert np.sort(arr, kind=kind).tolist() == expected
+    assert arr[np.argsort(arr, kind=kind)].tolist() == expected
+
+
+@pytest.mark.parametrize("side", ["left", "right"])
+@pytest.mark.parametrize("num_needles", [3, 1000])
+@pytest.mark.parametrize("prefix", ["", "shared_prefix_"])
+def test_searchsorted(dtype, side, num_needles, prefix):
+    rng = np.random.default_rng(7)
+    pieces = ["", "a", "\0", "ab", "☃", "shared_prefix_", "😊"]
+    strings = [
+        prefix + "".join(rng.choice(pieces, size=rng.integers(0, 5)))
+        for _ in range(2000)
+    ]
+    # needles with and without the prefix shared by the strings
+    needles = [
+        rng.choice(["", prefix, prefix[:5]])
+        + "".join(rng.choice(pieces, size=rng.integers(0, 5)))
+        for _ in range(num_needles)
+    ]
+    haystack = sorted(strings)
+    bisect_func = bisect.bisect_left if side == "left" else bisect.bisect_right
+    expected = [bisect_func(haystack, n) for n in needles]
+
+    arr = np.array(haystack, dtype=dtype)
+    res = searchsorted(arr, np.array(needles, dtype=dtype), side=side)
+    np.testing.assert_array_equal(res, expected)
+    np.testing.assert_array_equal(searchsorted(arr, needles, side), expected)
+
+    shuffled = np.array(strings, dtype=dtype)
+    sorter = np.argsort(shuffled)
+    res = searchsorted(shuffled, needles, side=side, sorter=sorter)
+    np.testing.assert_array_equal(res, expected)
+
+    assert searchsorted(arr, needles[0], side) == expected[0]
+
+
+def test_searchsorted_nulls():
+    dtype = StringDType(na_object=np.nan)
+    arr = np.array(["a", "b", "b", np.nan, np.nan], dtype=dtype)
+    needles = np.array(["b", np.nan, "c"], dtype=dtype)
+    np.testing.assert_array_equal(searchsorted(arr, needles), [1, 3, 3])
+    np.testing.assert_array_equal(
+        searchsorted(arr, needles, side="right"), [3, 5, 3]
+    )
+
+    with pytest.raises(ValueError):
+        searchsorted(arr, needles, side="middle")
+    with pytest.raises(ValueError):
+        searchsorted(arr, needles, sorter=[0, 1])
+    with pytest.raises(TypeError):
+        searchsorted(np.array(["a", "b"]), "a")
+
+
 @pytest.mark.parametrize(
     "strings",
     [
@@ -527,6 +1162,53 @@ def test_unsized_integer_casts(dtype, typename, signed):
     np.testing.assert_array_equal(ainp, ainp.astype(dtype).astype(idtype))
 
 
+def test_integer_parsing():
+    arr = np.array(
+        [" 12_345 ", "+7", "-0", "\t-42\n", "0" * 40 + "123456789012", "٣"],
+        dtype=StringDType(),
+    )
+    np.testing.assert_array_equal(
+        arr.astype("int64"), [12345, 7, 0, -42, 123456789012, 3]
+    )
+
+    arr = np.array(
+        ["-9223372036854775808", "9223372036854775807"], dtype=StringDType()
+    )
+    np.testing.assert_array_equal(arr.astype("int64"), [-(2**63), 2**63 - 1])
+    arr = np.array(["18446744073709551615", "-0"], dtype=StringDType())
+    np.testing.assert_array_equal(arr.astype("uint64"), [2**64 - 1, 0])
+
+    for bad in ["1__2", "1_", "_1", "", " ", "+", "1 2", "0x10", "1\x1f"]:
+        with pytest.raises(ValueError):
+            np.array([bad], dtype=StringDType()).astype("int64")
+
+    for big in ["9223372036854775808", "-9223372036854775809", "1" * 30]:
+        with pytest.raises(OverflowError):
+            np.array([big], dtype=StringDType()).astype("int64")
+    with pytest.raises(OverflowError):
+        np.array(["-1"], dtype=StringDType()).astype("uint64")
+
+
+def test_integer_formatting(dtype):
+    # every digit count, on both sides of each power of ten
+    powers = [10**i for i in range(20)]
+    values = sorted({v for p in powers for v in (p - 1, p, p + 1)})
+    uarr = np.array(values, dtype="uint64")
+    assert uarr.astype(dtype).tolist() == [str(v) for v in values]
+
+    iarr = np.array(
+        [-(2**63), 2**63 - 1] + [v for v in values if v < 2**63],
+        dtype="int64",
+    )
+    iarr[2::2] *= -1
+    assert iarr.astype(dtype).tolist() == [str(v) for v in iarr.tolist()]
+
+    # strided input, and output that already holds strings
+    out = np.array(["a" * 30, "b"] * 3, dtype=dtype)
+    out[:] = iarr[:12:2]
+    assert out.tolist() == [str(v) for v in iarr[:12:2].tolist()]
+
+
 @pytest.mark.parametrize("typename", ["float64", "float32", "float16"])
 def test_float_casts(dtype, typename):
     inp = [1.1, 2.8, -3.2, 2.7e4]
@@ -552,6 +1234,70 @@ def test_float_casts(dtype, typename):
     assert sres[0] == "0.1"
 
 
+@pytest.mark.parametrize("typename", ["float64", "float32", "float16"])
+def test_float_formatting(typename):
+    fi = np.finfo(typename)
+    special = [0.0, -0.0, np.inf, -np.inf, np.nan, 1e-4, 9.99e-5, 1 / 3]
+    extremes = [fi.max, fi.min, fi.smallest_normal, fi.smallest_subnormal]
+    arr = np.array(special + extremes, dtype=typename)
+    if typename == "float16":
+        # every float16 value
+        arr = np.arange(2**16, dtype=np.uint16).view(np.float16)
+    else:
+        rng = np.random.default_rng(0)
+        itype = f"uint{fi.bits}"
+        bits = rng.integers(0, np.iinfo(itype).max, 10000, dtype=itype)
+        arr = np.concatenate([arr, bits.view(typename)])
+    res = arr.astype(StringDType()).tolist()
+    assert res == [str(x) for x in arr]
+    if typename == "float64":
+        assert res == [repr(float(x)) for x in arr]
+
+
+def test_float_parsing():
+    strings = [
+        " 1_000.2_5e-1_0\n",
+        "-.5",
+        "5.",
+        "+1E5",
+        "0.000000000000000000000000000001234",
+        "2.4703282292062328e-324",
+        "2.4703282292062327e-324",
+        "1.7976931348623157e308",
+        "1.7976931348623159e308",
+        "9007199254740993",
+        "1e-400",
+        "-1e400",
+        "-InFinity",
+        "nan",
+        "٣.5",
+        "1.0 ",
+    ]
+    arr = np.array(strings, dtype=StringDType()).astype("float64")
+    np.testing.assert_array_equal(arr, [float(s) for s in strings])
+
+    rng = np.random.default_rng(0)
+    bits = rng.integers(0, 2**63, 10000, dtype=np.uint64)
+    values = bits.view(np.float64)
+    values = values[np.isfinite(values)]
+    res = values.astype(StringDType()).astype("float64")
+    np.testing.assert_array_equal(res, values)
+
+    for bad in [
+        "",
+        "1_",
+        "1__0",
+        "1_.5",
+        "1._5",
+        "1e",
+        "1e_5",
+        "0x1p3",
+        "--1",
+    ]:
+        with pytest.raises(ValueError):
+            np.array([bad], dtype=StringDType()).astype("float64")
+
+
 def test_take(dtype, string_list):
     sarr = np.array(string_list, dtype=dtype)
     out = np.empty(len(string_list), dtype=dtype)
@@ -590,6 +1336,56 @@ def test_ufuncs_minmax(dtype, string_list, ufunc_name, func, use_out):
     np.testing.assert_array_equal(uarr, res)
 
 
+def test_minmax_non_nan_null():
+    # these loops run without the GIL, so the error for comparing a null
+    # that isn't nan-like must not crash
+    dtype = StringDType(na_object=None)
+    arr1 = np.array(["a", None, "c"] * 10, dtype=dtype)
+    arr2 = np.array(["b", "b", None] * 10, dtype=dtype)
+    for func in [np.maximum, np.minimum]:
+        with pytest.raises(ValueError, match="nan-like"):
+            func(arr1, arr2)
+        with pytest.raises(ValueError, match="nan-like"):
+            func.reduce(arr1)
+
+
+def test_ufunc_reductions(dtype, string_list):
+    arr = np.array(string_list, dtype=dtype)
+    assert np.add.reduce(arr) == "".join(string_list)
+    assert np.maximum.reduce(arr) == max(string_list)
+    assert np.minimum.reduce(arr) == min(string_list)
+    assert np.add.reduce(arr[:0]) == ""
+
+    arr2d = np.array([string_list, string_list[::-1]], dtype=dtype)
+    np.testing.assert_array_equal(
+        np.add.reduce(arr2d, axis=0),
+        [s1 + s2 for s1, s2 in zip(string_list, string_list[::-1])],
+    )
+    np.testing.assert_array_equal(
+        np.add.reduce(arr2d, axis=1),
+        ["".join(string_list), "".join(string_list[::-1])],
+    )
+    np.testing.assert_array_equal(
+        np.maximum.reduce(arr2d, axis=0),
+        [max(s1, s2) for s1, s2 in zip(string_list, string_list[::-1])],
+    )
+
+    if hasattr(dtype, "na_object"):
+        arr = np.array(string_list + [dtype.na_object], dtype=dtype)
+        is_nan = isinstance(dtype.na_object, float) and np.isnan(
+            dtype.na_object
+        )
+        if is_nan or (pd_NA is not None and dtype.na_object is pd_NA):
+            assert np.add.reduce(arr) is dtype.na_object
+        elif isinstance(dtype.na_object, str):
+            assert np.add.reduce(arr) == "".join(string_list) + (
+                dtype.na_object
+            )
+        else:
+            with pytest.raises(TypeError):
+                np.add.reduce(arr)
+
+
 @pytest.mark.parametrize("use_out", [[True, False]])
 @pytest.mark.parametrize(
     "other_strings",
@@ -776,6 +1572,42 @@ def test_datetime_cast(dtype):
     np.testing.assert_array_equal(sa, a.astype("U"))
 
 
+@pytest.mark.parametrize("unit", ["D", "h", "m", "s", "ms", "us", "ns", "M"])
+def test_datetime_formatting(unit):
+    rng = np.random.default_rng(0)
+    bound = 2**62 if unit == "ns" else 2**40
+    a = rng.integers(-bound, bound, 1000).astype(f"M8[{unit}]")
+    extremes = ["0000-01-01", "9999-12-31T23:59:59.999999999", "-0001-12-31"]
+    a = np.concatenate([a, np.array(extremes, dtype=f"M8[{unit}]")])
+    sa = a.astype(StringDType())
+    assert sa.tolist() == a.astype(str).tolist()
+    np.testing.assert_array_equal(sa.astype(a.dtype), a)
+
+
+def test_datetime_parsing():
+    strings = [
+        "2020-02-29",
+        "2020-01-01 12:34:56",
+        "2020-01-01T12:34:56.1",
+        "2020-01-01T12:34:56.123456789",
+        "2000-02-29T00:00:00.000",
+        # irregular layouts that numpy's parser handles
+        "2020-01-01T12:34",
+        "2020-01-01T12:34:56.1234567891",
+        "20200-01-01",
+    ]
+    arr = np.array(strings, dtype=StringDType())
+    np.testing.assert_array_equal(
+        arr.astype("M8[ns]"), np.array(strings).astype("M8[ns]")
+    )
+
+    invalid = ["2021-02-29", "1900-02-29", "2020-13-01", "2020-01-00"]
+    invalid += ["2020-01-01T24:00:00", "2020-01-01T12:34:5x"]
+    for bad in invalid:
+        with pytest.raises(ValueError):
+            np.array([bad], dtype=StringDType()).astype("M8[s]")
+
+
 def test_null_roundtripping(dtype):
     data = ["hello\0world", "ABC\0DEF\0\0"]
     arr = np.array(data, dtype=dtype)
@@ -808,6 +1640,86 @@ def test_growing_strings(dtype):
     np.testing.assert_array_equal(arr, uarr)
 
 
+def test_arena_growth(dtype):
+    # fill an empty array so every string is appended to the arena, with
+    # sizes chosen to leave a variety of unused space at the end of each
+    # arena chunk
+    rng = np.random.default_rng(0x5EED)
+    sizes = rng.integers(16, 600, size=2000)
+    sizes[::97] = 70000
+    data = [string.ascii_letters[i % 52] * n for i, n in enumerate(sizes)]
+    arr = np.empty(len(data), dtype=dtype)
+    for i, s in enumerate(data):
+        arr[i] = s
+    np.testing.assert_array_equal(
+        arr, np.array(data, dtype=object).astype(str)
+    )
+    arr[::2] = "short"
+    arr[::2] = arr[1::2]
+    np.testing.assert_array_equal(arr[::2], arr[1::2])
+
+
+def test_reuse_freed_strings(dtype):
+    # freed arena allocations can be reused by any entry, test that the
+    # bookkeeping is correct when strings move between size classes
+    data = ["a" * n for n in [16, 40, 100, 255, 256, 300, 1000]]
+    arr = np.array(data, dtype=dtype)
+    expected = np.array(data, dtype=object)
+
+    for i in range(len(data)):
+        shift = i + 1
+        arr[:] = np.roll(arr, shift)
+        expected[:] = np.roll(expected, shift)
+        arr[i] = "short"
+        expected[i] = "short"
+        np.testing.assert_array_equal(arr, expected.astype(str))
+
+    if hasattr(dtype, "na_object"):
+        arr[0] = dtype.na_object
+        arr[0] = "b" * 100
+        assert arr[0] == "b" * 100
+        arr[1] = dtype.na_object
+        arr[1] = "b" * 5
+        assert arr[1] == "b" * 5
+
+
+def test_free_twice():
+    # copying a null into an element frees it in free_and_copy and again when
+    # packing the null, the second free must not hand the allocation out twice
+    dtype = StringDType(na_object=None)
+    arr = np.array(["a" * 30, "b" * 30, "", ""], dtype=dtype)
+    arr[:] = np.array(
+        [None, "b" * 30, "", ""], dtype=StringDType(na_object=None)
+    )
+    arr[2] = "x" * 30
+    arr[3] = "y" * 30
+    assert arr.tolist() == [None, "b" * 30, "x" * 30, "y" * 30]
+
+
+def test_arena_full_heap_fallback():
+    # strings that don't fit once the arena can't grow any more go on the
+    # heap. Failing the allocation of a new arena chunk takes the same path
+    # as running out of chunks.
+    testcapi = pytest.importorskip("_testcapi")
+    dtype = StringDType(na_object=None)
+    arr = np.array(["a" * 200, "", ""], dtype=dtype)
+    testcapi.set_nomemory(0, 1)
+    try:
+        arr[1] = "b" * 300
+    finally:
+        testcapi.remove_mem_hooks()
+    assert arr[1] == "b" * 300
+    usage = _memory_usage(arr, detailed=True)
+    assert usage["heap"] == 300
+    assert usage["arena_capacity"] == 256
+    # frees the heap string twice, see test_free_twice
+    arr[:] = np.array([None, None, "c" * 30], dtype=dtype)
+    assert _memory_usage(arr, detailed=True)["heap"] == 0
+    arr[1] = "x" * 30
+    arr[2] = "y" * 30
+    assert arr.tolist() == [None, "x" * 30, "y" * 30]
+
+
 def test_threaded_access_and_mutation(dtype, random_string_list):
     # this test uses an RNG and may crash or cause deadlocks if there is a
     # threading bug
@@ -839,3 +1751,307 @@ def test_threaded_access_and_mutation(dtype, random_string_list):
 
         for f in futures:
             f.result()
+
+
+def test_threaded_concurrent_reads(dtype, random_string_list):
+    # read-only loops share the allocator, so mixing them with writers from
+    # other threads must neither deadlock nor produce torn results. The
+    # writers use the trailing entries, a view of the same array, so they
+    # share the readers' descriptor and allocator.
+    n = len(random_string_list)
+    full = np.concatenate([random_string_list, random_string_list[:10]])
+    full = full.astype(dtype)
+    arr = full[:n]
+    scratch = full[n:]
+    other = np.array(random_string_list[::-1], dtype=dtype)
+    uarr = np.array(random_string_list, dtype=str)
+    uother = uarr[::-1]
+    expected_lt = uarr < uother
+    expected_argmax = np.argmax(uarr)
+
+    def read(i):
+        if i % 4 == 0:
+            np.testing.assert_array_equal(arr < other, expected_lt)
+        elif i % 4 == 1:
+            np.testing.assert_array_equal(arr.astype(uarr.dtype), uarr)
+        elif i % 4 == 2:
+            assert np.argmax(arr) == expected_argmax
+        else:
+            assert scratch.dtype is arr.dtype
+            scratch[:] = arr[:10]
+            np.add(scratch, scratch, out=scratch)
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=8) as tpe:
+        futures = [tpe.submit(read, i) for i in range(400)]
+
+        for f in futures:
+            f.result()
+
+
+@pytest.mark.parametrize("reader", ["less", "tolist"])
+def test_threaded_writer_not_starved_by_readers(reader):
+    # readers that keep overlapping must not hold off a writer to the same
+    # array forever, including the getitem fast path used by tolist
+    n = 100000
+    arr = np.array(["x" * 20 + str(i) for i in range(n)] + [""] * 8)
+    arr = arr.astype(StringDType())
+    data = arr[:n]
+    tail = arr[n:]
+    other = data[::-1].copy()
+    stop = threading.Event()
+
+    def read():
+        while not stop.is_set():
+            if reader == "less":
+                np.less(data, other)
+            else:
+                data.tolist()
+
+    def write():
+        for j in range(50):
+            tail[j % 8] = "y" * 30
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=8) as tpe:
+        readers = [tpe.submit(read) for _ in range(6)]
+        try:
+            tpe.submit(write).result(timeout=30)
+        finally:
+            stop.set()
+        for f in readers:
+            f.result()
+    assert tail.tolist() == ["y" * 30] * 8
+
+
+def test_threaded_numeric_casts():
+    # numeric casts run without the GIL and only take it to fall back to
+    # int() and float(), e.g. for non-ASCII digits or to raise errors
+    istrings = [str(i) for i in range(-5000, 5000)] + ["٣", " 7_7 "]
+    iarr = np.array(istrings, dtype=StringDType())
+    iexpected = np.array([int(s) for s in istrings])
+    values = np.random.default_rng(0).normal(size=10000)
+    fstrings = [str(v) for v in values] + ["٣.5", "1e400"]
+    farr = np.array(fstrings, dtype=StringDType())
+    fexpected = np.array([float(s) for s in fstrings])
+    bad = np.array(["1", "2", "not a number"], dtype=StringDType())
+
+    def convert(i):
+        if i % 4 == 0:
+            np.testing.assert_array_equal(iarr.astype("int64"), iexpected)
+        elif i % 4 == 1:
+            np.testing.assert_array_equal(farr.astype("float64"), fexpected)
+        elif i % 4 == 2:
+            res = values.astype(StringDType())
+            np.testing.assert_array_equal(res, fstrings[:-2])
+        else:
+            with pytest.raises(ValueError):
+                bad.astype("float64" if i % 8 == 3 else "int64")
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=8) as tpe:
+        futures = [tpe.submit(convert, i) for i in range(200)]
+
+        for f in futures:
+            f.result()
+
+
+def test_threaded_python_fallback_casts_with_writers():
+    # non-ASCII digits go through int() and float(), which need the GIL,
+    # while writers to the same array hold the GIL and wait for the
+    # allocator. This deadlocks if the casts take the GIL while holding the
+    # allocator.
+    arr = np.array(["٣" * 3] * 1000 + ["1"] * 8, dtype=StringDType())
+    data = arr[:1000]
+    tail = arr[1000:]
+
+    def work(i):
+        if i % 2:
+            for _ in range(10):
+                np.testing.assert_array_equal(data.astype("int64"), 333)
+                np.testing.assert_array_equal(data.astype("float64"), 333)
+        else:
+            for j in range(1000):
+                tail[j % 8] = str(j)
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=8) as tpe:
+        futures = [tpe.submit(work, i) for i in range(16)]
+
+        for f in futures:
+            f.result()
+
+
+@requires_debug_allocator
+def test_add_out_overwrites_heap_strings():
+    # the second entry is reassigned to a string that doesn't fit in the
+    # arena, which can't grow, so it lives on the heap and must be freed
+    # before the output of add is written from a thread-local buffer
+    dtype = StringDType(allocator="debug")
+    out = np.array(["z" * 20, "x" * 20], dtype=dtype)
+    _set_debug_allocation_limit(400)
+    try:
+        out[1] = "y" * 300
+    finally:
+        _set_debug_allocation_limit(0)
+    assert _memory_usage(out, detailed=True)["heap"] == 300
+    arr = np.array(["a" * 20, "b" * 20], dtype=dtype)
+    np.add(arr, arr, out=out)
+    assert _memory_usage(out, detailed=True)["heap"] == 0
+    assert out.tolist() == ["a" * 40, "b" * 40]
+
+
+def test_add_reserves_little_for_small_outputs():
+    # each refill of the thread-local buffer reserves as much as all of the
+    # earlier ones, so writing two strings doesn't reserve a whole buffer
+    arr = np.array(["a" * 20, "b" * 20], dtype=StringDType())
+    res = np.add(arr, arr)
+    assert res.tolist() == ["a" * 40, "b" * 40]
+    usage = _memory_usage(res, detailed=True)
+    assert usage["arena_capacity"] == 256
+    assert usage["arena_live"] == 80
+    assert usage["arena_prefix"] == 2
+    # the second reservation had room for one more string
+    assert usage["arena_dead"] == 41
+
+
+def test_threaded_writes_into_shared_array(dtype, random_string_list):
+    # threads writing into different rows of the same array allocate from
+    # separate buffers in the same arena
+    arr = np.array(random_string_list, dtype=dtype)
+    out = np.empty((8, len(arr)), dtype=dtype)
+
+    def write(i):
+        for _ in range(10):
+            np.add(arr, arr, out=out[i])
+            np.multiply(arr, np.int64(3), out=out[i])
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=8) as tpe:
+        futures = [tpe.submit(write, i) for i in range(8)]
+
+        for f in futures:
+            f.result()
+
+    expected = np.array([s * 3 for s in random_string_list], dtype=dtype)
+    for row in out:
+        np.testing.assert_array_equal(row, expected)
+    compact(out)
+    for row in out:
+        np.testing.assert_array_equal(row, expected)
+
+
+@pytest.mark.parametrize(
+    "allocator",
+    [
+        "default",
+        "malloc",
+        "bump",
+        "pool",
+        "intern",
+        pytest.param("debug", marks=requires_debug_allocator),
+    ],
+)
+def test_allocator_backends(allocator, string_list):
+    dtype = StringDType(allocator=allocator)
+    if allocator == "default":
+        assert repr(dtype) == "StringDType()"
+    else:
+        assert repr(dtype) == f"StringDType(allocator='{allocator}')"
+    assert (dtype == StringDType()) == (allocator == "default")
+
+    arr = np.array(string_list, dtype=dtype)
+    assert repr(arr.dtype) == repr(dtype)
+    res = pickle.loads(pickle.dumps([arr, dtype]))
+    np.testing.assert_array_equal(res[0], arr)
+    assert repr(res[1]) == repr(dtype)
+    assert repr(res[0].dtype) == repr(dtype)
+
+    # outputs use the same backend as the inputs
+    added = np.add(arr, arr)
+    assert repr(added.dtype) == repr(dtype)
+    np.testing.assert_array_equal(added, [s + s for s in string_list])
+
+    for i in range(len(arr)):
+        arr[i] = string_list[::-1][i]
+    np.testing.assert_array_equal(arr, string_list[::-1])
+    compact(arr)
+    np.testing.assert_array_equal(arr, string_list[::-1])
+
+
+@pytest.mark.parametrize("allocator", ["malloc", "bump", "pool", "intern"])
+def test_astype_switches_allocator_backend(allocator, string_list):
+    arr = np.array(string_list, dtype=StringDType())
+    dtype = StringDType(allocator=allocator)
+    for res in [arr.astype(dtype), arr.astype(dtype, copy=False)]:
+        assert res is not arr
+        assert repr(res.dtype) == repr(dtype)
+        np.testing.assert_array_equal(res, arr)
+        back = res.astype(StringDType(), copy=False)
+        assert back is not res
+        assert repr(back.dtype) == "StringDType()"
+        np.testing.assert_array_equal(back, arr)
+    assert arr.astype(StringDType(), copy=False) is arr
+
+
+def test_bump_allocator():
+    arr = np.array(["a" * 20, "b" * 20], dtype=StringDType(allocator="bump"))
+    arr[0] = "c" * 18
+    usage = _memory_usage(arr, detailed=True)
+    # the freed allocation isn't reused, even though the new string fits
+    assert usage["arena_dead"] == 21
+    assert usage["arena_live"] == 38
+    assert usage["heap"] == 0
+    compact(arr)
+    usage = _memory_usage(arr, detailed=True)
+    assert usage["arena_dead"] == 0
+    assert usage["arena_live"] == 38
+    np.testing.assert_array_equal(arr, ["c" * 18, "b" * 20])
+
+    with pytest.raises(ValueError, match="Unknown StringDType allocator"):
+        StringDType(allocator="nonexistent")
+
+
+def test_intern_allocator():
+    categories = ["category number " + str(i) for i in range(10)]
+    data = categories * 1000
+    arr = np.array(data, dtype=StringDType(allocator="intern"))
+    usage = _memory_usage(arr, detailed=True)
+    # each distinct string is only stored once
+    assert usage["arena_live"] == sum(len(c) for c in categories)
+    assert usage["intern_table"] > 0
+    assert _memory_usage(arr) < _memory_usage(
+        np.array(data, dtype=StringDType())
+    )
+    np.testing.assert_array_equal(arr, data)
+    assert (arr[10:] == arr[:-10]).all()
+
+    # the storage is only freed once no string refers to it
+    arr[:10] = "a different long string"
+    arr[10:20] = "another different long string"
+    np.testing.assert_array_equal(arr[20:], data[20:])
+    arr[20:] = "another different long string"
+    usage = _memory_usage(arr, detailed=True)
+    assert usage["arena_live"] == 52
+    compact(arr)
+    usage = _memory_usage(arr, detailed=True)
+    assert usage["arena_dead"] == 0
+    assert usage["arena_live"] == 52
+    np.testing.assert_array_equal(arr[:10], ["a different long string"] * 10)
+    np.testing.assert_array_equal(
+        arr[10:], ["another different long string"] * 9990
+    )
+
+
+def test_intern_allocator_free_twice():
+    # copying a null frees each element twice, which must only release one
+    # reference to the shared storage of an interned string
+    value = "value-" + "x" * 30
+    dtype = StringDType(na_object=None, allocator="intern")
+    arr = np.array([value] * 4 + ["", ""], dtype=dtype)
+    src = np.array(
+        [None, None, value, value, "", ""], dtype=StringDType(na_object=None)
+    )
+    arr[:] = src
+    arr[4] = "y" * 36
+    arr[5] = "z" * 36
+    assert arr.tolist() == [None, None, value, value, "y" * 36, "z" * 36]
+    usage = _memory_usage(arr, detailed=True)
+    assert usage["arena_live"] == len(value) + 72
+    compact(arr)
+    assert arr.tolist() == [None, None, value, value, "y" * 36, "z" * 36]